@@ -0,0 +1,309 @@
+#include "Bench.h"
+#include "JobControl.h"
+
+// labels of the measurements, in the order their statistics are stored
+static char *statLabels[] = {"wall_ms", "user_ms", "sys_ms", "max_rss_kb"};
+
+/************************************************************************************
+ * Function to run the benchmarked command once and measure it
+ *
+ * @param cmd: command to run
+ * @param resolved: full path of the command from resolveCommand (or NULL)
+ * @param run: structure to load with the measurements
+ * @return: FALSE if the command could not be run or was interrupted
+ ***********************************************************************************/
+int runBenchOnce(struct command *cmd, char *resolved, struct benchRun *run) {
+    struct rusage usage;
+    int statusCode = 0, isStopped = FALSE;
+    long long start = monotonicNs();
+
+    pid_t pid = spawnCommand(cmd, resolved, FOREGROUND | CHILD);
+    if (pid < 0) {
+        return FALSE;
+    }
+
+    // wait for the child collecting its resource usage. A run stopped by ^Z is killed
+    // as benchmarking stops, and the shell takes the terminal back either way.
+    while (1) {
+        if (wait4(pid, &statusCode, WUNTRACED, &usage) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            reclaimTerminal();
+            return FALSE;
+        }
+        if (!WIFSTOPPED(statusCode)) {
+            break;
+        }
+        signalJob(pid, SIGKILL);
+        isStopped = TRUE;
+    }
+    reclaimTerminal();
+
+    run->wallMs = (monotonicNs() - start) / 1e6;
+    run->userMs = usage.ru_utime.tv_sec * 1e3 + usage.ru_utime.tv_usec / 1e3;
+    run->sysMs = usage.ru_stime.tv_sec * 1e3 + usage.ru_stime.tv_usec / 1e3;
+    run->maxRssKb = usage.ru_maxrss;
+    run->exitStatus = statusToExitCode(statusCode);
+
+    // stop benchmarking if the user interrupted the command
+    return !isStopped && !(WIFSIGNALED(statusCode) && WTERMSIG(statusCode) == SIGINT);
+}
+
+/************************************************************************************
+ * Comparison function for sorting measurements in ascending order
+ ***********************************************************************************/
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/************************************************************************************
+ * Function to find a percentile of sorted values, interpolating between the two
+ * closest values
+ *
+ * @param sorted: values in ascending order
+ * @param count: number of values
+ * @param fraction: percentile as a fraction between 0 and 1
+ * @return: the percentile
+ ***********************************************************************************/
+double percentile(double *sorted, int count, double fraction) {
+    double rank = fraction * (count - 1);
+    int lower = (int) rank;
+
+    if (lower + 1 >= count) {
+        return sorted[count - 1];
+    }
+
+    return sorted[lower] + (rank - lower) * (sorted[lower + 1] - sorted[lower]);
+}
+
+/************************************************************************************
+ * Function to compute the summary statistics of a measurement, with outliers found
+ * using fences at multiples of the interquartile range
+ *
+ * @param values: the measurement from each run (sorted in place)
+ * @param count: number of runs
+ * @param stats: structure to load with the statistics
+ ***********************************************************************************/
+void computeStats(double *values, int count, struct benchStats *stats) {
+    double sum = 0, squares = 0, q1, q3, iqr;
+    int i;
+
+    memset(stats, 0, sizeof(struct benchStats));
+    if (count == 0) {
+        return;
+    }
+
+    qsort(values, count, sizeof(double), compareDoubles);
+
+    for (i = 0; i < count; i++) {
+        sum += values[i];
+    }
+    stats->mean = sum / count;
+
+    // sample standard deviation
+    for (i = 0; i < count; i++) {
+        squares += (values[i] - stats->mean) * (values[i] - stats->mean);
+    }
+    stats->stddev = count > 1 ? sqrt(squares / (count - 1)) : 0;
+
+    stats->min = values[0];
+    stats->max = values[count - 1];
+    stats->p50 = percentile(values, count, 0.5);
+    stats->p90 = percentile(values, count, 0.9);
+    stats->p99 = percentile(values, count, 0.99);
+
+    // count values outside the mild and severe fences
+    q1 = percentile(values, count, 0.25);
+    q3 = percentile(values, count, 0.75);
+    iqr = q3 - q1;
+    for (i = 0; i < count; i++) {
+        if (values[i] < q1 - SEVERE_OUTLIER * iqr || values[i] > q3 + SEVERE_OUTLIER * iqr) {
+            stats->severeOutliers++;
+        } else if (values[i] < q1 - MILD_OUTLIER * iqr || values[i] > q3 + MILD_OUTLIER * iqr) {
+            stats->mildOutliers++;
+        }
+    }
+}
+
+/************************************************************************************
+ * Function to queue a row of the summary table
+ *
+ * @param label: name of the measurement
+ * @param stats: statistics of the measurement
+ ***********************************************************************************/
+void queueStatsRow(char *label, struct benchStats *stats) {
+    queueFormat("%-11s %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", label, stats->mean,
+                stats->stddev, stats->min, stats->p50, stats->p90, stats->p99, stats->max);
+}
+
+/************************************************************************************
+ * Function to export the measurements of every run as CSV
+ *
+ * @param path: file to write
+ * @param runs: measurements of each run
+ * @param count: number of runs
+ ***********************************************************************************/
+void writeBenchCsv(char *path, struct benchRun *runs, int count) {
+    int i;
+    FILE *file = fopen(path, "w");
+
+    if (file == NULL) {
+        queueFormat("cannot open %s for output\n", path);
+        return;
+    }
+
+    fprintf(file, "run,wall_ms,user_ms,sys_ms,max_rss_kb,exit_status\n");
+    for (i = 0; i < count; i++) {
+        fprintf(file, "%d,%.6f,%.6f,%.6f,%ld,%d\n", i + 1, runs[i].wallMs, runs[i].userMs,
+                runs[i].sysMs, runs[i].maxRssKb, runs[i].exitStatus);
+    }
+    fclose(file);
+}
+
+/************************************************************************************
+ * Function to export the measurements and statistics as JSON
+ *
+ * @param path: file to write
+ * @param cmd: the benchmarked command
+ * @param runs: measurements of each run
+ * @param count: number of runs
+ * @param stats: statistics of each measurement, in the order of statLabels
+ ***********************************************************************************/
+void writeBenchJson(char *path, struct command *cmd, struct benchRun *runs, int count, struct benchStats *stats) {
+    int i;
+    char *c;
+    FILE *file = fopen(path, "w");
+
+    if (file == NULL) {
+        queueFormat("cannot open %s for output\n", path);
+        return;
+    }
+
+    // the command's arguments, escaping quotes, backslashes and control characters
+    fprintf(file, "{\"command\":[");
+    for (i = 0; i < cmd->numArgs; i++) {
+        fprintf(file, i ? ",\"" : "\"");
+        for (c = cmd->args[i]; *c; c++) {
+            if (*c == '"' || *c == '\\') {
+                fprintf(file, "\\%c", *c);
+            } else if ((unsigned char) *c < 0x20) {
+                fprintf(file, "\\u%04x", *c);
+            } else {
+                fputc(*c, file);
+            }
+        }
+        fprintf(file, "\"");
+    }
+
+    fprintf(file, "],\"runs\":[");
+    for (i = 0; i < count; i++) {
+        fprintf(file, "%s{\"wall_ms\":%.6f,\"user_ms\":%.6f,\"sys_ms\":%.6f,\"max_rss_kb\":%ld,\"exit_status\":%d}",
+                i ? "," : "", runs[i].wallMs, runs[i].userMs, runs[i].sysMs, runs[i].maxRssKb, runs[i].exitStatus);
+    }
+
+    fprintf(file, "],\"summary\":{");
+    for (i = 0; i < 4; i++) {
+        fprintf(file, "%s\"%s\":{\"mean\":%.6f,\"stddev\":%.6f,\"min\":%.6f,\"p50\":%.6f,\"p90\":%.6f,"
+                      "\"p99\":%.6f,\"max\":%.6f,\"mild_outliers\":%d,\"severe_outliers\":%d}",
+                i ? "," : "", statLabels[i], stats[i].mean, stats[i].stddev, stats[i].min, stats[i].p50,
+                stats[i].p90, stats[i].p99, stats[i].max, stats[i].mildOutliers, stats[i].severeOutliers);
+    }
+    fprintf(file, "}}\n");
+    fclose(file);
+}
+
+/************************************************************************************
+ * Function to implement the bench built in command. The command is parsed once and
+ * run through the normal spawn path for each warmup and measured run.
+ *
+ * @param cmd: the bench command, its options, and the command to benchmark
+ * @return: exit status of the built in (0 if every measured run succeeded)
+ ***********************************************************************************/
+int bench(struct command *cmd) {
+    int runs = DEFAULT_BENCH_RUNS, warmup = DEFAULT_BENCH_WARMUP, argIdx = 1, i, j, completed = 0, failed = 0;
+    char *csvPath = NULL, *jsonPath = NULL, *resolved;
+    struct command target;
+    struct benchRun *results, discard;
+    struct benchStats stats[4];
+    double *values;
+
+    // read the options
+    while (argIdx + 1 < cmd->numArgs && cmd->args[argIdx][0] == '-') {
+        if (strcmp(cmd->args[argIdx], "-n") == 0) {
+            runs = atoi(cmd->args[argIdx + 1]);
+        } else if (strcmp(cmd->args[argIdx], "-w") == 0) {
+            warmup = atoi(cmd->args[argIdx + 1]);
+        } else if (strcmp(cmd->args[argIdx], "-c") == 0) {
+            csvPath = cmd->args[argIdx + 1];
+        } else if (strcmp(cmd->args[argIdx], "-j") == 0) {
+            jsonPath = cmd->args[argIdx + 1];
+        } else {
+            break;
+        }
+        argIdx += 2;
+    }
+
+    if (argIdx >= cmd->numArgs || runs < 1 || warmup < 0) {
+        queueConstant("usage: bench [-n runs] [-w warmup] [-c csvfile] [-j jsonfile] command args...\n");
+        return 1;
+    }
+
+    // the benchmarked command is the rest of the arguments with bench's redirections
+    target = *cmd;
+    target.args = cmd->args + argIdx;
+    target.numArgs = cmd->numArgs - argIdx;
+    target.next = NULL;
+    resolved = resolveCommand(target.args[0]);
+
+    results = MEM_CALLOC(MEM_BENCH, runs, sizeof(struct benchRun));
+    values = MEM_CALLOC(MEM_BENCH, runs, sizeof(double));
+
+    // warm up runs are made but not measured
+    for (i = 0; i < warmup + runs; i++) {
+        if (!runBenchOnce(&target, resolved, i < warmup ? &discard : &results[completed])) {
+            break;
+        }
+        if (i >= warmup) {
+            failed += results[completed].exitStatus != 0;
+            completed++;
+        }
+    }
+
+    // summarise each measurement
+    for (j = 0; j < 4; j++) {
+        for (i = 0; i < completed; i++) {
+            values[i] = j == 0 ? results[i].wallMs : j == 1 ? results[i].userMs :
+                        j == 2 ? results[i].sysMs : (double) results[i].maxRssKb;
+        }
+        computeStats(values, completed, &stats[j]);
+    }
+
+    queueFormat("bench: %d run(s) of %s (%d warmup)\n", completed, target.args[0], warmup);
+    if (completed > 0) {
+        queueFormat("%-11s %10s %10s %10s %10s %10s %10s %10s\n", "", "mean", "stddev", "min", "p50", "p90", "p99", "max");
+        for (j = 0; j < 4; j++) {
+            queueStatsRow(statLabels[j], &stats[j]);
+        }
+        queueFormat("wall time outliers: %d mild, %d severe\n", stats[0].mildOutliers, stats[0].severeOutliers);
+    }
+    if (failed > 0) {
+        queueFormat("%d run(s) exited with a non-zero status\n", failed);
+    }
+    if (completed < runs) {
+        queueConstant("bench interrupted\n");
+    }
+
+    if (csvPath != NULL) {
+        writeBenchCsv(csvPath, results, completed);
+    }
+    if (jsonPath != NULL) {
+        writeBenchJson(jsonPath, &target, results, completed, stats);
+    }
+
+    MEM_FREE(results);
+    MEM_FREE(values);
+
+    return failed > 0 || completed < runs;
+}
@@ -0,0 +1,53 @@
+/************************************************************************************
+ * This file defines functions related to the bench built in command, which runs a
+ * command repeatedly and reports statistics about its resource usage
+ *
+ * usage: bench [-n runs] [-w warmup] [-c csvfile] [-j jsonfile] command args...
+ ***********************************************************************************/
+#ifndef CS344_BENCH_H
+#define CS344_BENCH_H
+
+#include <math.h>
+#include <sys/resource.h>
+
+#include "CommandParser.h"
+#include "CommandDelegator.h"
+
+#define DEFAULT_BENCH_RUNS 10
+#define DEFAULT_BENCH_WARMUP 1
+
+// number of interquartile ranges outside the quartiles for mild and severe outliers
+#define MILD_OUTLIER 1.5
+#define SEVERE_OUTLIER 3.0
+
+// structure holding the measurements of a single run
+struct benchRun {
+    double wallMs;
+    double userMs;
+    double sysMs;
+    long maxRssKb;
+    int exitStatus;
+};
+
+// structure holding the summary statistics of one measurement across all runs
+struct benchStats {
+    double mean;
+    double stddev;
+    double min;
+    double max;
+    double p50;
+    double p90;
+    double p99;
+    int mildOutliers;
+    int severeOutliers;
+};
+
+int bench(struct command *cmd);
+int runBenchOnce(struct command *cmd, char *resolved, struct benchRun *run);
+double percentile(double *sorted, int count, double fraction);
+void computeStats(double *values, int count, struct benchStats *stats);
+void queueStatsRow(char *label, struct benchStats *stats);
+void writeBenchCsv(char *path, struct benchRun *runs, int count);
+void writeBenchJson(char *path, struct command *cmd, struct benchRun *runs, int count, struct benchStats *stats);
+
+#endif //CS344_BENCH_H
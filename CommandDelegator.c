@@ -1,5 +1,23 @@
 #include "CommandParser.h"
 #include "CommandDelegator.h"
+#include "Bench.h"
+#include "FanOut.h"
+#include "Replay.h"
+#include "Timeout.h"
+#include "JobState.h"
+#include "Events.h"
+#include "Functions.h"
+#include "Pipeline.h"
+#include "Variables.h"
+#include "Prompt.h"
+#include "Watch.h"
+#include "JobControl.h"
+
+// flag to indicate if the command line prompt should be shown (off when running scripts)
+int showPrompt = TRUE;
+
+// exit status of the most recent command, used for $? and command lists
+int lastExitStatus = 0;
 
 /************************************************************************************
  * Blocking function to wait for a specified process to finish and preform related
@@ -9,40 +27,74 @@
  ***********************************************************************************/
 int clearFinished(pid_t targetProcess, int hideStatus) {
     int statusCode = 0, result;
-    char *stat = calloc(100, sizeof(char));
+    char *stat = MEM_CALLOC(MEM_STATUS, 100, sizeof(char));
+    struct rusage usage;
 
     // wait for the indicated process and load its status into statusCode
-    result = waitpid(targetProcess, &statusCode, 0);
-
-    if (!hideStatus) {
-        // if statuscode is 0 the process terminated normally so load stat with "exit value 0"
-        if (statusCode == 0) {
-            sprintf(stat, "exit value 0\n");
-
-            // is the process exited set stat to be "exit value #" where # is the value used
-            // in the exit call
-        } else if (WIFEXITED(statusCode) == 1) {
-            statusCode = WEXITSTATUS(statusCode);
-            sprintf(stat, "exit value %d\n", statusCode);
-
-            // if neither of the previous if's evaluate to true then the process was terminated
-            // by a signal so set stat to indicate as such with the signal number (and display
-            // that it was terminated)
-        } else {
-            sprintf(stat, "terminated by signal %d\n", WTERMSIG(statusCode));
-            printf("%s", stat);
-        }
+    result = wait4(targetProcess, &statusCode, 0, &usage);
+    if (result > 0) {
+        lastExitStatus = statusToExitCode(statusCode);
+        metricsJobFinished(targetProcess, statusCode);
+        eventJobFinished(targetProcess, statusCode, &usage);
     }
 
-    // set the status environment variable to stat for use with the status command
-    setenv(STATUS, stat, 1);
-    free(stat);
+    formatStatus(statusCode, stat);
+
+    // if the process was terminated by a signal display that it was terminated
+    if (!hideStatus && !WIFEXITED(statusCode)) {
+        queueString(stat);
+    }
+
+    // set the status shell variable to stat for use with the status command
+    setShellVar(STATUS, stat);
+    if (result > 0 && !hideStatus) {
+        metricsSetStatus(lastExitStatus, stat);
+    }
+    MEM_FREE(stat);
 
     // since this function is the one most likely to be active during a switch
     // to foreground only mode this return value indicates that the clearing finished
     return result;
 }
 
+/************************************************************************************
+ * Function to describe how a process finished for use with the status command
+ *
+ * @param statusCode: status of the process as returned by waitpid
+ * @param dest: character array to load with the description
+ ***********************************************************************************/
+void formatStatus(int statusCode, char *dest) {
+    // if statuscode is 0 the process terminated normally so load dest with "exit value 0"
+    if (statusCode == 0) {
+        sprintf(dest, "exit value 0\n");
+
+        // is the process exited set dest to be "exit value #" where # is the value used
+        // in the exit call
+    } else if (WIFEXITED(statusCode) == 1) {
+        sprintf(dest, "exit value %d\n", WEXITSTATUS(statusCode));
+
+        // if neither of the previous if's evaluate to true then the process was terminated
+        // by a signal so set dest to indicate as such with the signal number
+    } else {
+        sprintf(dest, "terminated by signal %d\n", WTERMSIG(statusCode));
+    }
+}
+
+/************************************************************************************
+ * Function to convert the status of a finished process to a numeric exit status,
+ * with termination by a signal reported as 128 plus the signal number
+ *
+ * @param statusCode: status of the process as returned by waitpid
+ * @return: the exit status
+ ***********************************************************************************/
+int statusToExitCode(int statusCode) {
+    if (WIFEXITED(statusCode)) {
+        return WEXITSTATUS(statusCode);
+    }
+
+    return 128 + WTERMSIG(statusCode);
+}
+
 /************************************************************************************
  * A non-blocking function to wait for any non finished child process and preform
  * related clean up operations
@@ -53,23 +105,57 @@ int clearFinished(pid_t targetProcess, int hideStatus) {
 void nonBlockClearFinished(struct processLinkedList *processList){
     int statusCode = 0;
     pid_t finishedProcess = 0;
+    struct processNode *node;
+    struct rusage usage;
+    int isTimedOut;
 
     // while there are still processes waiting to be collected collect them
-    while((finishedProcess = waitpid(-1, &statusCode, WNOHANG)) > 0){
+    while((finishedProcess = wait4(-1, &statusCode, WNOHANG | WUNTRACED | WCONTINUED, &usage)) > 0){
+        // a job stopped (or continued) from elsewhere stays in the list
+        node = findProcess(processList, finishedProcess);
+        if (WIFSTOPPED(statusCode) || WIFCONTINUED(statusCode)) {
+            if (node != NULL && WIFSTOPPED(statusCode) && !node->isStopped && !node->isQuiet) {
+                announceStopped(finishedProcess);
+            }
+            if (node != NULL) {
+                node->isStopped = WIFSTOPPED(statusCode);
+            }
+            continue;
+        }
+
+        metricsJobFinished(finishedProcess, statusCode);
+        eventJobFinished(finishedProcess, statusCode, &usage);
+
+        // process substitutions are removed without a notice
+        isTimedOut = node != NULL && node->timeout != NULL && node->timeout->isSignalled;
+        if (node != NULL && node->isQuiet) {
+            removeProcess(processList, finishedProcess);
+
         // if we can successfully remove the process from the list
-        if (removeProcess(processList, finishedProcess)) {
-            // print the process id that was collected and how it terminated
-            printf("background pid %d is done:", finishedProcess);
+        } else if (removeProcess(processList, finishedProcess)) {
+            // queue the process id that was collected and how it terminated
+            queueConstant("background pid ");
+            queueInt(finishedProcess);
+            queueConstant(" is done: ");
+            if (isTimedOut) {
+                queueConstant("timed out, ");
+            }
             if (statusCode == 0) {
-                printf(" exit value 0\n");
+                queueConstant("exit value 0\n");
             } else if (WIFEXITED(statusCode) == 1) {
-                printf(" exit value %d\n", WEXITSTATUS(statusCode));
+                queueConstant("exit value ");
+                queueInt(WEXITSTATUS(statusCode));
+                queueConstant("\n");
             } else {
-                printf(" terminated by signal %d\n", WTERMSIG(statusCode));
+                queueConstant("terminated by signal ");
+                queueInt(WTERMSIG(statusCode));
+                queueConstant("\n");
             }
-            fflush(stdout);
         }
     }
+
+    // jobs adopted from another shell are watched through their pidfds
+    reapAdopted(processList);
 }
 
 /************************************************************************************
@@ -77,105 +163,435 @@ void nonBlockClearFinished(struct processLinkedList *processList){
  *
  * @param args: list of arguments
  * @param numArgs: number of arguments
+ * @return: exit status of the command (0 if the directory was changed)
  ***********************************************************************************/
-void cd(char **args, int numArgs) {
+int cd(char **args, int numArgs) {
+    int result;
+
     // only 1 argument change directory to home, otherwise change to directory
     // indicated in arg[1]
     if (numArgs < 2) {
-        chdir(getenv("HOME"));
+        result = chdir(getenv("HOME"));
     } else {
-        chdir(args[1]);
+        result = chdir(args[1]);
+    }
+
+    // the prompt's directory and branch are found again
+    if (result == 0) {
+        promptChangedDir();
+    }
+
+    return result == 0 ? 0 : 1;
+}
+
+/************************************************************************************
+ * Function to implement the exec built in command, which applies its redirections to
+ * the shell itself so they stay in place for every later command. Children inherit
+ * the descriptors, so "cmd >&3" only needs a dup2 where "cmd >> file" would open the
+ * file every time. Replacing the shell with a command is not supported.
+ *
+ * @param cmd: the exec command
+ * @param procList: linked list of outstanding processes
+ * @return: exit status of the command (0 if every redirection was applied)
+ ***********************************************************************************/
+int execRedirects(struct command *cmd, struct processLinkedList *procList) {
+    struct redirection *cur;
+    int isApplied = TRUE;
+
+    if (cmd->numArgs > 1) {
+        queueConstant("exec: only redirections are supported\n");
+        return 1;
+    }
+
+    // the shell's own files live from SHELL_MIN_FD up
+    for (cur = cmd->redirs; cur != NULL; cur = cur->next) {
+        if (cur->fd >= SHELL_MIN_FD || (cur->type == REDIR_DUP && cur->dupFd >= SHELL_MIN_FD)) {
+            queueFormat("exec: %d: file descriptor is reserved for the shell\n",
+                        cur->fd >= SHELL_MIN_FD ? cur->fd : cur->dupFd);
+            return 1;
+        }
     }
+    if (needsFanOut(cmd)) {
+        queueConstant("exec: a file descriptor can only be redirected to one file\n");
+        return 1;
+    }
+
+    // write what is queued for the current stdout before it may be replaced
+    flushOutput();
+    if (!startProcSubs(cmd, procList)) {
+        closeProcSubs(cmd);
+        return 1;
+    }
+    for (cur = cmd->redirs; cur != NULL && isApplied; cur = cur->next) {
+        isApplied = applyRedirect(cur);
+    }
+    closeProcSubs(cmd);
+
+    return isApplied ? 0 : 1;
 }
 
 /************************************************************************************
  * Function to show the most recent status code from a foreground process
  ***********************************************************************************/
 void showStatus() {
-    // get the status from the environment variables and print it
-    printf(getenv(STATUS));
-    fflush(stdout);
+    // get the status from the shell variables and queue it
+    queueString(getShellVar(STATUS));
+}
+
+/************************************************************************************
+ * Function to collect any outstanding child processes that have already finished
+ * without blocking and remove them from the list quietly
+ *
+ * @param processList: linked list of outstanding processes
+ * @return: number of processes still outstanding
+ ***********************************************************************************/
+int reapExited(struct processLinkedList *processList) {
+    int remaining = 0, statusCode = 0;
+    struct processNode *cur = processList->head, *next;
+    struct rusage usage;
+
+    while (cur != NULL) {
+        // save the next node now since cur may be freed by removeProcess
+        next = cur->next;
+
+        // a process that has finished (or that is no longer our child) can be removed
+        if (wait4(cur->pid, &statusCode, WNOHANG, &usage) != 0) {
+            metricsJobFinished(cur->pid, statusCode);
+            eventJobFinished(cur->pid, statusCode, &usage);
+            removeProcess(processList, cur->pid);
+        } else {
+            remaining++;
+        }
+        cur = next;
+    }
+
+    return remaining;
+}
+
+/************************************************************************************
+ * Function to get the number of milliseconds outstanding children are given to exit
+ * after SIGTERM before they are sent SIGKILL
+ *
+ * @return: grace period in milliseconds
+ ***********************************************************************************/
+int getExitGrace() {
+    char *grace = getenv(EXIT_GRACE);
+
+    // use the default if the variable is unset or not a valid non-negative number
+    if (grace == NULL || grace[0] < '0' || grace[0] > '9') {
+        return DEFAULT_EXIT_GRACE;
+    }
+
+    return atoi(grace);
 }
 
 /************************************************************************************
- * Function to exit the shell. It kills all outstanding child processes and frees
- * the memory still in use at time of function call.
+ * Function to exit the shell. It signals all outstanding child processes at once,
+ * collects them as they finish, and kills any that are still running once the grace
+ * period expires. It then frees the memory still in use at time of function call.
  *
  * @param processList: linked list of outstanding processes
  * @param cmd: current command structure to be freed
  ***********************************************************************************/
 void exitProgram(struct processLinkedList *processList, struct command *cmd) {
-    // while there are still outstanding child processes
+    long long start = monotonicNs();
+    int graceMs = getExitGrace(), numJobs = 0, numKilled = 0, statusCode = 0;
+    struct processNode *cur;
+    struct rusage usage;
+
+    // ask every outstanding child process to terminate so they all shut down in
+    // parallel, continuing stopped ones so they can
+    for (cur = processList->head; cur != NULL; cur = cur->next) {
+        kill(cur->pid, SIGTERM);
+        if (cur->isStopped) {
+            kill(cur->pid, SIGCONT);
+        }
+        numJobs++;
+    }
+
+    // collect the children as they finish until none remain or the grace period is up
+    while (reapExited(processList) > 0 && elapsedMs(start) < graceMs) {
+        sleepMs(EXIT_POLL_INTERVAL);
+    }
+
+    // kill any children that ignored SIGTERM and remove them from the list
     while (processList->head){
-        // kill them and remove them from the proc list and process linked list
-        kill(processList->head->pid, SIGTERM);
-        clearFinished(processList->head->pid, 1);
+        kill(processList->head->pid, SIGKILL);
+        wait4(processList->head->pid, &statusCode, 0, &usage);
+        metricsJobFinished(processList->head->pid, statusCode);
+        eventJobFinished(processList->head->pid, statusCode, &usage);
         removeProcess(processList, processList->head->pid);
+        numKilled++;
     }
+
+    // report how long it took to shut down the outstanding children
+    if (numJobs > 0) {
+        queueFormat("shutdown of %d background process(es) took %lld ms (%d killed)\n",
+                    numJobs, elapsedMs(start), numKilled);
+    }
+
     // free the linked list and set it to NULL
     freeProcessList(processList);
+    closeJobState();
 
-    // free the memory for cmd
-    freeCommand(cmd);
+    // free the memory for cmd (there is none if input ran out)
+    if (cmd != NULL) {
+        freeCommand(cmd);
+    }
 
-    // unset environment variables
-    unsetenv(PID);
-    unsetenv(PID_LEN);
-    unsetenv(STATUS);
-    printf("\033[0m\n");
+    // stop publishing metrics and recording, and free the shell variables
+    closeMetrics();
+    closeEvents();
+    closeRecord();
+    freeVariables();
+    queueConstant("\033[0m\n");
+    flushOutput();
 
     // exit the program
     exit(0);
 }
 
+/************************************************************************************
+ * Function to execute a parsed command. Built in commands are run by the shell and
+ * all other commands are run in a forked child process
+ *
+ * @param cmd: command to execute
+ * @param procList: linked list of outstanding processes
+ * @param isForeOnlyMode: pointer to the foreground only flag, updated if the mode is
+ *                        toggled while the command runs
+ ***********************************************************************************/
+void executeCommand(struct command *cmd, struct processLinkedList *procList, int *isForeOnlyMode) {
+    struct forkResult *res;
+    struct shellFunction *func;
+
+    // a function definition only adds the function
+    if (cmd->body != NULL) {
+        defineFunction(cmd);
+        lastExitStatus = 0;
+        return;
+    }
+
+    // check if the command is built into the shell and execute the appropriate
+    // command
+    int builtInRes = isBuiltIn(cmd->args[0]);
+    switch (builtInRes) {
+        case CD_FLAG:
+            lastExitStatus = cd(cmd->args, cmd->numArgs);
+            break;
+        case STATUS_FLAG:
+            showStatus();
+            lastExitStatus = 0;
+            break;
+        case EXIT_FLAG:
+            exitProgram(procList, cmd);
+            break;
+        case BENCH_FLAG:
+            lastExitStatus = bench(cmd);
+            break;
+        case MEM_FLAG:
+            lastExitStatus = showMemStats();
+            break;
+        case ALIAS_FLAG:
+            lastExitStatus = aliasCommand(cmd);
+            break;
+        case UNALIAS_FLAG:
+            lastExitStatus = unaliasCommand(cmd);
+            break;
+        case EXEC_FLAG:
+            lastExitStatus = execRedirects(cmd, procList);
+            break;
+        case EXPORT_FLAG:
+            lastExitStatus = exportCommand(cmd);
+            break;
+        case ASSIGN_FLAG:
+            lastExitStatus = assignCommand(cmd);
+            break;
+        case WATCH_FLAG:
+            lastExitStatus = watchCommand(cmd, procList, isForeOnlyMode);
+            break;
+        case FG_FLAG:
+            lastExitStatus = fgCommand(cmd, procList, isForeOnlyMode);
+            break;
+        case BG_FLAG:
+            lastExitStatus = bgCommand(cmd, procList);
+            break;
+        case TIMEOUT_FLAG:
+            // the timed command may have process substitutions like any other
+            if (startProcSubs(cmd, procList)) {
+                lastExitStatus = timeoutCommand(cmd, procList, isForeOnlyMode);
+            } else {
+                lastExitStatus = 1;
+            }
+            closeProcSubs(cmd);
+            break;
+        default:
+            // functions come before aliases, which come before the PATH. A function
+            // runs in the shell unless it needs a child of its own.
+            func = findFunction(cmd->args[0]);
+            if (func != NULL && !cmd->isBgProcess && cmd->redirs == NULL && cmd->procSubs == NULL) {
+                lastExitStatus = callFunction(cmd, func, procList, isForeOnlyMode);
+                break;
+            } else if (func == NULL && expandAlias(cmd, procList, isForeOnlyMode)) {
+                break;
+            }
+
+            // filter built ins run as a pipeline of one, in the shell given a file
+            if (isFilterStage(cmd)) {
+                runPipeline(cmd, 1, procList, isForeOnlyMode);
+                break;
+            }
+
+            // start the command's process substitutions so their pipes can be passed on
+            if (!startProcSubs(cmd, procList)) {
+                closeProcSubs(cmd);
+                lastExitStatus = 1;
+                break;
+            }
+
+            // if command is not build in process it using fork
+            if (cmd->isBgProcess) { // if it's a background process
+                res = forkBackground(cmd, procList);
+                lastExitStatus = 0;
+            } else {
+                res = forkForeground(cmd, procList, *isForeOnlyMode);
+
+                // save result's foreground only in case it was updated
+                *isForeOnlyMode = res->isForeOnly;
+            }
+            MEM_FREE(res);
+            closeProcSubs(cmd);
+    }
+}
+
+/************************************************************************************
+ * Function to detect if a command in a command list should be skipped because of
+ * the operator joining it to the command before it
+ *
+ * @param op: operator joining the command to the one before it (0 if none)
+ * @param lastExit: exit status of the command before it
+ * @return: TRUE if the command should be skipped
+ ***********************************************************************************/
+int isShortCircuited(int op, int lastExit) {
+    return (op == LIST_AND && lastExit != 0) || (op == LIST_OR && lastExit == 0);
+}
+
+/************************************************************************************
+ * Function to execute a command list in order, skipping commands as && and || require
+ * and making each command's exit status available to the next as $?. The commands of
+ * a pipeline are run together and skipped or not as one.
+ *
+ * @param cmd: first command of the list
+ * @param procList: linked list of outstanding processes
+ * @param isForeOnlyMode: pointer to the foreground only flag
+ ***********************************************************************************/
+void executeList(struct command *cmd, struct processLinkedList *procList, int *isForeOnlyMode) {
+    struct command *last, *stage;
+    int op = 0, numStages;
+
+    while (cmd != NULL) {
+        // find the end of the pipeline the command starts
+        for (last = cmd, numStages = 1; last->nextOp == LIST_PIPE && last->next != NULL; numStages++) {
+            last = last->next;
+        }
+
+        if (!isShortCircuited(op, lastExitStatus)) {
+            if (numStages > 1) {
+                for (stage = cmd; stage != last->next; stage = stage->next) {
+                    expandStatusVars(stage, lastExitStatus);
+                }
+                runPipeline(cmd, numStages, procList, isForeOnlyMode);
+            } else {
+                expandStatusVars(cmd, lastExitStatus);
+                executeCommand(cmd, procList, isForeOnlyMode);
+            }
+        }
+
+        op = last->nextOp;
+        cmd = last->next;
+    }
+}
+
+/************************************************************************************
+ * Function to fork a child process to run a command as a job of its own. The child
+ * joins the job's process group (taking the terminal if it is run in the foreground),
+ * loads the handlers for its process state, opens any redirect files, and executes
+ * the command. It never returns, exiting with value 1 if the command could not be
+ * executed.
+ *
+ * @param cmd: command for the child process to perform
+ * @param resolved: full path of the command from resolveCommand (or NULL)
+ * @param processMask: process state flags to load the child's handlers with
+ * @return: pid of the child or -1 if the fork failed
+ ***********************************************************************************/
+pid_t spawnCommand(struct command *cmd, char *resolved, int processMask) {
+    // write queued output so it comes before anything the child prints
+    flushOutput();
+
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        joinJob(getpid(), getpid(), processMask & FOREGROUND);
+        loadHandlers(processMask);
+
+        // if files could be opened execute command (or the function by its name)
+        if (openRedirFiles(cmd)) {
+            if (findFunction(cmd->args[0]) != NULL) {
+                runFunction(findFunction(cmd->args[0]));
+            }
+            execCommand(cmd, resolved);
+            printf("%s: no such file or directory\n", cmd->args[0]);
+            fflush(stdout);
+        }
+        _exit(1);
+    } else if (pid > 0) {
+        joinJob(pid, pid, processMask & FOREGROUND);
+    } else {
+        queueConstant("Error forking process\n");
+        metricsSpawnFailed();
+    }
+
+    return pid;
+}
+
 /************************************************************************************
  * Function to fork a foreground child process.
  *
  * @param cmd: command for the child process to perform
  * @param isForeOnlyMode: is the shell in foreground-only mode
- * @return: pid of the current process (used in calling function in case of errors)
+ * @return: pid of the child process and the (possibly toggled) foreground only flag
  ***********************************************************************************/
 struct forkResult *forkForeground(struct command *cmd, struct processLinkedList *procList, int isForeOnlyMode) {
-    // fork the process
-    int pid = fork();
+    // look up the command on the PATH before forking so the result stays cached
+    char *resolved = findFunction(cmd->args[0]) ? NULL : resolveCommand(cmd->args[0]);
+
+    // fork the process, the child loads foreground handlers and runs the command
+    int pid = spawnCommand(cmd, resolved, FOREGROUND | CHILD);
 
     // create and initialize variable to save the results of this forked proces
-    struct forkResult *res = calloc(1, sizeof(struct forkResult));
+    struct forkResult *res = MEM_CALLOC(MEM_JOBS, 1, sizeof(struct forkResult));
     res->pid = pid;
     res->isForeOnly = isForeOnlyMode;
 
-    if (pid < 0) { // error
-        printf("Error forking process");
-        fflush(stdout);
+    if (pid > 0) { // parent
+        metricsJobStarted(pid, cmd, JOB_FOREGROUND);
+        eventJobStarted(pid, cmd, FALSE);
 
-    } else if (pid > 0) { // parent
-        // loop until clear finish completes successfully
-        while (clearFinished(pid, 0) == -1);
+        // wait for the child while servicing the background jobs' deadlines, then
+        // loop until clear finish completes successfully. A child stopped by ^Z is
+        // kept as a background job instead.
+        if (waitForeground(pid, NULL, procList)) {
+            stopJob(procList, pid, pid, cmd, FALSE);
+        } else {
+            while (clearFinished(pid, 0) == -1);
+        }
+        reclaimTerminal();
         // check for toggle flag and toggle mode if so
         if (toggleFgMode){
             applyFgOnlyToggle(&isForeOnlyMode);
             res->isForeOnly = isForeOnlyMode;
         }
-
-        // clear any finished background processes before presenting the next
-        // command line prompt
-        nonBlockClearFinished(procList);
-
-        printPrompt();
-
-    } else { // child
-        // load child handlers open io redirect files if necessary and execute the command
-        loadHandlers(FOREGROUND | CHILD);
-
-        // if files could be opened execute command
-        if (openRedirFiles(cmd)){
-            execvp(cmd->args[0], cmd->args);
-            printf("%s: no such file or directory\n", cmd->args[0]);
-            fflush(stdout);
-        }
     }
 
-    // return result of fork for parent always, and child if there was an error
     return res;
 }
 
@@ -185,49 +601,32 @@ struct forkResult *forkForeground(struct command *cmd, struct processLinkedList
  *
  * @param cmd: command for the child process to perform
  * @param processList: linked list of outstanding processes
- * @return: pid of the current process (used in calling function in case of errors)return
+ * @return: pid of the child process
  ***********************************************************************************/
 struct forkResult * forkBackground(struct command *cmd, struct processLinkedList *processList) {
-    // fork process
-    int pid = fork();
+    // look up the command on the PATH before forking so the result stays cached
+    char *resolved = findFunction(cmd->args[0]) ? NULL : resolveCommand(cmd->args[0]);
+
+    // fork process, the child loads background handlers and runs the command
+    int pid = spawnCommand(cmd, resolved, BACKGROUND | CHILD);
 
     // create and initialize variable to save the results of this forked proces
-    struct forkResult *res = calloc(1, sizeof(struct forkResult));
+    struct forkResult *res = MEM_CALLOC(MEM_JOBS, 1, sizeof(struct forkResult));
     res->pid = pid;
     res->isForeOnly = 0;
 
-    if (pid < 0) {
-        printf("Error forking process");
-        fflush(stdout);
-
-    } else if (pid > 0) {  // parent
-        // add process to process linked list and clear any finished processes
+    if (pid > 0) {  // parent
+        // add process to process linked list and display pid of child process
         addProcess(processList, pid);
-        nonBlockClearFinished(processList);
-        int i = 0;
-        while (i < 200)
-            i++;
-    } else { // child
-        // load handlers, display pid of child process, open any files necessary
-        // for io redirection, and perform the command
-        loadHandlers(BACKGROUND | CHILD);
-        printf("backround pid is %d\n", getpid());
-        fflush(stdout);
-
-        // clear any finished background processes before presenting the next
-        // command line prompt
-        nonBlockClearFinished(processList);
-
-        printPrompt();
-        // if files could be opened execute command
-        if (openRedirFiles(cmd)) {
-            execvp(cmd->args[0], cmd->args);
-            printf("%s: no such file or directory\n", cmd->args[0]);
-            fflush(stdout);
-        }
+        setProcessCommand(processList->tail, cmd);
+        saveJobState(processList);
+        metricsJobStarted(pid, cmd, JOB_BACKGROUND);
+        eventJobStarted(pid, cmd, TRUE);
+        queueConstant("background pid is ");
+        queueInt(pid);
+        queueConstant("\n");
     }
 
-    // return result of fork for parent always, and child if there was an error
     return res;
 }
 
@@ -244,18 +643,50 @@ void addProcess(struct processLinkedList *procList, int pid) {
 
     // if tail is not null then add a new node to the end of the list
     if (tail != NULL) {
-        tail->next = calloc(1, sizeof(struct processNode));
+        tail->next = MEM_CALLOC(MEM_JOBS, 1, sizeof(struct processNode));
         procList->tail = tail->next;
 
     // if tail is null then list was empty so add new node to start/end of list
     } else {
-        tail = calloc(1, sizeof(struct processNode));
+        tail = MEM_CALLOC(MEM_JOBS, 1, sizeof(struct processNode));
         procList->head = tail;
         procList->tail = tail;
     }
 
-    // set the new node's pid
+    // set the new node's pid, which is also its job's process group by default
     procList->tail->pid = pid;
+    procList->tail->pidFd = -1;
+    procList->tail->pgid = jobControl == JOBS_NONE ? 0 : pid;
+    promptJobsChanged(procList);
+}
+
+/************************************************************************************
+ * Function to save the command line of a job in its process node, truncated to
+ * JOB_CMD_LEN characters
+ *
+ * @param node: process node of the job
+ * @param cmd: command the job is running
+ ***********************************************************************************/
+void setProcessCommand(struct processNode *node, struct command *cmd) {
+    int i, len = 0;
+
+    node->command[0] = '\0';
+    for (i = 0; i < cmd->numArgs && len < JOB_CMD_LEN - 1; i++) {
+        len += snprintf(node->command + len, JOB_CMD_LEN - len, i ? " %s" : "%s", cmd->args[i]);
+    }
+}
+
+/************************************************************************************
+ * Function to free a process node along with its timer and pidfd
+ *
+ * @param node: process node to free
+ ***********************************************************************************/
+void freeProcessNode(struct processNode *node) {
+    freeTimeout(node->timeout);
+    if (node->pidFd != -1) {
+        close(node->pidFd);
+    }
+    MEM_FREE(node);
 }
 
 /************************************************************************************
@@ -280,7 +711,9 @@ int removeProcess(struct processLinkedList *procList, int pid) {
             } else {
                 procList->head = procList->head->next;
             }
-            free(cur);
+            freeProcessNode(cur);
+            saveJobState(procList);
+            promptJobsChanged(procList);
             return TRUE;
 
         // otherwise search the list for the matching node and remove/free it
@@ -294,7 +727,9 @@ int removeProcess(struct processLinkedList *procList, int pid) {
                         procList->tail = cur;
                     }
                     cur->next = cur->next->next;
-                    free(temp);
+                    freeProcessNode(temp);
+                    saveJobState(procList);
+                    promptJobsChanged(procList);
                     return TRUE;
                 } else {
                     cur = cur->next;
@@ -306,73 +741,245 @@ int removeProcess(struct processLinkedList *procList, int pid) {
 }
 
 /************************************************************************************
- * Function to open a file necessary for io redirection and redirect io accordingly
+ * Function to find a process in the outstanding child process list
  *
- * @param cmd: command struct containing all relevant information about the command
- *             to be executed
- * @param isOutput: indicates whether the file is an output file or not
- * return: flag indicating whether the open operation was successful
+ * @param procList: linked list of outstanding processes
+ * @param pid: pid of the process to find
+ * @return: the process's node or NULL if it is not in the list
+ ***********************************************************************************/
+struct processNode *findProcess(struct processLinkedList *procList, int pid) {
+    struct processNode *cur;
+
+    for (cur = procList->head; cur != NULL; cur = cur->next) {
+        if (cur->pid == pid) {
+            return cur;
+        }
+    }
+
+    return NULL;
+}
+
+/************************************************************************************
+ * Function run in the child of a process substitution to run the substituted list
+ * with its end of the pipe as stdout (for <(list)) or stdin (for >(list)). A single
+ * external command is executed directly, anything else is run by this copy of the
+ * shell. Never returns.
+ *
+ * @param cmd: command the substitution is an argument of
+ * @param sub: the process substitution
+ * @param pipeEnd: the substituted list's end of the pipe
  ***********************************************************************************/
-int openRedirFile(struct command *cmd, int isOutput) {
+void runProcSub(struct command *cmd, struct procSub *sub, int pipeEnd) {
+    struct processLinkedList subProcs = {NULL, NULL};
+    struct processNode *node;
+    struct procSub *cur;
+    struct command *list = sub->list;
+    int isForeOnlyMode = TRUE;
+
+    // the substitution is a quiet job of its own
+    joinJob(getpid(), getpid(), FALSE);
+    loadHandlers(BACKGROUND | CHILD);
+    dup2(pipeEnd, sub->type == PROCSUB_IN ? STDOUT_FILENO : STDIN_FILENO);
+
+    // the shell's ends of the other substitutions must not be held open by this one
+    for (cur = cmd->procSubs; cur != NULL; cur = cur->next) {
+        if (cur->fd != -1) {
+            close(cur->fd);
+        }
+    }
+
+    if (list->next == NULL && list->procSubs == NULL && !isBuiltIn(list->args[0]) &&
+        !isDefined(list->args[0]) && list->body == NULL) {
+        if (openRedirFiles(list)) {
+            execCommand(list, resolveCommand(list->args[0]));
+            printf("%s: no such file or directory\n", list->args[0]);
+            fflush(stdout);
+        }
+        _exit(1);
+    }
+
+    // only the shell publishes metrics, events and prompts
+    detachMetrics();
+    detachEvents();
+    showPrompt = FALSE;
+    executeList(list, &subProcs, &isForeOnlyMode);
+    flushOutput();
+
+    // reap this copy's own substitutions as the shell will not see them
+    for (node = subProcs.head; node != NULL; node = node->next) {
+        if (node->isQuiet) {
+            while (waitpid(node->pid, NULL, 0) == -1 && errno == EINTR);
+        }
+    }
+    _exit(lastExitStatus);
+}
+
+/************************************************************************************
+ * Function to start each process substitution of a command. Every substitution gets
+ * a pipe whose other end is left open for the command, and the substitution's arg is
+ * replaced by the /dev/fd path of that end. The children are reaped quietly along
+ * with the background processes.
+ *
+ * @param cmd: command about to be run
+ * @param procList: linked list of outstanding processes
+ * @return: FALSE if a substitution could not be started
+ ***********************************************************************************/
+int startProcSubs(struct command *cmd, struct processLinkedList *procList) {
+    struct procSub *sub;
+    int pipeFds[2], shellEnd, subEnd;
+    char path[32], **target;
+    pid_t pid;
+
+    for (sub = cmd->procSubs; sub != NULL; sub = sub->next) {
+        if (pipe2(pipeFds, O_CLOEXEC) == -1) {
+            queueConstant("Error creating pipe\n");
+            return FALSE;
+        }
+        shellEnd = sub->type == PROCSUB_IN ? pipeFds[0] : pipeFds[1];
+        subEnd = sub->type == PROCSUB_IN ? pipeFds[1] : pipeFds[0];
+
+        // the command's copy of the shell's end stays open across exec, above the file
+        // descriptors its redirections can replace
+        sub->fd = fcntl(shellEnd, F_DUPFD, SHELL_MIN_FD);
+        close(shellEnd);
+
+        flushOutput();
+        pid = fork();
+        if (pid == 0) {
+            runProcSub(cmd, sub, subEnd);
+        }
+        close(subEnd);
+
+        if (pid > 0) {
+            joinJob(pid, pid, FALSE);
+            addProcess(procList, pid);
+            procList->tail->isQuiet = TRUE;
+        }
+
+        if (pid < 0 || sub->fd == -1) {
+            queueConstant("Error forking process\n");
+            metricsSpawnFailed();
+            return FALSE;
+        }
+
+        // the pipe's path replaces the placeholder arg or redirection file
+        sprintf(path, "/dev/fd/%d", sub->fd);
+        target = sub->redir != NULL ? &sub->redir->target : &cmd->args[sub->argIdx];
+        MEM_FREE(*target);
+        *target = MEM_CALLOC(MEM_PARSER, strlen(path) + 1, sizeof(char));
+        strcpy(*target, path);
+    }
+
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to close the shell's ends of a command's process substitution pipes once
+ * the command has been started with them
+ *
+ * @param cmd: the command
+ ***********************************************************************************/
+void closeProcSubs(struct command *cmd) {
+    struct procSub *sub;
+
+    for (sub = cmd->procSubs; sub != NULL; sub = sub->next) {
+        if (sub->fd != -1) {
+            close(sub->fd);
+            sub->fd = -1;
+        }
+    }
+}
+
+/************************************************************************************
+ * Function to open the file of a redirection
+ *
+ * @param redir: redirection with a file target
+ * return: the opened file descriptor or -1 if the file could not be opened
+ ***********************************************************************************/
+int openRedirFile(struct redirection *redir) {
     int flags = 0, perms = 0750;
-    char *fileName;
 
-    // set flags based on whether opening for input or output
-    if (!isOutput) {
+    // set flags based on the kind of redirection
+    if (redir->type == REDIR_IN) {
         flags = O_RDONLY;
-        fileName = cmd->infile;
+    } else if (redir->type == REDIR_APPEND) {
+        flags = O_WRONLY | O_APPEND | O_CREAT;
     } else {
         flags = O_WRONLY | O_TRUNC | O_CREAT;
-        fileName = cmd->outfile;
     }
 
-    // open the file
-    int fd = open(fileName, flags, perms);
+    // open the file, setting it to close when the exec call is finished with it
+    int fd = open(redir->target, flags | O_CLOEXEC, perms);
 
     if (fd == -1){  //error state
-        // print appropriate error message and exit with value 1
-        printf("cannot open %s for ", fileName);
-        if (isOutput){
-            printf("output\n");
-        } else {
-            printf("input\n");
-        }
+        // print appropriate error message
+        printf("cannot open %s for %s\n", redir->target, redir->type == REDIR_IN ? "input" : "output");
         fflush(stdout);
-        return FALSE;
-
-    } else {   // success state
-        // redirect input or output to the opened file based on whether is output
-        // is true ( == 1) or false ( == 0), then set it to close when the exec
-        // call is finished with it
-        dup2(fd, isOutput);
-        fcntl(fd, F_SETFD, FD_CLOEXEC);
     }
 
-    return TRUE;
+    return fd;
 }
 
 /************************************************************************************
- * Function to open files for io redirection if required for the current command
+ * Function to apply a single redirection to the current process
+ *
+ * @param redir: the redirection to apply
+ * return: flag indicating whether the redirection was successful
+ ***********************************************************************************/
+int applyRedirect(struct redirection *redir) {
+    int fd;
+
+    switch (redir->type) {
+        case REDIR_CLOSE:
+            close(redir->fd);
+            return TRUE;
+        case REDIR_DUP:
+            // copy the file descriptor, which must already be open
+            if (fcntl(redir->dupFd, F_GETFD) == -1 || dup2(redir->dupFd, redir->fd) == -1) {
+                printf("%d: bad file descriptor\n", redir->dupFd);
+                fflush(stdout);
+                return FALSE;
+            }
+            return TRUE;
+        default:
+            if ((fd = openRedirFile(redir)) == -1) {
+                return FALSE;
+            }
+
+            // the copy made by dup2 stays open across exec
+            if (fd != redir->fd) {
+                dup2(fd, redir->fd);
+                close(fd);
+            } else {
+                fcntl(fd, F_SETFD, 0);
+            }
+            return TRUE;
+    }
+}
+
+/************************************************************************************
+ * Function to apply each io redirection of the current command in order. If a file
+ * descriptor is redirected to more than one file the output is fanned out to all
+ * of them.
  *
  * @param cmd: struct containing information about current command
  * return: status flag indicating whether the operation was successful
  ***********************************************************************************/
 int openRedirFiles(struct command *cmd) {
-    int res = TRUE;  // status flag used to indicate if opening files was successful
+    struct redirection *cur;
 
-    // if cmd has an infile index set then it needs an input file open for redirection
-    if (cmd->hasInfile) {
-        // open file for input redirection
-        res &= openRedirFile(cmd, FALSE);
+    // fanned out output is copied by a helper process
+    if (needsFanOut(cmd)) {
+        return startFanOut(cmd);
     }
 
-    // if cmd has an outfile index set then it needs an output file open for redirection
-    if(cmd->hasOutfile && res) {
-        // open file for output redirection
-        res &= openRedirFile(cmd, TRUE);
+    for (cur = cmd->redirs; cur != NULL; cur = cur->next) {
+        if (!applyRedirect(cur)) {
+            return FALSE;
+        }
     }
 
-    return res;
+    return TRUE;
 }
 
 /************************************************************************************
@@ -408,12 +1015,12 @@ void freeProcessList(struct processLinkedList *procList) {
         // while cur free it and move to next
         while (cur != NULL) {
             cur = cur->next;
-            free(procList->head);
+            freeProcessNode(procList->head);
             procList->head = cur;
         }
 
         // free the linked list struct
-        free(procList);
+        MEM_FREE(procList);
     }
 }
 
@@ -421,7 +1028,10 @@ void freeProcessList(struct processLinkedList *procList) {
  * Function to print the prompt for the next command line of the shell
  ***********************************************************************************/
 void printPrompt() {
-    // print command line indicator
-    printf("\033[92m: \033[96m");
-    fflush(stdout);
+    if (!showPrompt) {
+        return;
+    }
+
+    // queue command line indicator (written when the shell next waits for input)
+    queuePrompt();
 }
\ No newline at end of file
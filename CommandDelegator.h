@@ -16,6 +16,10 @@
 
 #include "CommandParser.h"
 #include "InterruptHandlers.h"  // circular dependency issue
+#include "Utils.h"
+#include "PathCache.h"
+#include "Metrics.h"
+#include "Output.h"
 
 // flags for processes in the shell
 #define CHILD 1
@@ -24,11 +28,27 @@
 #define BACKGROUND 8
 #define FOREGROUND_ONLY 16
 
+// settings for shutting down outstanding children when the shell exits
+#define EXIT_GRACE "SMALLSH_EXIT_GRACE"  // env var to override the grace period (ms)
+#define DEFAULT_EXIT_GRACE 2000
+#define EXIT_POLL_INTERVAL 5
+
+// length of the command line kept for each job
+#define JOB_CMD_LEN 64
+
 extern volatile sig_atomic_t toggleFgMode;
+extern int showPrompt;
+extern int lastExitStatus;
 
 // structure to create a node for a linked list of still active child processes
 struct processNode {
     pid_t pid;
+    int isQuiet;  // set for process substitutions, which are reaped without a notice
+    struct jobTimeout *timeout;  // deadline set by the timeout built in (or NULL)
+    int pidFd;                   // pidfd of a job adopted from another shell (-1 otherwise)
+    pid_t pgid;                  // process group of the job (0 without job control)
+    int isStopped;               // set while the job is stopped
+    char command[JOB_CMD_LEN];   // command line of the job, for reporting
     struct processNode *next;
 };
 
@@ -44,14 +64,30 @@ struct forkResult {
 };
 
 int clearFinished(pid_t targetProcess, int hideStatus);
+void formatStatus(int statusCode, char *dest);
+int statusToExitCode(int statusCode);
 void nonBlockClearFinished(struct processLinkedList *processList);
 void addProcess(struct processLinkedList *procList, int pid);
+void setProcessCommand(struct processNode *node, struct command *cmd);
+void freeProcessNode(struct processNode *node);
 int removeProcess(struct processLinkedList *procList, int pid);
+struct processNode *findProcess(struct processLinkedList *procList, int pid);
+void runProcSub(struct command *cmd, struct procSub *sub, int pipeEnd);
+int startProcSubs(struct command *cmd, struct processLinkedList *procList);
+void closeProcSubs(struct command *cmd);
 int openRedirFiles(struct command *cmd);
-int openRedirFile(struct command *cmd, int isOutput);
-void cd(char **args, int numArgs);
+int openRedirFile(struct redirection *redir);
+int applyRedirect(struct redirection *redir);
+int cd(char **args, int numArgs);
+int execRedirects(struct command *cmd, struct processLinkedList *procList);
 void showStatus();
+int reapExited(struct processLinkedList *processList);
+int getExitGrace();
 void exitProgram(struct processLinkedList *processList, struct command *cmd);
+void executeCommand(struct command *cmd, struct processLinkedList *procList, int *isForeOnlyMode);
+int isShortCircuited(int op, int lastExit);
+void executeList(struct command *cmd, struct processLinkedList *procList, int *isForeOnlyMode);
+pid_t spawnCommand(struct command *cmd, char *resolved, int processMask);
 struct forkResult *forkForeground(struct command *cmd, struct processLinkedList *procList, int isForeOnlyMode);
 struct forkResult * forkBackground(struct command *cmd, struct processLinkedList *processList); // todo add status, change to processLinkedList, remove cur
 
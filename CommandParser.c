@@ -1,5 +1,9 @@
 #include "CommandParser.h"
 #include "CommandDelegator.h"
+#include "Variables.h"
+
+// flag to allow variable expansion to be deferred (used when compiling scripts)
+static int expandEnabled = TRUE;
 
 /*************************************************************************************
  * Function to detect if the received command is one of the built in commands
@@ -22,6 +26,50 @@ int isBuiltIn(char *command) {
         commandVal += EXIT_FLAG;
     }
 
+    if (strcmp(command, "bench") == 0) {
+        commandVal += BENCH_FLAG;
+    }
+
+    if (strcmp(command, "mem") == 0) {
+        commandVal += MEM_FLAG;
+    }
+
+    if (strcmp(command, "timeout") == 0) {
+        commandVal += TIMEOUT_FLAG;
+    }
+
+    if (strcmp(command, "alias") == 0) {
+        commandVal += ALIAS_FLAG;
+    }
+
+    if (strcmp(command, "unalias") == 0) {
+        commandVal += UNALIAS_FLAG;
+    }
+
+    if (strcmp(command, "exec") == 0) {
+        commandVal += EXEC_FLAG;
+    }
+
+    if (strcmp(command, "export") == 0) {
+        commandVal += EXPORT_FLAG;
+    }
+
+    if (strcmp(command, "watch") == 0) {
+        commandVal += WATCH_FLAG;
+    }
+
+    if (strcmp(command, "fg") == 0) {
+        commandVal += FG_FLAG;
+    }
+
+    if (strcmp(command, "bg") == 0) {
+        commandVal += BG_FLAG;
+    }
+
+    if (isAssignment(command)) {
+        commandVal += ASSIGN_FLAG;
+    }
+
     return commandVal;
 }
 
@@ -36,45 +84,202 @@ int isWhitespace(char c) {
 }
 
 /*************************************************************************************
- * Function to parse the command line and load the information into a command struct
- * for use in the main loop of the shell
+ * Function to parse a command line and load the information into a list of command
+ * structs for use in the main loop of the shell
  *
- * @param input: raw command line input
+ * @param input: raw command line input (modified in place)
  * @param args: array of character pointers to hold the arguments
  * @param isForeOnlyMode: int value indicating whether current operation mode is
  *      foreground only mode or not
- * @return: a filled command struct of NULL if command line is empty or a comment
+ * @return: the first command of the filled command list or NULL if command line is
+ *      empty, a comment, or invalid
  ************************************************************************************/
 struct command *parseInput(char *input, char **args, int isForeOnlyMode) {
-    size_t len = 2048;
-    gets(input);
-    int numArg = stripWhiteSpace(input, args);;
+    int numArg = stripWhiteSpace(input, args);
 
     // if cmd is blank or a comment skip this process
     if (numArg == 0 || args[0][0] == '#'){
         return NULL;
     }
 
-    // create the command structure and set the file indices to invalid settings
-    struct command *parsedCommand = calloc(1, sizeof(struct command));
-    parsedCommand->hasOutfile = FALSE;
-    parsedCommand->hasInfile = FALSE;
+    return parseCommandList(args, numArg, isForeOnlyMode);
+}
+
+/*************************************************************************************
+ * Function to detect if an argument is one of the operators joining a command list
+ *
+ * @param arg: argument to check
+ * @return: the LIST_ value of the operator or 0 if the argument is not an operator
+ ************************************************************************************/
+int listOperator(char *arg) {
+    if (strcmp(arg, ";") == 0) {
+        return LIST_SEQUENCE;
+    } else if (strcmp(arg, "&&") == 0) {
+        return LIST_AND;
+    } else if (strcmp(arg, "||") == 0) {
+        return LIST_OR;
+    } else if (strcmp(arg, "|") == 0) {
+        return LIST_PIPE;
+    }
+
+    return 0;
+}
+
+/*************************************************************************************
+ * Function to split the arguments of a command line into commands at each list
+ * operator and parse each one. The operator's slot in args becomes the terminating
+ * NULL of the command before it so every command shares the one args array. A
+ * pipeline run in the background reads from and writes to /dev/null at its ends
+ * unless redirected.
+ *
+ * @param args: array of unparsed arguments
+ * @param numArgs: number of arguments
+ * @param isForeOnlyMode: flag for foreground only mode
+ * @return: the first command of the list or NULL if the list is invalid
+ ************************************************************************************/
+struct command *parseCommandList(char **args, int numArgs, int isForeOnlyMode) {
+    struct command *head = NULL, *tail = NULL, *cur, *pipeStart = NULL;
+    int i, op, end, isDetached, start = 0;
 
-    // strip the whitespace from the raw command and set the number of args
-    parsedCommand->numArgs = numArg;
+    for (i = 0; i <= numArgs; i++) {
+        // operators inside a process substitution belong to the substituted list
+        if (i < numArgs && isProcSubStart(args[i]) && (end = procSubEnd(args, i, numArgs)) != -1) {
+            i = end;
+            continue;
+        }
+
+        // as do the operators in the body of a function definition
+        if (i == start && i < numArgs && isFunctionStart(args, i, numArgs) &&
+            (end = functionEnd(args, i, numArgs)) != -1) {
+            i = end;
+            continue;
+        }
+
+        // continue until the end of the current command
+        op = i < numArgs ? listOperator(args[i]) : 0;
+        if (i < numArgs && !op) {
+            continue;
+        }
+
+        // a command can only be empty after a trailing ;
+        if (i == start) {
+            if (i == numArgs && tail != NULL && tail->nextOp == LIST_SEQUENCE) {
+                tail->nextOp = 0;
+                break;
+            }
+
+            queueFormat("syntax error near %s\n", i < numArgs ? args[i] : "end of line");
+            if (head != NULL) {
+                freeCommand(head);
+            }
+            return NULL;
+        }
+
+        // terminate the command's arguments and parse it
+        if (i < numArgs) {
+            args[i] = NULL;
+        }
+        isDetached = strcmp(args[i - 1], "&") == 0;
+        cur = parseCommand(args + start, i - start, isForeOnlyMode);
+        if (cur == NULL) {
+            if (head != NULL) {
+                freeCommand(head);
+            }
+            return NULL;
+        }
+        cur->nextOp = op;
+
+        // add the command to the end of the list
+        if (tail == NULL) {
+            head = cur;
+        } else {
+            tail->next = cur;
+        }
+        tail = cur;
+        start = i + 1;
+
+        // a trailing & applies to the whole pipeline the command ends
+        if (pipeStart == NULL) {
+            pipeStart = cur;
+        }
+        if (op != LIST_PIPE) {
+            if (isDetached) {
+                setNullRedirects(pipeStart, cur);
+            }
+            pipeStart = NULL;
+        }
+    }
+
+    return head;
+}
+
+/*************************************************************************************
+ * Function to load the information for a single command into a command struct
+ *
+ * @param args: array of the command's unparsed arguments
+ * @param numArgs: number of arguments
+ * @param isForeOnlyMode: flag for foreground only mode
+ * @return: a filled command struct or NULL if there is no command to run
+ ************************************************************************************/
+struct command *parseCommand(char **args, int numArgs, int isForeOnlyMode) {
+    // create the command structure
+    struct command *parsedCommand = MEM_CALLOC(MEM_PARSER, 1, sizeof(struct command));
+
+    // function definitions are parsed separately from simple commands
+    if (isFunctionStart(args, 0, numArgs)) {
+        MEM_FREE(parsedCommand);
+        return parseFunction(args, numArgs, isForeOnlyMode);
+    }
+
+    // set the number of args
+    parsedCommand->numArgs = numArgs;
     parsedCommand->args = args;
 
     // parse each arg, performing variable expansion as necessary
-    parseAllArgs(args, parsedCommand, isForeOnlyMode);
+    if (!parseAllArgs(args, parsedCommand, isForeOnlyMode)) {
+        freeCommand(parsedCommand);
+        return NULL;
+    }
+
+    // a command made up only of redirections has nothing to run
+    if (parsedCommand->numArgs == 0) {
+        queueConstant("syntax error: missing command\n");
+        freeCommand(parsedCommand);
+        return NULL;
+    }
+
+    // assignments before the command's name are set aside for its environment
+    parseAssignments(parsedCommand);
+
     // if the command is echo, make it print purple
     if (strcmp(parsedCommand->args[0], "echo") == 0) echoModifier(parsedCommand);
 
     return parsedCommand;
 }
 
+/*************************************************************************************
+ * Function to detect if the raw input has a list operator (;, && or ||) at a position,
+ * whether or not it is a word of its own
+ *
+ * @param input: raw input at the position
+ * @return: the operator's word, or NULL if there is no operator there
+ ************************************************************************************/
+char *attachedOperator(char *input) {
+    if (input[0] == ';') {
+        return ";";
+    } else if (input[0] == '&' && input[1] == '&') {
+        return "&&";
+    } else if (input[0] == '|' && input[1] == '|') {
+        return "||";
+    }
+
+    return NULL;
+}
+
 /*************************************************************************************
  * Function to strip the whitespace from the raw input and load pointers to the first
- * characters of each arg into the argument array
+ * characters of each arg into the argument array. The list operators ;, && and || are
+ * split off the words they are attached to, so `a;b` is three args like `a ; b`.
  *
  * @param input: raw input
  * @param args: array of character pointers to hold the arguments
@@ -82,11 +287,22 @@ struct command *parseInput(char *input, char **args, int isForeOnlyMode) {
  ************************************************************************************/
 int stripWhiteSpace(char *input, char **args) {
     int i, ptrIdx = 0, newArg = 1, length = strlen(input);
+    char *op;
+
     // iterate through the input
-    for (i = 0; i < length; i++) {
+    for (i = 0; i < length && ptrIdx < MAX_ARGS - 1; i++) {
+        // an operator becomes an arg of its own, ending the arg before it. Its
+        // characters are cleared so they terminate that arg.
+        if ((op = attachedOperator(input + i)) != NULL) {
+            args[ptrIdx] = op;
+            ptrIdx++;
+            memset(input + i, 0, strlen(op));
+            i += strlen(op) - 1;
+            newArg = TRUE;
+
         // if it's not whitespace and the newArg flag is set, set the next pointer for
         // args
-        if (!isWhitespace(input[i]) && newArg) {
+        } else if (!isWhitespace(input[i]) && newArg) {
             args[ptrIdx] = input + i;
             newArg = FALSE;
             ptrIdx++;
@@ -102,61 +318,472 @@ int stripWhiteSpace(char *input, char **args) {
     return ptrIdx;
 }
 
+/*************************************************************************************
+ * Function to detect if a raw argument starts a process substitution
+ *
+ * @param arg: the raw argument
+ * @return: TRUE if the argument starts with <( or >(
+ ************************************************************************************/
+int isProcSubStart(char *arg) {
+    return (arg[0] == '<' || arg[0] == '>') && arg[1] == '(';
+}
+
+/*************************************************************************************
+ * Function to find the raw argument that ends a process substitution. Substitutions
+ * may be nested, each closed by a ) at the end of an argument.
+ *
+ * @param args: array of raw arguments
+ * @param start: index of the argument starting the substitution
+ * @param numArgs: number of arguments
+ * @return: index of the argument ending the substitution or -1 if it is not closed
+ ************************************************************************************/
+int procSubEnd(char **args, int start, int numArgs) {
+    int i, depth = 0;
+    char *c;
+
+    for (i = start; i < numArgs; i++) {
+        if (isProcSubStart(args[i])) {
+            depth++;
+        }
+
+        // each ) at the end of the argument closes the innermost open substitution
+        for (c = args[i] + strlen(args[i]) - 1; c >= args[i] && *c == ')' && depth > 0; c--) {
+            depth--;
+        }
+
+        if (depth == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*************************************************************************************
+ * Function to parse a process substitution into its own command list and add it to
+ * a command. The substituted list gets its own args array holding the raw arguments
+ * between the parentheses.
+ *
+ * @param args: array of raw arguments (the closing ) is removed in place)
+ * @param start: index of the argument starting the substitution
+ * @param end: index of the argument ending the substitution
+ * @param cmd: command the substitution is an argument of
+ * @param argIdx: index of the command's arg that the substitution replaces
+ * @param isForeOnlyMode: flag for foreground only mode
+ * @return: the process substitution or NULL if the substituted list is not valid
+ ************************************************************************************/
+struct procSub *parseProcSub(char **args, int start, int end, struct command *cmd, int argIdx, int isForeOnlyMode) {
+    struct procSub *sub = MEM_CALLOC(MEM_PARSER, 1, sizeof(struct procSub));
+    int i, numInner = 0;
+    char *arg;
+
+    sub->type = args[start][0] == '<' ? PROCSUB_IN : PROCSUB_OUT;
+    sub->argIdx = argIdx;
+    sub->fd = -1;
+    sub->args = MEM_CALLOC(MEM_PARSER, end - start + 2, sizeof(char *));
+
+    // take the arguments without the opening <( and the closing )
+    args[end][strlen(args[end]) - 1] = '\0';
+    for (i = start; i <= end; i++) {
+        arg = i == start ? args[i] + 2 : args[i];
+        if (*arg != '\0') {
+            sub->args[numInner++] = arg;
+        }
+    }
+
+    if (numInner == 0) {
+        queueConstant("syntax error: empty process substitution\n");
+    } else {
+        sub->list = parseCommandList(sub->args, numInner, isForeOnlyMode);
+    }
+
+    if (sub->list == NULL) {
+        MEM_FREE(sub->args);
+        MEM_FREE(sub);
+        return NULL;
+    }
+
+    addProcSub(cmd, sub);
+    return sub;
+}
+
+/*************************************************************************************
+ * Function to add a process substitution to the end of a command's substitutions
+ *
+ * @param cmd: the command
+ * @param sub: the process substitution
+ ************************************************************************************/
+void addProcSub(struct command *cmd, struct procSub *sub) {
+    struct procSub **link = &cmd->procSubs;
+
+    while (*link != NULL) {
+        link = &(*link)->next;
+    }
+    *link = sub;
+}
+
+/*************************************************************************************
+ * Function to detect if the raw arguments at a position start a function definition,
+ * either "name() {" or "function name {" (or "function name() {")
+ *
+ * @param args: array of raw arguments
+ * @param start: index of the first argument of the command
+ * @param numArgs: number of arguments
+ * @return: number of arguments before the body's opening { or 0 if it's not a
+ *      function definition
+ ************************************************************************************/
+int isFunctionStart(char **args, int start, int numArgs) {
+    int len = strlen(args[start]);
+
+    if (len > 2 && strcmp(args[start] + len - 2, "()") == 0 && start + 1 < numArgs &&
+        strcmp(args[start + 1], "{") == 0) {
+        return 1;
+    }
+
+    if (strcmp(args[start], "function") == 0 && start + 2 < numArgs &&
+        strcmp(args[start + 2], "{") == 0) {
+        return 2;
+    }
+
+    return 0;
+}
+
+/*************************************************************************************
+ * Function to find the raw argument that closes the body of a function definition.
+ * The body's braces must be arguments of their own and may be nested.
+ *
+ * @param args: array of raw arguments
+ * @param start: index of the first argument of the definition
+ * @param numArgs: number of arguments
+ * @return: index of the closing } or -1 if the body is not closed
+ ************************************************************************************/
+int functionEnd(char **args, int start, int numArgs) {
+    int i, depth = 0;
+
+    for (i = start + isFunctionStart(args, start, numArgs); i < numArgs; i++) {
+        if (strcmp(args[i], "{") == 0) {
+            depth++;
+        } else if (strcmp(args[i], "}") == 0 && --depth == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*************************************************************************************
+ * Function to parse a function definition. The body is parsed into its own command
+ * list once, when it is defined, so calling the function never parses it again.
+ *
+ * @param args: array of the definition's raw arguments
+ * @param numArgs: number of arguments
+ * @param isForeOnlyMode: flag for foreground only mode
+ * @return: a command with the function's name as its only arg and the body set, or
+ *      NULL if the definition is not valid
+ ************************************************************************************/
+struct command *parseFunction(char **args, int numArgs, int isForeOnlyMode) {
+    struct command *cmd, *cur;
+    int i, bodyStart = isFunctionStart(args, 0, numArgs) + 1, end = functionEnd(args, 0, numArgs);
+    char *name = args[bodyStart - 2];
+
+    if (end == -1) {
+        queueConstant("syntax error: unterminated function body\n");
+        return NULL;
+    } else if (end != numArgs - 1) {
+        queueFormat("syntax error near %s\n", args[end + 1]);
+        return NULL;
+    } else if (end == bodyStart) {
+        queueConstant("syntax error: empty function body\n");
+        return NULL;
+    }
+
+    cmd = MEM_CALLOC(MEM_PARSER, 1, sizeof(struct command));
+    cmd->args = args;
+    cmd->numArgs = 1;
+
+    // the name without the ()
+    if (strlen(name) > 2 && strcmp(name + strlen(name) - 2, "()") == 0) {
+        name[strlen(name) - 2] = '\0';
+    }
+
+    // the body gets its own args array like a process substitution
+    cmd->bodyArgs = MEM_CALLOC(MEM_PARSER, end - bodyStart + 1, sizeof(char *));
+    memcpy(cmd->bodyArgs, args + bodyStart, (end - bodyStart) * sizeof(char *));
+
+    args[0] = parseArg(name);
+    for (i = 1; i < numArgs; i++) {
+        args[i] = NULL;
+    }
+    cmd->body = parseCommandList(cmd->bodyArgs, end - bodyStart, isForeOnlyMode);
+    if (cmd->body == NULL) {
+        freeCommand(cmd);
+        return NULL;
+    }
+
+    // a definition in the body would give its body to the function table on every call
+    for (cur = cmd->body; cur != NULL; cur = cur->next) {
+        if (cur->body != NULL) {
+            queueConstant("syntax error: nested function definition\n");
+            freeCommand(cmd);
+            return NULL;
+        }
+    }
+
+    keepStatusArgs(cmd->body);
+    return cmd;
+}
+
+/*************************************************************************************
+ * Function to keep unexpanded copies of the args containing $? in each command of a
+ * list so the list can be run more than once
+ *
+ * @param list: first command of the list
+ ************************************************************************************/
+void keepStatusArgs(struct command *list) {
+    int i;
+
+    for (; list != NULL; list = list->next) {
+        for (i = 0; i < list->numArgs; i++) {
+            if (strstr(list->args[i], "$?") != NULL) {
+                if (list->statusArgs == NULL) {
+                    list->statusArgs = MEM_CALLOC(MEM_PARSER, list->numArgs, sizeof(char *));
+                }
+                list->statusArgs[i] = list->args[i];
+            }
+        }
+    }
+}
+
+/*************************************************************************************
+ * Function to detect if a raw argument is a redirection operator. Operators are <, >,
+ * >>, <&M, >&M, <&- and >&-, optionally preceded by the file descriptor to redirect.
+ * The file of <, > and >> may be attached to the operator (2>/dev/null).
+ *
+ * @param arg: the raw argument
+ * @param redir: redirection to load with the operator's file descriptor and type,
+ *               with target pointing into arg if the file is attached
+ * @return: TRUE if the argument is a redirection operator
+ ************************************************************************************/
+int parseRedirOp(char *arg, struct redirection *redir) {
+    char *op = arg;
+    int fd = -1;
+
+    // read the optional file descriptor
+    if (*op >= '0' && *op <= '9') {
+        fd = 0;
+        while (*op >= '0' && *op <= '9') {
+            fd = fd * 10 + (*op - '0');
+            op++;
+        }
+    }
+
+    memset(redir, 0, sizeof(struct redirection));
+    if ((op[0] != '<' && op[0] != '>') || isProcSubStart(op)) {
+        return FALSE;
+    }
+
+    if (op[1] == '&') {
+        // copying or closing a file descriptor
+        if (strcmp(op + 2, "-") == 0) {
+            redir->type = REDIR_CLOSE;
+        } else if (op[2] >= '0' && op[2] <= '9' && strspn(op + 2, "0123456789") == strlen(op + 2)) {
+            redir->type = REDIR_DUP;
+            redir->dupFd = atoi(op + 2);
+        } else {
+            return FALSE;
+        }
+    } else {
+        // redirecting to a file
+        if (strncmp(op, ">>", 2) == 0) {
+            redir->type = REDIR_APPEND;
+            redir->target = op + 2;
+        } else {
+            redir->type = op[0] == '<' ? REDIR_IN : REDIR_OUT;
+            redir->target = op + 1;
+        }
+
+        // the operators are not repeated (<< is not supported)
+        if (*redir->target == '<' || *redir->target == '>') {
+            return FALSE;
+        } else if (*redir->target == '\0') {
+            redir->target = NULL;
+        }
+    }
+
+    // input operators default to stdin and output operators to stdout
+    redir->fd = fd != -1 ? fd : (op[0] == '<' ? 0 : 1);
+    return TRUE;
+}
+
+/*************************************************************************************
+ * Function to add a copy of a redirection to a command
+ *
+ * @param cmd: the command to add the redirection to
+ * @param redir: the redirection to copy
+ * @param atStart: TRUE to apply it before the command's other redirections
+ * @return: the command's copy of the redirection
+ ************************************************************************************/
+struct redirection *addRedirect(struct command *cmd, struct redirection *redir, int atStart) {
+    struct redirection *node = MEM_CALLOC(MEM_REDIRECT, 1, sizeof(struct redirection));
+    struct redirection **link = &cmd->redirs;
+
+    *node = *redir;
+    node->next = NULL;
+
+    if (atStart) {
+        node->next = cmd->redirs;
+        cmd->redirs = node;
+    } else {
+        while (*link != NULL) {
+            link = &(*link)->next;
+        }
+        *link = node;
+    }
+
+    return node;
+}
+
+/*************************************************************************************
+ * Function to detect if a command redirects a file descriptor
+ *
+ * @param cmd: the command to check
+ * @param fd: the file descriptor
+ * @return: TRUE if any redirection of the command applies to fd
+ ************************************************************************************/
+int hasRedirect(struct command *cmd, int fd) {
+    struct redirection *cur;
+
+    for (cur = cmd->redirs; cur != NULL; cur = cur->next) {
+        if (cur->fd == fd) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
 /*************************************************************************************
  * Function to parse all the args, allocating new memory, performing variable expansion
- * and updating the command structure as appropriate
+ * and updating the command structure as appropriate. Redirections may appear anywhere
+ * in the args and are removed from them. Each process substitution is parsed into
+ * its own list and replaced by a single placeholder arg.
  *
  * @param args: array of args to parse
  * @param cmd: the cmd structure to be loaded
  * @param isForeOnlyMode: flag for forground only mode
+ * @return: FALSE if a redirection is missing its file or a substitution is invalid
  ************************************************************************************/
-void parseAllArgs(char **args, struct command *cmd, int isForeOnlyMode) {
-    int i, ptrIdx = cmd->numArgs;
+int parseAllArgs(char **args, struct command *cmd, int isForeOnlyMode) {
+    int i, end, isRedirect, builtIn, numRaw = cmd->numArgs, numKept = 0, isValid = TRUE;
+    struct redirection redir;
+    struct procSub *sub;
+    char placeholder[] = "<(...)";
 
     // iterate through args
-    for (i = 0; i < ptrIdx; i++) {
-        args[i] = parseArg(args[i]);  // parse each arg
-        // if new the end of the arg list
-        if (i >= ptrIdx - 5) {
-            // check for input file and update cmd appropriately
-            if (strcmp(args[i], "<") == 0) {
-                // free the arg
-                free(args[i]);
-                args[i] = NULL;
-
-                // set index and adjust number of arguments
-                cmd->hasInfile = TRUE;
-                cmd->infile = parseArg(args[i + 1]);
-                args[i + 1] = NULL;
-                cmd->numArgs -= 2;
-                i++;
-                // check for output file and update cmd appropriately
-            } else if (strcmp(args[i], ">") == 0) {
-                // free the arg
-                free(args[i]);
-                args[i] = NULL;
-
-                // set index and adjust number of arguments
-                cmd->hasOutfile = TRUE;
-                cmd->outfile = parseArg(args[i + 1]);
-                args[i + 1] = NULL;
-                cmd->numArgs -= 2;
-                i++;
+    for (i = 0; i < numRaw; i++) {
+        isRedirect = parseRedirOp(args[i], &redir);
+
+        // file redirections without an attached file take the next arg as their file
+        if (isRedirect && redir.target == NULL &&
+            (redir.type == REDIR_IN || redir.type == REDIR_OUT || redir.type == REDIR_APPEND)) {
+            if (++i >= numRaw) {
+                queueFormat("syntax error near %s\n", args[i - 1]);
+                isValid = FALSE;
+                break;
             }
+            redir.target = args[i];
         }
+
+        if (isProcSubStart(args[i])) {
+            placeholder[0] = args[i][0];
+            if ((end = procSubEnd(args, i, numRaw)) == -1) {
+                queueFormat("syntax error: unterminated %.2s\n", args[i]);
+                isValid = FALSE;
+                break;
+            } else if ((sub = parseProcSub(args, i, end, cmd, numKept, isForeOnlyMode)) == NULL) {
+                isValid = FALSE;
+                break;
+            }
+            i = end;
+
+            // the placeholder is replaced by the pipe's path when the command runs
+            if (isRedirect) {
+                redir.target = parseArg(placeholder);
+                sub->argIdx = -1;
+                sub->redir = addRedirect(cmd, &redir, FALSE);
+            } else {
+                args[numKept++] = parseArg(placeholder);
+            }
+        } else if (isRedirect) {
+            if (redir.target != NULL) {
+                redir.target = parseArg(redir.target);
+            }
+            addRedirect(cmd, &redir, FALSE);
+        } else {
+            args[numKept++] = parseArg(args[i]);  // parse each arg
+        }
+    }
+
+    // clear the slots left by the redirections
+    for (i = numKept; i < numRaw; i++) {
+        args[i] = NULL;
     }
+    cmd->numArgs = numKept;
+
     // check if command should be run in background
-    if (args[ptrIdx - 1] && strcmp(args[ptrIdx - 1], "&") == 0) {
-        // if the command is not a built in command and we're not in forground only mode
-        // set isBgProcess to true
-        cmd->isBgProcess = (!isBuiltIn(args[0]) && !isForeOnlyMode);
+    if (numKept > 0 && strcmp(args[numKept - 1], "&") == 0) {
+        // if the command is not a built in command (other than timeout, which runs a
+        // command) and we're not in forground only mode set isBgProcess to true. The
+        // command's name comes after any assignments.
+        for (i = 0; i < numKept - 2 && isAssignment(args[i]); i++);
+        builtIn = isBuiltIn(args[i]);
+        cmd->isBgProcess = (numKept > 1 && (!builtIn || builtIn == TIMEOUT_FLAG) && !isForeOnlyMode);
 
-        // free the arg and adjust arg count
-        free(args[ptrIdx - 1]);
+        // free the arg and adjust arg count, the redirects to /dev/null are set once
+        // the rest of the pipeline is known
+        MEM_FREE(args[numKept - 1]);
         cmd->numArgs--;
+        args[numKept - 1] = NULL;
+    }
+
+    return isValid;
+}
+
+/*************************************************************************************
+ * Function to move the NAME=value words before a command's name out of its args and
+ * into its assignments. Words that are all assignments are left as the args of the
+ * assignment built in.
+ *
+ * @param cmd: the parsed command
+ ************************************************************************************/
+void parseAssignments(struct command *cmd) {
+    struct procSub *sub;
+    int i, num;
 
-        setNullRedirects(cmd);
-        args[ptrIdx - 1] = NULL;
+    for (num = 0; num < cmd->numArgs - 1 && isAssignment(cmd->args[num]); num++);
+
+    // a substitution can not be part of an assignment
+    for (sub = cmd->procSubs; sub != NULL; sub = sub->next) {
+        if (sub->argIdx >= 0 && sub->argIdx < num) {
+            num = sub->argIdx;
+        }
+    }
+    if (num == 0) {
+        return;
+    }
+
+    cmd->assigns = MEM_CALLOC(MEM_PARSER, num + 1, sizeof(char *));
+    memcpy(cmd->assigns, cmd->args, num * sizeof(char *));
+    cmd->numAssigns = num;
+
+    // shift the rest of the args (and the substitutions replacing them) down
+    memmove(cmd->args, cmd->args + num, (cmd->numArgs - num) * sizeof(char *));
+    for (i = cmd->numArgs - num; i < cmd->numArgs; i++) {
+        cmd->args[i] = NULL;
+    }
+    cmd->numArgs -= num;
+    for (sub = cmd->procSubs; sub != NULL; sub = sub->next) {
+        sub->argIdx -= sub->argIdx >= 0 ? num : 0;
     }
 }
 
@@ -169,7 +796,15 @@ void parseAllArgs(char **args, struct command *cmd, int isForeOnlyMode) {
  ************************************************************************************/
 char *parseArg(char *rawArg) {
     char* result = NULL;
-    int pidLen = atoi(getenv(PID_LEN));
+
+    // if expansion is deferred return an unexpanded copy of the arg
+    if (!expandEnabled) {
+        result = MEM_CALLOC(MEM_PARSER, strlen(rawArg) + 1, sizeof(char));
+        strcpy(result, rawArg);
+        return result;
+    }
+
+    int pidLen = atoi(getShellVar(PID_LEN));
 
     // count the number of variables that need expansion in the argument
     int newLength, varToExpand = countVars(rawArg);
@@ -178,12 +813,22 @@ char *parseArg(char *rawArg) {
     newLength = (pidLen - 2) * varToExpand + strlen(rawArg) + 1;
 
     // allocate memory and load the arg with the expanded variables (if necessary
-    result = calloc(newLength, sizeof(char));
+    result = MEM_CALLOC(MEM_PARSER, newLength, sizeof(char));
     expandVariables(result, rawArg);
 
     return result;
 }
 
+/*************************************************************************************
+ * Function to enable or disable variable expansion while parsing. With expansion
+ * disabled $$ is left in place so it can be expanded later.
+ *
+ * @param isEnabled: TRUE to expand variables when parsing, FALSE to defer it
+ ************************************************************************************/
+void setExpandVariables(int isEnabled) {
+    expandEnabled = isEnabled;
+}
+
 /*************************************************************************************
  * Function to count the number of variables in need of expansion in the argument
  *
@@ -221,10 +866,10 @@ char *expandVariables(char *dest, char *source) {
         //if more than 1 character from end check if $$ is next
         if(i < strlen(source) - 1 && source[i] == '$' && source[i + 1] == '$'){
             // load dest with contents of dest + process id
-            sprintf(dest, "%s%s", dest, getenv(PID));
+            sprintf(dest, "%s%s", dest, getShellVar(PID));
 
             // adjust current index for dest by length of process id
-            curIdx += atoi(getenv(PID_LEN));
+            curIdx += atoi(getShellVar(PID_LEN));
 
             i++;  // skip a character in source
         } else {
@@ -238,50 +883,138 @@ char *expandVariables(char *dest, char *source) {
 }
 
 /*************************************************************************************
- * Function to release the dynamic memory allocated to the command struct
+ * Function to replace $? in each argument with the exit status of the previous
+ * command. This is done just before the command runs so that each command in a list
+ * sees the status of the command before it.
+ *
+ * @param cmd: command whose arguments should be expanded
+ * @param lastExit: exit status of the previous command
+ ************************************************************************************/
+void expandStatusVars(struct command *cmd, int lastExit) {
+    char statusText[12], *arg, *expanded, *found;
+    int i, count, statusLen, prefixLen;
+
+    sprintf(statusText, "%d", lastExit);
+    statusLen = strlen(statusText);
+
+    for (i = 0; i < cmd->numArgs; i++) {
+        // a command run more than once expands its kept copy, leaving the copy in place
+        if (cmd->statusArgs != NULL && cmd->statusArgs[i] != NULL) {
+            if (cmd->args[i] != cmd->statusArgs[i]) {
+                MEM_FREE(cmd->args[i]);
+            }
+            cmd->args[i] = cmd->statusArgs[i];
+        }
+        arg = cmd->args[i];
+
+        // count the occurrences of $? to size the expanded arg
+        count = 0;
+        for (found = strstr(arg, "$?"); found != NULL; found = strstr(found + 2, "$?")) {
+            count++;
+        }
+        if (count == 0) {
+            continue;
+        }
+
+        // copy the arg replacing each $? with the status
+        expanded = MEM_CALLOC(MEM_PARSER, strlen(arg) + count * statusLen + 1, sizeof(char));
+        while ((found = strstr(arg, "$?")) != NULL) {
+            prefixLen = found - arg;
+            strncat(expanded, arg, prefixLen);
+            strcat(expanded, statusText);
+            arg = found + 2;
+        }
+        strcat(expanded, arg);
+
+        if (cmd->statusArgs == NULL || cmd->statusArgs[i] == NULL) {
+            MEM_FREE(cmd->args[i]);
+        }
+        cmd->args[i] = expanded;
+    }
+}
+
+/*************************************************************************************
+ * Function to release the dynamic memory allocated to the command struct and any
+ * commands following it in its command list
  *
  * @param cmd: command struct to be released
  ************************************************************************************/
 void freeCommand(struct command *cmd) {
     int i;
-    // free each arg in the arg array
+
+    // release the rest of the command list first
+    if (cmd->next != NULL) {
+        freeCommand(cmd->next);
+        cmd->next = NULL;
+    }
+
+    // free each arg in the arg array (and the kept copy of any that were expanded)
     for (i = 0; i < cmd->numArgs; i++){
-        free(cmd->args[i]);
+        if (cmd->statusArgs != NULL && cmd->statusArgs[i] != cmd->args[i]) {
+            MEM_FREE(cmd->statusArgs[i]);
+        }
+        MEM_FREE(cmd->args[i]);
         cmd->args[i] = NULL;
     }
+    MEM_FREE(cmd->statusArgs);
+
+    // free each assignment given before the command's name
+    for (i = 0; i < cmd->numAssigns; i++) {
+        MEM_FREE(cmd->assigns[i]);
+    }
+    MEM_FREE(cmd->assigns);
+
+    // free the body of a function definition
+    if (cmd->body != NULL) {
+        freeCommand(cmd->body);
+    }
+    MEM_FREE(cmd->bodyArgs);
 
-    // if there's an outfile character array free it
-    if (cmd->hasOutfile == TRUE){
-        free(cmd->outfile);
-        cmd->outfile = NULL;
+    // free each process substitution and its command list
+    while (cmd->procSubs != NULL) {
+        struct procSub *nextSub = cmd->procSubs->next;
+        freeCommand(cmd->procSubs->list);
+        MEM_FREE(cmd->procSubs->args);
+        MEM_FREE(cmd->procSubs);
+        cmd->procSubs = nextSub;
     }
 
-    // if there's an infile character array free it
-    if (cmd->hasInfile == TRUE){
-        free(cmd->infile);
-        cmd->infile = NULL;
+    // free each redirection
+    while (cmd->redirs != NULL) {
+        struct redirection *next = cmd->redirs->next;
+        MEM_FREE(cmd->redirs->target);
+        MEM_FREE(cmd->redirs);
+        cmd->redirs = next;
     }
 
     // free the memory for the base structure
-    free(cmd);
+    MEM_FREE(cmd);
 }
 
 /*************************************************************************************
  * Function to set redirects to /dev/null if no redirects are otherwise specified
  *
- * @param cmd: command to have it's redirect set to null
+ * @param first: first command of the pipeline, to have it's input set to null
+ * @param last: last command of the pipeline, to have it's output set to null
  ************************************************************************************/
-void setNullRedirects(struct command *cmd) {
-    if (!cmd->hasInfile) {
-        cmd->hasInfile = TRUE;
-        cmd->infile = calloc(strlen("/dev/null") + 1, sizeof(char));
-        sprintf(cmd->infile, "/dev/null");
+void setNullRedirects(struct command *first, struct command *last) {
+    struct redirection redir = {0};
+
+    // added at the start so any redirections the user gave still apply after them
+    if (!hasRedirect(last, STDOUT_FILENO)) {
+        redir.fd = STDOUT_FILENO;
+        redir.type = REDIR_OUT;
+        redir.target = MEM_CALLOC(MEM_REDIRECT, strlen("/dev/null") + 1, sizeof(char));
+        sprintf(redir.target, "/dev/null");
+        addRedirect(last, &redir, TRUE);
     }
 
-    if (!cmd->hasOutfile) {
-        cmd->hasOutfile = TRUE;
-        cmd->outfile = calloc(strlen("/dev/null") + 1, sizeof(char));
-        sprintf(cmd->outfile, "/dev/null");
+    if (!hasRedirect(first, STDIN_FILENO)) {
+        redir.fd = STDIN_FILENO;
+        redir.type = REDIR_IN;
+        redir.target = MEM_CALLOC(MEM_REDIRECT, strlen("/dev/null") + 1, sizeof(char));
+        sprintf(redir.target, "/dev/null");
+        addRedirect(first, &redir, TRUE);
     }
 }
 
@@ -295,13 +1028,13 @@ void echoModifier(struct command *cmd) {
     // character to turn off purple text
     if (cmd->numArgs > 1) {
         char *arg = cmd->args[1];
-        cmd->args[1] = calloc(strlen(arg) + 6, sizeof(char));
+        cmd->args[1] = MEM_CALLOC(MEM_ECHO, strlen(arg) + 6, sizeof(char));
         sprintf(cmd->args[1], "\033[95m%s", arg);
-        free(arg);
+        MEM_FREE(arg);
 
         arg = cmd->args[cmd->numArgs - 1];
-        cmd->args[cmd->numArgs - 1] = calloc(strlen(arg) + 6, sizeof(char));
+        cmd->args[cmd->numArgs - 1] = MEM_CALLOC(MEM_ECHO, strlen(arg) + 6, sizeof(char));
         sprintf(cmd->args[cmd->numArgs - 1], "%s\033[0m", arg);
-        free(arg);
+        MEM_FREE(arg);
     }
 }
@@ -10,6 +10,17 @@
 #define EXIT_FLAG 1
 #define STATUS_FLAG 2
 #define CD_FLAG 4
+#define BENCH_FLAG 8
+#define MEM_FLAG 16
+#define TIMEOUT_FLAG 32
+#define ALIAS_FLAG 64
+#define UNALIAS_FLAG 128
+#define EXEC_FLAG 256
+#define EXPORT_FLAG 512
+#define ASSIGN_FLAG 1024  // NAME=value words with no command after them
+#define WATCH_FLAG 2048
+#define FG_FLAG 4096
+#define BG_FLAG 8192
 
 #define TRUE 1
 #define FALSE 0
@@ -18,32 +29,108 @@
 
 #define STATUS "SMALLSH_STATUS"
 
+// operators joining the commands in a command list
+#define LIST_SEQUENCE 1  // ;
+#define LIST_AND 2       // &&
+#define LIST_OR 3        // ||
+#define LIST_PIPE 4      // |, the commands run at once with a pipe between them
+
+// kinds of io redirection
+#define REDIR_IN 1      // N< file
+#define REDIR_OUT 2     // N> file
+#define REDIR_APPEND 3  // N>> file
+#define REDIR_DUP 4     // N>&M or N<&M
+#define REDIR_CLOSE 5   // N>&- or N<&-
+
+// kinds of process substitution
+#define PROCSUB_IN 1   // <(list), the command reads the list's output
+#define PROCSUB_OUT 2  // >(list), the command writes the list's input
+
+// sizes for the raw command line and the argument array
+#define INPUT_LENGTH 2048
+#define MAX_ARGS 512
+
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
 
+#include "Memory.h"
+
+// structure to create a node for a command's linked list of redirections, which are
+// applied in the order they were given
+struct redirection {
+    int fd;        // file descriptor being redirected
+    int type;      // REDIR_ value
+    char *target;  // file name for REDIR_IN, REDIR_OUT and REDIR_APPEND
+    int dupFd;     // file descriptor to copy for REDIR_DUP
+    struct redirection *next;
+};
+
+// structure to create a node for a command's linked list of process substitutions
+struct procSub {
+    int type;              // PROCSUB_ value
+    int argIdx;            // arg replaced by the /dev/fd path of the pipe (-1 if redir is set)
+    struct redirection *redir;  // redirection whose file is the path of the pipe
+    char **args;           // args array of the substituted command list
+    struct command *list;  // the substituted command list
+    int fd;                // shell's end of the pipe while the command starts (-1 otherwise)
+    struct procSub *next;
+};
+
 // struct the hold the relevant command information
 struct command{
     char **args;
     int numArgs;
     int isBgProcess;
-    int hasOutfile;
-    char *outfile;
-    int hasInfile;
-    char *infile;
+    struct redirection *redirs;
+    struct procSub *procSubs;
+
+    // NAME=value words given before the command's name, added to its environment only
+    char **assigns;
+    int numAssigns;
+
+    // unexpanded copies of the args containing $? for commands that are run more than
+    // once (function bodies), NULL otherwise
+    char **statusArgs;
+
+    // for a function definition, args[0] is the name and this is the parsed body
+    struct command *body;
+    char **bodyArgs;  // args array of the body
+
+    // next command in the command list and the operator joining it to this one
+    struct command *next;
+    int nextOp;
 };
 
 struct command *parseInput(char *input, char **args, int isForeOnlyMode);
+struct command *parseCommandList(char **args, int numArgs, int isForeOnlyMode);
+struct command *parseCommand(char **args, int numArgs, int isForeOnlyMode);
+int listOperator(char *arg);
+char *attachedOperator(char *input);
 int stripWhiteSpace(char *input, char **args);
-void parseAllArgs(char **args, struct command *cmd, int isForeOnlyMode);
+int parseAllArgs(char **args, struct command *cmd, int isForeOnlyMode);
+void parseAssignments(struct command *cmd);
 char *parseArg(char *rawArg);
+void setExpandVariables(int isEnabled);
 int isBuiltIn(char* command);
 int isWhitespace(char c);
 int countVars(char* rawArg);
 char *expandVariables(char *dest, char *source);
+void expandStatusVars(struct command *cmd, int lastExit);
 void freeCommand(struct command *cmd);
-void setNullRedirects(struct command *cmd);
+int isProcSubStart(char *arg);
+int procSubEnd(char **args, int start, int numArgs);
+struct procSub *parseProcSub(char **args, int start, int end, struct command *cmd, int argIdx, int isForeOnlyMode);
+void addProcSub(struct command *cmd, struct procSub *sub);
+int isFunctionStart(char **args, int start, int numArgs);
+int functionEnd(char **args, int start, int numArgs);
+struct command *parseFunction(char **args, int numArgs, int isForeOnlyMode);
+void keepStatusArgs(struct command *list);
+int parseRedirOp(char *arg, struct redirection *redir);
+struct redirection *addRedirect(struct command *cmd, struct redirection *redir, int atStart);
+int hasRedirect(struct command *cmd, int fd);
+void setNullRedirects(struct command *first, struct command *last);
 void echoModifier(struct command *cmd);
 
 #endif //CS344_COMMANDPARSER_H
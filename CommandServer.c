@@ -0,0 +1,760 @@
+#include "CommandServer.h"
+#include "Events.h"
+#include "Variables.h"
+#include "Pipeline.h"
+#include "Functions.h"
+
+/************************************************************************************
+ * Function to check if a server is answering on a unix domain socket
+ *
+ * @param addr: address of the socket
+ * @return: TRUE unless connecting to the socket is refused
+ ***********************************************************************************/
+int isSocketLive(struct sockaddr_un *addr) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0), isLive;
+
+    if (fd == -1) {
+        return TRUE;
+    }
+    isLive = connect(fd, (struct sockaddr *) addr, sizeof(*addr)) == 0 || errno != ECONNREFUSED;
+    close(fd);
+
+    return isLive;
+}
+
+/************************************************************************************
+ * Function to create the listening unix domain socket for the server, replacing a
+ * stale socket file left at the path. Anything else at the path (a file that is not a
+ * socket, or a socket another server answers on) is left alone and is an error.
+ *
+ * @param path: path to create the socket at
+ * @return: the listening socket or -1 on error (with errno set)
+ ***********************************************************************************/
+int openServerSocket(char *path) {
+    struct sockaddr_un addr = {0};
+    struct stat st;
+    int fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode) || isSocketLive(&addr)) {
+            errno = EADDRINUSE;
+            return -1;
+        }
+        unlink(path);
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return -1;
+    }
+
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) == -1 || listen(fd, SERVER_BACKLOG) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/************************************************************************************
+ * Function to create the state for a newly connected client
+ *
+ * @param fd: the client's socket
+ * @return: the new session
+ ***********************************************************************************/
+struct session *createSession(int fd) {
+    struct session *sess = MEM_CALLOC(MEM_SERVER, 1, sizeof(struct session));
+    sess->fd = fd;
+    sess->pidFd = -1;
+    sess->outFd = -1;
+    sess->errFd = -1;
+    sess->killFd = -1;
+
+    // sessions start in the server's directory with a clean status
+    if (getcwd(sess->cwd, PATH_MAX) == NULL) {
+        strcpy(sess->cwd, "/");
+    }
+    strcpy(sess->status, "exit value 0\n");
+
+    return sess;
+}
+
+/************************************************************************************
+ * Function to start closing a session whose client is gone or done. A command still
+ * running is sent SIGTERM with the rest of its process group, and the session is kept
+ * until the command exits, being killed if it has not by the deadline.
+ *
+ * @param sess: session to close
+ ***********************************************************************************/
+void dropSession(struct session *sess) {
+    struct itimerspec deadline = {{0, 0}, {SESSION_KILL_GRACE / 1000, (SESSION_KILL_GRACE % 1000) * 1000000L}};
+
+    // nothing more is read from or sent to the client
+    sess->isDropped = TRUE;
+    sess->isClosing = TRUE;
+    close(sess->fd);
+    sess->fd = -1;
+    if (sess->outFd != -1) {
+        close(sess->outFd);
+        sess->outFd = -1;
+    }
+    if (sess->errFd != -1) {
+        close(sess->errFd);
+        sess->errFd = -1;
+    }
+
+    if (sess->pid > 0) {
+        kill(-sess->pid, SIGTERM);
+        if (!sess->hasExited) {
+            sess->killFd = moveHigh(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC));
+            if (sess->killFd == -1 || timerfd_settime(sess->killFd, 0, &deadline, NULL) == -1) {
+                killSessionCommand(sess);
+            }
+        }
+    }
+}
+
+/************************************************************************************
+ * Function to kill the command of a closing session once its deadline has passed
+ *
+ * @param sess: session being closed
+ ***********************************************************************************/
+void killSessionCommand(struct session *sess) {
+    kill(-sess->pid, SIGKILL);
+    if (sess->killFd != -1) {
+        close(sess->killFd);
+        sess->killFd = -1;
+    }
+
+    // without a pidfd the exit would not be noticed, but a killed command exits at once
+    if (sess->pidFd == -1 && !sess->hasExited) {
+        wait4(sess->pid, &sess->exitStatus, 0, &sess->usage);
+        sess->hasExited = TRUE;
+    }
+}
+
+/************************************************************************************
+ * Function to free a session once its client is disconnected and any command it was
+ * running has exited
+ *
+ * @param sess: session to close
+ ***********************************************************************************/
+void closeSession(struct session *sess) {
+    if (sess->pid > 0) {
+        metricsJobFinished(sess->pid, sess->exitStatus);
+        eventJobFinished(sess->pid, sess->exitStatus, &sess->usage);
+        if (sess->pidFd != -1) {
+            close(sess->pidFd);
+        }
+    }
+    if (sess->killFd != -1) {
+        close(sess->killFd);
+    }
+
+    if (sess->list != NULL) {
+        freeCommand(sess->list);
+    }
+    MEM_FREE(sess->output);
+    MEM_FREE(sess);
+}
+
+/************************************************************************************
+ * Function to queue a frame to be sent to a client
+ *
+ * @param sess: session to send the frame to
+ * @param type: type of the frame
+ * @param payload: contents of the frame
+ * @param len: length of the payload
+ ***********************************************************************************/
+void appendFrame(struct session *sess, char type, const char *payload, uint32_t len) {
+    unsigned char header[5];
+
+    // grow the output buffer until the frame fits
+    if (sess->outputLen + sizeof(header) + len > sess->outputCap) {
+        while (sess->outputLen + sizeof(header) + len > sess->outputCap) {
+            sess->outputCap = sess->outputCap ? sess->outputCap * 2 : SERVER_READ_SIZE * 2;
+        }
+        sess->output = MEM_REALLOC(MEM_SERVER, sess->output, sess->outputCap);
+    }
+
+    header[0] = type;
+    header[1] = (len >> 24) & 0xff;
+    header[2] = (len >> 16) & 0xff;
+    header[3] = (len >> 8) & 0xff;
+    header[4] = len & 0xff;
+
+    memcpy(sess->output + sess->outputLen, header, sizeof(header));
+    memcpy(sess->output + sess->outputLen + sizeof(header), payload, len);
+    sess->outputLen += sizeof(header) + len;
+}
+
+/************************************************************************************
+ * Function to run a built in command for a session. Each session has its own working
+ * directory and status, and exit only ends the session.
+ *
+ * @param sess: session running the command
+ * @param cmd: the built in command
+ * @param builtIn: flag for the built in command as returned by isBuiltIn
+ ***********************************************************************************/
+void runSessionBuiltIn(struct session *sess, struct command *cmd, int builtIn) {
+    char target[PATH_MAX], resolved[PATH_MAX], msg[PATH_MAX + 50];
+    char *dir = cmd->numArgs < 2 ? getenv("HOME") : cmd->args[1];
+    struct stat st;
+    int length;
+
+    switch (builtIn) {
+        case CD_FLAG:
+            // resolve the new directory relative to the session's directory
+            if (dir != NULL && dir[0] == '/') {
+                length = snprintf(target, PATH_MAX, "%s", dir);
+            } else {
+                length = snprintf(target, PATH_MAX, "%s/%s", sess->cwd, dir ? dir : "");
+            }
+
+            // a path too long to resolve names no directory
+            if (length < PATH_MAX && realpath(target, resolved) != NULL && stat(resolved, &st) == 0 &&
+                S_ISDIR(st.st_mode)) {
+                strcpy(sess->cwd, resolved);
+                appendFrame(sess, FRAME_EXIT, "exit value 0", strlen("exit value 0"));
+                sess->lastExit = 0;
+            } else {
+                snprintf(msg, sizeof(msg), "cd: %s: no such directory\n", dir ? dir : "");
+                appendFrame(sess, FRAME_STDERR, msg, strlen(msg));
+                appendFrame(sess, FRAME_EXIT, "exit value 1", strlen("exit value 1"));
+                sess->lastExit = 1;
+            }
+            break;
+        case STATUS_FLAG:
+            appendFrame(sess, FRAME_STDOUT, sess->status, strlen(sess->status));
+            appendFrame(sess, FRAME_EXIT, "exit value 0", strlen("exit value 0"));
+            sess->lastExit = 0;
+            break;
+        case EXIT_FLAG:
+            // discard anything else the client sent and end the session once flushed
+            appendFrame(sess, FRAME_EXIT, "exit value 0", strlen("exit value 0"));
+            sess->isInputClosed = TRUE;
+            sess->inputLen = 0;
+            sess->nextCmd = NULL;
+            break;
+        default:
+            snprintf(msg, sizeof(msg), "%s: not available in server mode\n", cmd->args[0]);
+            appendFrame(sess, FRAME_STDERR, msg, strlen(msg));
+            appendFrame(sess, FRAME_EXIT, "exit value 1", strlen("exit value 1"));
+            sess->lastExit = 1;
+    }
+}
+
+/************************************************************************************
+ * Function run in the child of a session command to run a pipeline, or a command with
+ * process substitutions, with this copy of the shell. It connects the stages and
+ * substitutions and waits for them as an interactive shell would. Never returns.
+ *
+ * @param sess: session running the command
+ * @param cmd: the command (the first stage of a pipeline)
+ * @param numStages: number of stages in the pipeline (1 for a single command)
+ ***********************************************************************************/
+void runSessionCopy(struct session *sess, struct command *cmd, int numStages) {
+    struct processLinkedList procs = {NULL, NULL};
+    struct processNode *node;
+    int isForeOnlyMode = TRUE;
+
+    // only the server publishes metrics and events, and the status is the session's
+    detachMetrics();
+    detachEvents();
+    showPrompt = FALSE;
+    lastExitStatus = sess->lastExit;
+    setShellVar(STATUS, sess->status);
+    if (numStages > 1) {
+        runPipeline(cmd, numStages, &procs, &isForeOnlyMode);
+    } else {
+        executeCommand(cmd, &procs, &isForeOnlyMode);
+    }
+    flushOutput();
+
+    // reap anything this copy started that it did not wait for, like substitutions
+    for (node = procs.head; node != NULL; node = node->next) {
+        while (waitpid(node->pid, NULL, 0) == -1 && errno == EINTR);
+    }
+    _exit(lastExitStatus);
+}
+
+/************************************************************************************
+ * Function to start a command or pipeline for a session with its stdout and stderr
+ * connected to pipes read by the server
+ *
+ * @param sess: session running the command
+ * @param cmd: the command to run (the first stage of a pipeline)
+ * @param numStages: number of stages in the pipeline (1 for a single command)
+ ***********************************************************************************/
+void startSessionCommand(struct session *sess, struct command *cmd, int numStages) {
+    char *resolved = resolveCommand(cmd->args[0]);
+    int outPipe[2], errPipe[2];
+    pid_t pid;
+
+    if (pipe2(outPipe, O_CLOEXEC) == -1) {
+        appendFrame(sess, FRAME_EXIT, "exit value 1", strlen("exit value 1"));
+        return;
+    }
+    if (pipe2(errPipe, O_CLOEXEC) == -1) {
+        close(outPipe[0]);
+        close(outPipe[1]);
+        appendFrame(sess, FRAME_EXIT, "exit value 1", strlen("exit value 1"));
+        return;
+    }
+
+    pid = fork();
+    if (pid < 0) {  // error
+        close(outPipe[0]);
+        close(outPipe[1]);
+        close(errPipe[0]);
+        close(errPipe[1]);
+        appendFrame(sess, FRAME_STDERR, "Error forking process\n", strlen("Error forking process\n"));
+        metricsSpawnFailed();
+        appendFrame(sess, FRAME_EXIT, "exit value 1", strlen("exit value 1"));
+        return;
+
+    } else if (pid == 0) {  // child
+        // load child handlers and connect the output pipes and an empty input
+        loadHandlers(FOREGROUND | CHILD);
+        signal(SIGPIPE, SIG_DFL);
+        setpgid(0, 0);
+        dup2(outPipe[1], STDOUT_FILENO);
+        dup2(errPipe[1], STDERR_FILENO);
+        int nullFd = open("/dev/null", O_RDONLY);
+        dup2(nullFd, STDIN_FILENO);
+
+        // run in the session's directory. A pipeline or a command with substitutions
+        // is run by this copy of the shell, otherwise any redirect files are opened and
+        // the command executed.
+        if (chdir(sess->cwd) != 0) {
+            _exit(1);
+        }
+        if (numStages > 1 || cmd->procSubs != NULL) {
+            runSessionCopy(sess, cmd, numStages);
+        }
+        if (openRedirFiles(cmd)) {
+            execCommand(cmd, resolved);
+            printf("%s: no such file or directory\n", cmd->args[0]);
+            fflush(stdout);
+        }
+        _exit(1);
+    }
+
+    // parent keeps the read ends of the pipes and watches for the child to exit. The
+    // child is put in a process group of its own by both so a dropped session can
+    // terminate everything it started.
+    setpgid(pid, pid);
+    close(outPipe[1]);
+    close(errPipe[1]);
+    fcntl(outPipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(errPipe[0], F_SETFL, O_NONBLOCK);
+
+    sess->pid = pid;
+    sess->outFd = outPipe[0];
+    sess->errFd = errPipe[0];
+    sess->pidFd = pidfdOpen(pid);
+    sess->hasExited = FALSE;
+    metricsJobStarted(pid, cmd, JOB_FOREGROUND);
+    eventJobStarted(pid, cmd, FALSE);
+}
+
+/************************************************************************************
+ * Function to find a stage of a pipeline that defines or calls a function or an
+ * alias. Sessions have neither, as the definitions would be shared by every session.
+ *
+ * @param cmd: first stage of the pipeline
+ * @param end: command after the last stage
+ * @return: the first such stage, or NULL if there is none
+ ***********************************************************************************/
+struct command *findSessionFunction(struct command *cmd, struct command *end) {
+    for (; cmd != end; cmd = cmd->next) {
+        if (cmd->body != NULL || isDefined(cmd->args[0])) {
+            return cmd;
+        }
+    }
+
+    return NULL;
+}
+
+/************************************************************************************
+ * Function to run the commands of a session's command list until one of them starts
+ * a command that has to be waited for, releasing the list once it is finished. The
+ * stages of a pipeline are started together and skipped or not as one.
+ *
+ * @param sess: session to run commands for
+ ***********************************************************************************/
+void runSessionList(struct session *sess) {
+    struct command *cmd, *last, *stage;
+    char msg[INPUT_LENGTH + 100];
+    int builtIn, op, numStages;
+
+    while (sess->pid == 0 && sess->nextCmd != NULL) {
+        // move past the pipeline the next command starts, skipping it if the previous
+        // status requires it
+        cmd = sess->nextCmd;
+        op = sess->nextOp;
+        for (last = cmd, numStages = 1; last->nextOp == LIST_PIPE && last->next != NULL; numStages++) {
+            last = last->next;
+        }
+        sess->nextCmd = last->next;
+        sess->nextOp = last->nextOp;
+        if (isShortCircuited(op, sess->lastExit)) {
+            continue;
+        }
+
+        // functions and aliases are refused rather than looked up on the PATH
+        stage = findSessionFunction(cmd, last->next);
+        if (stage != NULL) {
+            snprintf(msg, sizeof(msg), "%s: functions and aliases are not available in server mode\n",
+                     stage->args[0]);
+            appendFrame(sess, FRAME_STDERR, msg, strlen(msg));
+            appendFrame(sess, FRAME_EXIT, "exit value 1", strlen("exit value 1"));
+            sess->lastExit = 1;
+            continue;
+        }
+
+        for (stage = cmd; stage != last->next; stage = stage->next) {
+            expandStatusVars(stage, sess->lastExit);
+        }
+        builtIn = isBuiltIn(cmd->args[0]);
+        if (builtIn && numStages == 1) {
+            runSessionBuiltIn(sess, cmd, builtIn);
+        } else {
+            startSessionCommand(sess, cmd, numStages);
+        }
+    }
+
+    if (sess->pid == 0 && sess->nextCmd == NULL && sess->list != NULL) {
+        freeCommand(sess->list);
+        sess->list = NULL;
+    }
+}
+
+/************************************************************************************
+ * Function to run the complete lines a session has received until one of them starts
+ * a command that has to be waited for
+ *
+ * @param sess: session to run lines for
+ ***********************************************************************************/
+void runSessionLines(struct session *sess) {
+    char line[INPUT_LENGTH];
+    char *newline;
+    int lineLen, used;
+
+    // finish any command list that was waiting on a command
+    runSessionList(sess);
+
+    while (sess->pid == 0 && sess->inputLen > 0) {
+        // find the end of the next line, treating a full buffer or the final unterminated
+        // line as a complete line
+        newline = memchr(sess->input, '\n', sess->inputLen);
+        if (newline != NULL) {
+            lineLen = newline - sess->input;
+            used = lineLen + 1;
+        } else if (sess->isInputClosed || sess->inputLen == SESSION_INPUT_SIZE) {
+            lineLen = sess->inputLen;
+            used = lineLen;
+        } else {
+            break;
+        }
+
+        // copy the line out of the input buffer, truncating it if it's too long
+        memset(line, 0, INPUT_LENGTH);
+        memcpy(line, sess->input, lineLen < INPUT_LENGTH ? lineLen : INPUT_LENGTH - 1);
+        memmove(sess->input, sess->input + used, sess->inputLen - used);
+        sess->inputLen -= used;
+
+        // parse the line, ignoring & as there is no terminal to return to
+        memset(sess->args, 0, MAX_ARGS * sizeof(char *));
+        sess->list = parseInput(line, sess->args, FOREGROUND_ONLY);
+        sess->nextCmd = sess->list;
+        sess->nextOp = 0;
+        runSessionList(sess);
+    }
+}
+
+/************************************************************************************
+ * Function to forward available output from a running command to its client
+ *
+ * @param sess: session running the command
+ * @param fd: pointer to the pipe to read, set to -1 once the pipe is closed
+ * @param type: frame type to send the output as
+ ***********************************************************************************/
+void readSessionOutput(struct session *sess, int *fd, char type) {
+    char buf[SERVER_READ_SIZE];
+    ssize_t numRead = read(*fd, buf, SERVER_READ_SIZE);
+
+    if (numRead > 0) {
+        appendFrame(sess, type, buf, numRead);
+    } else if (numRead == 0 || (errno != EAGAIN && errno != EINTR)) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+/************************************************************************************
+ * Function to send the exit status of a finished command to its client
+ *
+ * @param sess: session that ran the command
+ ***********************************************************************************/
+void finishSessionCommand(struct session *sess) {
+    // without a pidfd the child has not been collected yet
+    if (!sess->hasExited) {
+        wait4(sess->pid, &sess->exitStatus, 0, &sess->usage);
+    }
+
+    // save the status for the status command and send it without the newline
+    formatStatus(sess->exitStatus, sess->status);
+    sess->lastExit = statusToExitCode(sess->exitStatus);
+    metricsJobFinished(sess->pid, sess->exitStatus);
+    eventJobFinished(sess->pid, sess->exitStatus, &sess->usage);
+    appendFrame(sess, FRAME_EXIT, sess->status, strlen(sess->status) - 1);
+
+    if (sess->pidFd != -1) {
+        close(sess->pidFd);
+        sess->pidFd = -1;
+    }
+    sess->pid = 0;
+}
+
+/************************************************************************************
+ * Function to read command lines sent by a client
+ *
+ * @param sess: session to read for
+ * @return: FALSE if the connection failed and the session should be dropped
+ ***********************************************************************************/
+int readSessionInput(struct session *sess) {
+    ssize_t numRead = read(sess->fd, sess->input + sess->inputLen, SESSION_INPUT_SIZE - sess->inputLen);
+
+    if (numRead > 0) {
+        sess->inputLen += numRead;
+    } else if (numRead == 0) {
+        sess->isInputClosed = TRUE;
+    } else if (errno != EAGAIN && errno != EINTR) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to send as much queued output to a client as it will accept
+ *
+ * @param sess: session to write to
+ * @return: FALSE if the connection failed and the session should be dropped
+ ***********************************************************************************/
+int writeSessionOutput(struct session *sess) {
+    ssize_t numWritten = write(sess->fd, sess->output, sess->outputLen);
+
+    if (numWritten > 0) {
+        memmove(sess->output, sess->output + numWritten, sess->outputLen - numWritten);
+        sess->outputLen -= numWritten;
+    } else if (numWritten == -1 && errno != EAGAIN && errno != EINTR) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to run the shell as a command server. All clients are handled by a single
+ * poll loop so caches such as the PATH cache are shared by every session.
+ *
+ * @param path: path to create the unix domain socket at
+ ***********************************************************************************/
+void serve(char *path) {
+    struct session *sessions = NULL, *sess, **link;
+    struct pollfd *fds = NULL;
+    struct session **owners = NULL;
+    int numFds, capFds = 0, numSessions = 0, i, clientFd, isDropped;
+
+    int listenFd = openServerSocket(path);
+    if (listenFd == -1) {
+        printf("cannot listen on %s: %s\n", path, strerror(errno));
+        fflush(stdout);
+        return;
+    }
+
+    // a client disconnecting must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    while (1) {
+        // make room for the listening socket and up to four descriptors per session
+        if (capFds < 1 + 4 * numSessions) {
+            capFds = 2 * (1 + 4 * numSessions);
+            fds = MEM_REALLOC(MEM_SERVER, fds, capFds * sizeof(struct pollfd));
+            owners = MEM_REALLOC(MEM_SERVER, owners, capFds * sizeof(struct session *));
+        }
+
+        numFds = 0;
+        fds[numFds].fd = listenFd;
+        fds[numFds].events = POLLIN;
+        owners[numFds++] = NULL;
+
+        for (sess = sessions; sess != NULL; sess = sess->next) {
+            // a closing session only waits for its command to exit or its deadline
+            if (sess->isClosing) {
+                if (!sess->hasExited && sess->pidFd != -1) {
+                    fds[numFds].fd = sess->pidFd;
+                    fds[numFds].events = POLLIN;
+                    owners[numFds++] = sess;
+                }
+                if (sess->killFd != -1) {
+                    fds[numFds].fd = sess->killFd;
+                    fds[numFds].events = POLLIN;
+                    owners[numFds++] = sess;
+                }
+                continue;
+            }
+
+            // only take more input from a client when it has no command running
+            fds[numFds].fd = sess->fd;
+            fds[numFds].events = (sess->pid == 0 && !sess->isInputClosed) ? POLLIN : 0;
+            fds[numFds].events |= sess->outputLen > 0 ? POLLOUT : 0;
+            owners[numFds++] = sess;
+
+            if (sess->pid != 0) {
+                // stop reading the command's output if the client isn't keeping up
+                if (sess->outputLen < MAX_PENDING_OUTPUT) {
+                    if (sess->outFd != -1) {
+                        fds[numFds].fd = sess->outFd;
+                        fds[numFds].events = POLLIN;
+                        owners[numFds++] = sess;
+                    }
+                    if (sess->errFd != -1) {
+                        fds[numFds].fd = sess->errFd;
+                        fds[numFds].events = POLLIN;
+                        owners[numFds++] = sess;
+                    }
+                }
+                if (!sess->hasExited && sess->pidFd != -1) {
+                    fds[numFds].fd = sess->pidFd;
+                    fds[numFds].events = POLLIN;
+                    owners[numFds++] = sess;
+                }
+            }
+        }
+
+        // only an interrupted poll is retried, any other failure would repeat forever
+        if (poll(fds, numFds, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            printf("server poll failed: %s\n", strerror(errno));
+            fflush(stdout);
+            break;
+        }
+
+        // handle events on every descriptor that has one
+        for (i = 1; i < numFds; i++) {
+            sess = owners[i];
+            if (fds[i].revents == 0 || (sess->isDropped && !sess->isClosing)) {
+                continue;
+            }
+
+            if (sess->isClosing) {
+                if (fds[i].fd == sess->killFd) {
+                    killSessionCommand(sess);
+                } else if (fds[i].fd == sess->pidFd &&
+                           wait4(sess->pid, &sess->exitStatus, WNOHANG, &sess->usage) > 0) {
+                    sess->hasExited = TRUE;
+                }
+            } else if (fds[i].fd == sess->fd) {
+                // a client that hung up can never be answered, and its descriptor would
+                // keep poll from sleeping while its command runs. One that only shut
+                // down its sending side reads as end of input instead.
+                if (fds[i].revents & (POLLHUP | POLLERR)) {
+                    sess->isDropped = TRUE;
+                    continue;
+                }
+                if ((fds[i].revents & POLLIN) && fds[i].events & POLLIN) {
+                    if (!readSessionInput(sess)) {
+                        sess->isDropped = TRUE;
+                        continue;
+                    }
+                }
+                if ((fds[i].revents & POLLOUT) && !writeSessionOutput(sess)) {
+                    sess->isDropped = TRUE;
+                }
+            } else if (fds[i].fd == sess->outFd) {
+                readSessionOutput(sess, &sess->outFd, FRAME_STDOUT);
+            } else if (fds[i].fd == sess->errFd) {
+                readSessionOutput(sess, &sess->errFd, FRAME_STDERR);
+            } else if (fds[i].fd == sess->pidFd) {
+                if (wait4(sess->pid, &sess->exitStatus, WNOHANG, &sess->usage) > 0) {
+                    sess->hasExited = TRUE;
+                }
+            }
+        }
+
+        // finish commands, run more lines, and close finished or failed sessions
+        link = &sessions;
+        while ((sess = *link) != NULL) {
+            isDropped = sess->isDropped;
+            if (!isDropped) {
+                if (sess->pid != 0 && sess->outFd == -1 && sess->errFd == -1 &&
+                    (sess->hasExited || sess->pidFd == -1)) {
+                    finishSessionCommand(sess);
+                }
+                runSessionLines(sess);
+
+                // a client that is done sending is closed once everything is answered
+                isDropped = sess->isInputClosed && sess->pid == 0 &&
+                            sess->inputLen == 0 && sess->outputLen == 0;
+            }
+
+            if (isDropped && !sess->isClosing) {
+                dropSession(sess);
+            }
+
+            // a closing session is freed once its command has exited
+            if (sess->isClosing && sess->pid > 0 && !sess->hasExited &&
+                wait4(sess->pid, &sess->exitStatus, WNOHANG, &sess->usage) > 0) {
+                sess->hasExited = TRUE;
+            }
+            if (sess->isClosing && (sess->pid == 0 || sess->hasExited)) {
+                *link = sess->next;
+                closeSession(sess);
+                numSessions--;
+            } else {
+                link = &sess->next;
+            }
+        }
+
+        // accept any new clients
+        if (fds[0].revents & POLLIN) {
+            while ((clientFd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+                sess = createSession(clientFd);
+                sess->next = sessions;
+                sessions = sess;
+                numSessions++;
+            }
+        }
+    }
+
+    // the server has stopped, so every session is closed and its socket removed
+    while ((sess = sessions) != NULL) {
+        sessions = sess->next;
+        if (!sess->isClosing) {
+            dropSession(sess);
+        }
+        if (sess->pid > 0 && !sess->hasExited) {
+            killSessionCommand(sess);
+            if (!sess->hasExited) {
+                wait4(sess->pid, &sess->exitStatus, 0, &sess->usage);
+            }
+        }
+        closeSession(sess);
+    }
+    close(listenFd);
+    unlink(path);
+    MEM_FREE(fds);
+    MEM_FREE(owners);
+}
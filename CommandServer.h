@@ -0,0 +1,93 @@
+/************************************************************************************
+ * This file defines functions related to running the shell as a command server on
+ * a unix domain socket. Each client sends command lines and receives a framed
+ * stream of the command's stdout, stderr, and exit status.
+ *
+ * A frame is a one byte type, a four byte big endian payload length, and the payload.
+ ***********************************************************************************/
+#ifndef CS344_COMMANDSERVER_H
+#define CS344_COMMANDSERVER_H
+
+#include <stdint.h>
+#include <poll.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+
+#include "CommandParser.h"
+#include "CommandDelegator.h"
+
+// frame types sent to clients
+#define FRAME_STDOUT 'O'
+#define FRAME_STDERR 'E'
+#define FRAME_EXIT 'X'
+
+#define SERVER_BACKLOG 64
+#define SERVER_READ_SIZE 4096
+#define MAX_PENDING_OUTPUT 65536  // stop reading a command's output past this much unsent data
+#define SESSION_INPUT_SIZE (INPUT_LENGTH * 4)
+#define SESSION_KILL_GRACE 100  // ms a dropped session's command group has to exit after SIGTERM
+
+// structure to hold the state of a connected client
+struct session {
+    int fd;
+
+    // raw input received from the client that has not been run yet
+    char input[SESSION_INPUT_SIZE];
+    int inputLen;
+    int isInputClosed;
+    int isDropped;  // set if the connection failed
+    int isClosing;  // set once the client is gone and the session waits on its command
+
+    // frames waiting to be sent to the client
+    char *output;
+    size_t outputLen;
+    size_t outputCap;
+
+    // per session shell state
+    char cwd[PATH_MAX];
+    char status[100];
+    int lastExit;
+
+    // the command list being run, the next command to run and the operator before it
+    char *args[MAX_ARGS];
+    struct command *list;
+    struct command *nextCmd;
+    int nextOp;
+
+    // the command currently running for this session (pid is 0 if there is none)
+    pid_t pid;
+    int pidFd;
+    int outFd;
+    int errFd;
+    int exitStatus;
+    struct rusage usage;  // resources used by the command once it has been collected
+    int hasExited;
+    int killFd;  // timerfd expiring when a closing session's command is killed
+
+    struct session *next;
+};
+
+int isSocketLive(struct sockaddr_un *addr);
+int openServerSocket(char *path);
+struct session *createSession(int fd);
+void dropSession(struct session *sess);
+void killSessionCommand(struct session *sess);
+void closeSession(struct session *sess);
+void appendFrame(struct session *sess, char type, const char *payload, uint32_t len);
+void runSessionBuiltIn(struct session *sess, struct command *cmd, int builtIn);
+void runSessionCopy(struct session *sess, struct command *cmd, int numStages);
+void startSessionCommand(struct session *sess, struct command *cmd, int numStages);
+struct command *findSessionFunction(struct command *cmd, struct command *end);
+void runSessionList(struct session *sess);
+void runSessionLines(struct session *sess);
+void readSessionOutput(struct session *sess, int *fd, char type);
+void finishSessionCommand(struct session *sess);
+int readSessionInput(struct session *sess);
+int writeSessionOutput(struct session *sess);
+void serve(char *path);
+
+#endif //CS344_COMMANDSERVER_H
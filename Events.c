@@ -0,0 +1,332 @@
+#include "Events.h"
+#include "Utils.h"
+
+// structure to create a node for the linked list of jobs that have been announced
+struct eventJob {
+    pid_t pid;
+    int jobId;
+    long long startNs;
+    char *argv;  // argv as a JSON array
+    struct eventJob *next;
+};
+
+// the stream, -1 if events are not being published
+static int streamFd = -1;
+
+// events waiting to be written, from bufStart to bufEnd
+static char *buffer = NULL;
+static size_t bufStart = 0, bufEnd = 0, bufCap = 0;
+static long dropped = 0;
+
+static struct eventJob *jobs = NULL;
+static int nextJobId = 1;
+
+/************************************************************************************
+ * Function to escape a string for JSON
+ *
+ * @param dest: buffer for the escaped string (NULL to only measure it)
+ * @param source: the string to escape
+ * @return: length of the escaped string
+ ***********************************************************************************/
+static size_t jsonEscape(char *dest, char *source) {
+    static const char hex[] = "0123456789abcdef";
+    unsigned char c;
+    size_t len = 0;
+    char esc[6];
+    int n, i;
+
+    for (; (c = *source) != '\0'; source++) {
+        n = 1;
+        esc[0] = c;
+        if (c == '"' || c == '\\') {
+            esc[0] = '\\';
+            esc[1] = c;
+            n = 2;
+        } else if (c < 0x20) {
+            memcpy(esc, "\\u00", 4);
+            esc[4] = hex[c >> 4];
+            esc[5] = hex[c & 0xf];
+            n = 6;
+        }
+
+        if (dest != NULL) {
+            for (i = 0; i < n; i++) {
+                dest[len + i] = esc[i];
+            }
+        }
+        len += n;
+    }
+
+    return len;
+}
+
+/************************************************************************************
+ * Function to format a command's args as a JSON array
+ *
+ * @param cmd: the command
+ * @return: the array, allocated for the caller
+ ***********************************************************************************/
+static char *formatArgv(struct command *cmd) {
+    size_t len = 2;
+    char *argv;
+    int i;
+
+    // measure first so the array is allocated once
+    for (i = 0; i < cmd->numArgs; i++) {
+        len += jsonEscape(NULL, cmd->args[i]) + 3;
+    }
+
+    argv = MEM_CALLOC(MEM_EVENTS, len + 1, sizeof(char));
+    len = 0;
+    argv[len++] = '[';
+    for (i = 0; i < cmd->numArgs; i++) {
+        if (i > 0) {
+            argv[len++] = ',';
+        }
+        argv[len++] = '"';
+        len += jsonEscape(argv + len, cmd->args[i]);
+        argv[len++] = '"';
+    }
+    argv[len] = ']';
+
+    return argv;
+}
+
+/************************************************************************************
+ * Function to add an event to the buffer. The event is dropped if the buffer is full.
+ *
+ * @param event: name of the event
+ * @param format: printf style format of the event's fields after the timestamp
+ ***********************************************************************************/
+static void appendEvent(const char *event, const char *format, ...) {
+    va_list args;
+    long long ts = monotonicNs();
+    int len, headerLen, droppedLen = 0;
+
+    // move the unwritten events to the front before adding more
+    if (bufStart > 0) {
+        memmove(buffer, buffer + bufStart, bufEnd - bufStart);
+        bufEnd -= bufStart;
+        bufStart = 0;
+    }
+
+    // measure the event, its header, the dropped event and the newline, then grow the
+    // buffer to fit them (with room for the terminating null snprintf writes)
+    va_start(args, format);
+    len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    headerLen = snprintf(NULL, 0, "{\"event\":\"%s\",\"ts\":%lld,", event, ts);
+    if (dropped > 0) {
+        droppedLen = snprintf(NULL, 0, "{\"event\":\"dropped\",\"ts\":%lld,\"count\":%ld}\n", ts, dropped);
+    }
+    len += headerLen + droppedLen + 2;
+    if (bufEnd + len > EVENTS_BUFFER_MAX) {
+        dropped++;
+        return;
+    }
+    if (bufEnd + len > bufCap) {
+        bufCap = bufCap * 2 > bufEnd + len ? bufCap * 2 : bufEnd + len;
+        buffer = MEM_REALLOC(MEM_EVENTS, buffer, bufCap);
+    }
+
+    // report the events lost since the buffer was last full
+    if (dropped > 0) {
+        bufEnd += snprintf(buffer + bufEnd, bufCap - bufEnd,
+                           "{\"event\":\"dropped\",\"ts\":%lld,\"count\":%ld}\n", ts, dropped);
+        dropped = 0;
+    }
+
+    bufEnd += snprintf(buffer + bufEnd, bufCap - bufEnd, "{\"event\":\"%s\",\"ts\":%lld,", event, ts);
+    va_start(args, format);
+    bufEnd += vsnprintf(buffer + bufEnd, bufCap - bufEnd, format, args);
+    va_end(args);
+    buffer[bufEnd++] = '\n';
+
+    flushEvents();
+}
+
+/************************************************************************************
+ * Function to start publishing events
+ *
+ * @param target: a file descriptor number that is already open or a file to append to
+ * @return: flag indicating whether the stream could be opened
+ ***********************************************************************************/
+int openEvents(char *target) {
+    char *end;
+    long fd = strtol(target, &end, 10);
+
+    if (*target != '\0' && *end == '\0') {
+        if (fcntl(fd, F_GETFD) == -1) {
+            return FALSE;
+        }
+        streamFd = fd;
+    } else if ((streamFd = moveHigh(open(target, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644))) == -1) {
+        return FALSE;
+    }
+
+    // commands must not inherit the stream and writes must never block the shell
+    fcntl(streamFd, F_SETFD, FD_CLOEXEC);
+    fcntl(streamFd, F_SETFL, fcntl(streamFd, F_GETFL) | O_NONBLOCK);
+
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to stop publishing events. The remaining events are written, waiting for
+ * the reader if need be, as the shell is exiting.
+ ***********************************************************************************/
+void closeEvents() {
+    struct eventJob *next;
+
+    if (streamFd == -1) {
+        return;
+    }
+
+    fcntl(streamFd, F_SETFL, fcntl(streamFd, F_GETFL) & ~O_NONBLOCK);
+    flushEvents();
+    close(streamFd);
+    streamFd = -1;
+
+    MEM_FREE(buffer);
+    buffer = NULL;
+    bufStart = bufEnd = bufCap = 0;
+    for (; jobs != NULL; jobs = next) {
+        next = jobs->next;
+        MEM_FREE(jobs->argv);
+        MEM_FREE(jobs);
+    }
+}
+
+/************************************************************************************
+ * Function to stop a forked copy of the shell from publishing events, so the events
+ * buffered by the shell are not written twice
+ ***********************************************************************************/
+void detachEvents() {
+    if (streamFd != -1) {
+        close(streamFd);
+        streamFd = -1;
+        bufStart = bufEnd = 0;
+    }
+}
+
+/************************************************************************************
+ * Function to check whether there are events waiting for the reader
+ *
+ * @return: TRUE if there are unwritten events
+ ***********************************************************************************/
+int eventsPending() {
+    return streamFd != -1 && bufEnd > bufStart;
+}
+
+/************************************************************************************
+ * Function to get the stream's file descriptor, to poll it for writing
+ *
+ * @return: file descriptor of the stream (-1 if there is none)
+ ***********************************************************************************/
+int eventsFd() {
+    return streamFd;
+}
+
+/************************************************************************************
+ * Function to write as many buffered events as the reader accepts without blocking
+ ***********************************************************************************/
+void flushEvents() {
+    ssize_t written;
+
+    while (eventsPending()) {
+        written = write(streamFd, buffer + bufStart, bufEnd - bufStart);
+        if (written > 0) {
+            bufStart += written;
+        } else if (written == -1 && errno == EINTR) {
+            continue;
+        } else if (written == -1 && errno == EAGAIN) {
+            return;
+        } else {
+            // the reader has gone, stop publishing rather than buffer forever
+            bufStart = bufEnd = 0;
+            close(streamFd);
+            streamFd = -1;
+            return;
+        }
+    }
+    bufStart = bufEnd = 0;
+}
+
+/************************************************************************************
+ * Function to publish the start of a job, giving it the next job id
+ *
+ * @param pid: pid of the job
+ * @param cmd: command the job is running
+ * @param isBackground: flag indicating whether the job runs in the background
+ ***********************************************************************************/
+void eventJobStarted(pid_t pid, struct command *cmd, int isBackground) {
+    struct eventJob *job;
+
+    if (streamFd == -1) {
+        return;
+    }
+
+    job = MEM_CALLOC(MEM_EVENTS, 1, sizeof(struct eventJob));
+    job->pid = pid;
+    job->jobId = nextJobId++;
+    job->startNs = monotonicNs();
+    job->argv = formatArgv(cmd);
+    job->next = jobs;
+    jobs = job;
+
+    appendEvent("spawn", "\"pid\":%d,\"job\":%d,\"mode\":\"%s\",\"argv\":%s}", pid, job->jobId,
+                isBackground ? "background" : "foreground", job->argv);
+}
+
+/************************************************************************************
+ * Function to publish the end of a job, as an exit event or a signal event if the job
+ * was terminated by a signal
+ *
+ * @param pid: pid of the job
+ * @param statusCode: status of the job as returned by wait4
+ * @param usage: resources used by the job as returned by wait4
+ ***********************************************************************************/
+void eventJobFinished(pid_t pid, int statusCode, struct rusage *usage) {
+    struct eventJob **link = &jobs, *job;
+    char result[64];
+
+    // only announced jobs are reported (not process substitutions)
+    while (*link != NULL && (*link)->pid != pid) {
+        link = &(*link)->next;
+    }
+    if (streamFd == -1 || (job = *link) == NULL) {
+        return;
+    }
+    *link = job->next;
+
+    if (WIFSIGNALED(statusCode)) {
+        snprintf(result, sizeof(result), "\"signal\":%d,\"core\":%s", WTERMSIG(statusCode),
+                 WCOREDUMP(statusCode) ? "true" : "false");
+    } else {
+        snprintf(result, sizeof(result), "\"status\":%d", WEXITSTATUS(statusCode));
+    }
+
+    appendEvent(WIFSIGNALED(statusCode) ? "signal" : "exit",
+                "\"pid\":%d,\"job\":%d,\"argv\":%s,%s,\"elapsed_ns\":%lld,\"rusage\":{"
+                "\"utime_us\":%lld,\"stime_us\":%lld,\"maxrss_kb\":%ld,\"minflt\":%ld,"
+                "\"majflt\":%ld,\"nvcsw\":%ld,\"nivcsw\":%ld}}",
+                pid, job->jobId, job->argv, result, monotonicNs() - job->startNs,
+                usage->ru_utime.tv_sec * 1000000LL + usage->ru_utime.tv_usec,
+                usage->ru_stime.tv_sec * 1000000LL + usage->ru_stime.tv_usec,
+                usage->ru_maxrss, usage->ru_minflt, usage->ru_majflt, usage->ru_nvcsw,
+                usage->ru_nivcsw);
+
+    MEM_FREE(job->argv);
+    MEM_FREE(job);
+}
+
+/************************************************************************************
+ * Function to publish a change of the foreground only mode
+ *
+ * @param isForeOnly: flag containing 0 if not foreground only and non-zero if it is
+ ***********************************************************************************/
+void eventModeToggled(int isForeOnly) {
+    if (streamFd != -1) {
+        appendEvent("mode", "\"foreground_only\":%s}", isForeOnly ? "true" : "false");
+    }
+}
@@ -0,0 +1,42 @@
+/************************************************************************************
+ * This file defines functions related to publishing a machine readable stream of job
+ * lifecycle events. Each event is one JSON object on its own line:
+ *
+ *   {"event":"spawn","ts":..,"pid":..,"job":..,"mode":"foreground","argv":[..]}
+ *   {"event":"exit","ts":..,"pid":..,"job":..,"argv":[..],"status":..,
+ *    "elapsed_ns":..,"rusage":{..}}
+ *   {"event":"signal", ... as exit with "signal":.. and "core":.. instead of "status"}
+ *   {"event":"mode","ts":..,"foreground_only":true}
+ *   {"event":"dropped","ts":..,"count":..}
+ *
+ * Timestamps are CLOCK_MONOTONIC nanoseconds. The stream is written without blocking
+ * the shell: events are buffered and written as the reader accepts them, and events
+ * that do not fit in the buffer are counted in a dropped event instead.
+ ***********************************************************************************/
+#ifndef CS344_EVENTS_H
+#define CS344_EVENTS_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "CommandParser.h"
+
+#define EVENTS_BUFFER_MAX (1024 * 1024)  // most bytes buffered for a slow reader
+
+int openEvents(char *target);
+void closeEvents();
+void detachEvents();
+int eventsPending();
+int eventsFd();
+void flushEvents();
+void eventJobStarted(pid_t pid, struct command *cmd, int isBackground);
+void eventJobFinished(pid_t pid, int statusCode, struct rusage *usage);
+void eventModeToggled(int isForeOnly);
+
+#endif //CS344_EVENTS_H
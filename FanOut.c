@@ -0,0 +1,278 @@
+#include "FanOut.h"
+
+/************************************************************************************
+ * Function to check if a redirection sends output to a file
+ ***********************************************************************************/
+static int isFileOutput(struct redirection *redir) {
+    return redir->type == REDIR_OUT || redir->type == REDIR_APPEND;
+}
+
+/************************************************************************************
+ * Function to count how many files a file descriptor of a command is redirected to
+ *
+ * @param cmd: the command
+ * @param fd: the file descriptor
+ * @return: number of output file redirections of fd
+ ***********************************************************************************/
+int countFileTargets(struct command *cmd, int fd) {
+    struct redirection *cur;
+    int count = 0;
+
+    for (cur = cmd->redirs; cur != NULL; cur = cur->next) {
+        count += cur->fd == fd && isFileOutput(cur);
+    }
+
+    return count;
+}
+
+/************************************************************************************
+ * Function to check if any file descriptor of a command is redirected to more than
+ * one file
+ *
+ * @param cmd: the command
+ * @return: TRUE if the command's output needs to be fanned out
+ ***********************************************************************************/
+int needsFanOut(struct command *cmd) {
+    struct redirection *cur;
+
+    for (cur = cmd->redirs; cur != NULL; cur = cur->next) {
+        if (isFileOutput(cur) && countFileTargets(cmd, cur->fd) > 1) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/************************************************************************************
+ * Function to move data from a pipe into a file. Splice is used while the file
+ * supports it, falling back to read and write for files that do not (files opened
+ * for appending and some devices).
+ *
+ * @param pipeFd: read end of the pipe
+ * @param fileFd: file to write to
+ * @param len: number of bytes to move
+ * @param canSplice: flag for the file supporting splice, cleared if it does not
+ * @return: FALSE if the data could not be moved
+ ***********************************************************************************/
+int drainPipe(int pipeFd, int fileFd, size_t len, int *canSplice) {
+    static char buffer[FAN_CHUNK];
+    ssize_t moved, written, n;
+
+    while (len > 0) {
+        if (*canSplice) {
+            moved = splice(pipeFd, NULL, fileFd, NULL, len, SPLICE_F_MOVE);
+            if (moved == -1 && errno == EINVAL) {
+                *canSplice = FALSE;
+                continue;
+            }
+        } else {
+            moved = read(pipeFd, buffer, len < FAN_CHUNK ? len : FAN_CHUNK);
+            for (written = 0; moved > 0 && written < moved; written += n) {
+                if ((n = write(fileFd, buffer + written, moved - written)) == -1) {
+                    if (errno == EINTR) {
+                        n = 0;
+                        continue;
+                    }
+                    return FALSE;
+                }
+            }
+        }
+
+        if (moved == -1 && errno == EINTR) {
+            continue;
+        } else if (moved <= 0) {
+            return FALSE;
+        }
+        len -= moved;
+    }
+
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to copy the next chunk of a fanned out file descriptor to every target.
+ * The chunk is tee'd into an empty copy pipe for each target but the last, then the
+ * command's pipe is spliced into the last target and each copy into its target.
+ *
+ * @param fan: the fanned out file descriptor, which has data or was closed
+ * @return: FALSE once the command closed the file descriptor or a target failed
+ ***********************************************************************************/
+int fanOutChunk(struct fanOut *fan) {
+    int k, last = fan->numTargets - 1, isOk = TRUE;
+    ssize_t len;
+
+    // the first tee decides the size of the chunk (0 once the command closed its end)
+    while ((len = tee(fan->pipe[0], fan->copies[0][1], FAN_CHUNK, 0)) == -1 && errno == EINTR);
+    if (len <= 0) {
+        return FALSE;
+    }
+
+    // every copy pipe is empty and the same size, so each holds the whole chunk
+    for (k = 1; k < last; k++) {
+        if (tee(fan->pipe[0], fan->copies[k][1], len, 0) != len) {
+            return FALSE;
+        }
+    }
+
+    isOk &= drainPipe(fan->pipe[0], fan->targets[last], len, &fan->canSplice[last]);
+    for (k = 0; k < last; k++) {
+        isOk &= drainPipe(fan->copies[k][0], fan->targets[k], len, &fan->canSplice[k]);
+    }
+
+    return isOk;
+}
+
+/************************************************************************************
+ * Function to copy each fanned out file descriptor to its targets until the command
+ * closes them, then exit with the command's status. Never returns.
+ *
+ * @param fans: the fanned out file descriptors
+ * @param numFans: number of fanned out file descriptors
+ * @param child: pid of the command
+ ***********************************************************************************/
+void runFanOut(struct fanOut *fans, int numFans, pid_t child) {
+    struct pollfd fds[MAX_FAN_FDS];
+    int i, active = numFans, statusCode = 0;
+    sigset_t mask;
+
+    while (active > 0) {
+        for (i = 0; i < numFans; i++) {
+            fds[i].fd = fans[i].isDone ? -1 : fans[i].pipe[0];
+            fds[i].events = POLLIN;
+        }
+
+        if (poll(fds, numFans, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        // closing the read end of a failed fan out lets the command see EPIPE
+        for (i = 0; i < numFans; i++) {
+            if (!fans[i].isDone && fds[i].revents && !fanOutChunk(&fans[i])) {
+                fans[i].isDone = TRUE;
+                close(fans[i].pipe[0]);
+                active--;
+            }
+        }
+    }
+
+    while (waitpid(child, &statusCode, 0) == -1) {
+        if (errno != EINTR) {
+            _exit(1);
+        }
+    }
+
+    // pass the command's status on as this process's own
+    if (WIFSIGNALED(statusCode)) {
+        signal(WTERMSIG(statusCode), SIG_DFL);
+        sigemptyset(&mask);
+        sigaddset(&mask, WTERMSIG(statusCode));
+        sigprocmask(SIG_UNBLOCK, &mask, NULL);
+        raise(WTERMSIG(statusCode));
+    }
+    _exit(WIFEXITED(statusCode) ? WEXITSTATUS(statusCode) : 1);
+}
+
+/************************************************************************************
+ * Function to apply the redirections of a command that fans out a file descriptor.
+ * The target files are opened and the process forks: the child applies the other
+ * redirections and returns to exec the command, while this process copies the
+ * command's output to the targets and exits with the command's status.
+ *
+ * @param cmd: the command
+ * @return: TRUE in the process that should exec the command, FALSE on an error
+ ***********************************************************************************/
+int startFanOut(struct command *cmd) {
+    struct fanOut fans[MAX_FAN_FDS], *fan;
+    struct redirection *cur;
+    int numFans = 0, i, k;
+    pid_t pid;
+
+    memset(fans, 0, sizeof(fans));
+
+    // open every target of each fanned out file descriptor in order
+    for (cur = cmd->redirs; cur != NULL; cur = cur->next) {
+        if (!isFileOutput(cur) || countFileTargets(cmd, cur->fd) < 2) {
+            continue;
+        }
+
+        for (fan = NULL, i = 0; i < numFans; i++) {
+            if (fans[i].fd == cur->fd) {
+                fan = &fans[i];
+            }
+        }
+
+        if (fan == NULL) {
+            if (numFans == MAX_FAN_FDS || pipe2((fan = &fans[numFans])->pipe, O_CLOEXEC) == -1) {
+                printf("too many output redirections\n");
+                fflush(stdout);
+                return FALSE;
+            }
+            fan->fd = cur->fd;
+            fan->pipe[0] = moveHigh(fan->pipe[0]);
+            fan->pipe[1] = moveHigh(fan->pipe[1]);
+            numFans++;
+        }
+
+        if (fan->numTargets == MAX_FAN_TARGETS) {
+            printf("too many output redirections\n");
+            fflush(stdout);
+            return FALSE;
+        }
+        if ((fan->targets[fan->numTargets] = moveHigh(openRedirFile(cur))) == -1) {
+            return FALSE;
+        }
+        fan->canSplice[fan->numTargets++] = TRUE;
+    }
+
+    // a copy pipe for each target but the last
+    for (i = 0; i < numFans; i++) {
+        for (k = 0; k < fans[i].numTargets - 1; k++) {
+            if (pipe2(fans[i].copies[k], O_CLOEXEC) == -1) {
+                printf("too many output redirections\n");
+                fflush(stdout);
+                return FALSE;
+            }
+        }
+    }
+
+    pid = fork();
+    if (pid == -1) {
+        printf("Error forking process\n");
+        fflush(stdout);
+        return FALSE;
+    } else if (pid > 0) {
+        // the command's own end of each pipe is only held by the command
+        for (i = 0; i < numFans; i++) {
+            close(fans[i].pipe[1]);
+        }
+
+        // a terminal interrupt reaches the command, whose status is passed on
+        signal(SIGINT, SIG_IGN);
+        runFanOut(fans, numFans, pid);
+    }
+
+    // the first file redirection of a fanned out file descriptor connects it to its
+    // pipe and the rest are skipped. Everything else is applied in order.
+    for (cur = cmd->redirs; cur != NULL; cur = cur->next) {
+        for (fan = NULL, i = 0; i < numFans; i++) {
+            if (fans[i].fd == cur->fd && isFileOutput(cur)) {
+                fan = &fans[i];
+            }
+        }
+
+        if (fan == NULL) {
+            if (!applyRedirect(cur)) {
+                return FALSE;
+            }
+        } else if (!fan->isDone) {
+            dup2(fan->pipe[1], fan->fd);
+            fan->isDone = TRUE;
+        }
+    }
+
+    return TRUE;
+}
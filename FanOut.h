@@ -0,0 +1,41 @@
+/************************************************************************************
+ * This file defines functions related to fanning out a file descriptor that was
+ * redirected to more than one file (cmd > a > b). The command writes into a pipe and
+ * a helper process copies the pipe into every file using tee and splice, so the data
+ * is not copied through user space.
+ ***********************************************************************************/
+#ifndef CS344_FANOUT_H
+#define CS344_FANOUT_H
+
+#include <poll.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "CommandParser.h"
+#include "CommandDelegator.h"
+
+#define MAX_FAN_FDS 8        // file descriptors that can be fanned out by one command
+#define MAX_FAN_TARGETS 16   // files a single file descriptor can be fanned out to
+#define FAN_CHUNK 65536      // most data moved for each tee
+
+// structure holding a file descriptor being fanned out and where its data goes
+struct fanOut {
+    int fd;                             // file descriptor of the command
+    int pipe[2];                        // pipe the command writes into
+    int numTargets;
+    int targets[MAX_FAN_TARGETS];       // opened target files in order
+    int canSplice[MAX_FAN_TARGETS];     // cleared if a target does not support splice
+    int copies[MAX_FAN_TARGETS - 1][2]; // pipes holding the tee'd copy for each target but the last
+    int isDone;
+};
+
+int countFileTargets(struct command *cmd, int fd);
+int needsFanOut(struct command *cmd);
+int drainPipe(int pipeFd, int fileFd, size_t len, int *canSplice);
+int fanOutChunk(struct fanOut *fan);
+void runFanOut(struct fanOut *fans, int numFans, pid_t child);
+int startFanOut(struct command *cmd);
+
+#endif //CS344_FANOUT_H
@@ -0,0 +1,443 @@
+#include "Filters.h"
+
+static int pushFilter(struct filter *filter, const char *data, size_t len);
+
+/************************************************************************************
+ * Function to read the line count option of head or tail
+ *
+ * @param args: the command's args, from the first option
+ * @param numArgs: number of args
+ * @param numLines: loaded with the line count
+ * @return: FALSE if the args are not a supported form
+ ***********************************************************************************/
+static int parseLineCount(char **args, int numArgs, long long *numLines) {
+    char *count, *end;
+
+    *numLines = FILTER_DEFAULT_LINES;
+    if (numArgs == 0) {
+        return TRUE;
+    }
+
+    // -n N, -nN or -N
+    if (strcmp(args[0], "-n") == 0 && numArgs == 2) {
+        count = args[1];
+    } else if (strncmp(args[0], "-n", 2) == 0 && numArgs == 1) {
+        count = args[0] + 2;
+    } else if (args[0][0] == '-' && numArgs == 1) {
+        count = args[0] + 1;
+    } else {
+        return FALSE;
+    }
+
+    if (*count < '0' || *count > '9') {
+        return FALSE;
+    }
+    *numLines = strtoll(count, &end, 10);
+    return *end == '\0';
+}
+
+/************************************************************************************
+ * Function to check if a command is one of the forms the filter built ins support and
+ * load a filter with its options if so
+ *
+ * @param cmd: the command
+ * @param filter: filter to load (may be NULL to only check the command)
+ * @return: TRUE if the command can be run as a filter
+ ***********************************************************************************/
+int parseFilter(struct command *cmd, struct filter *filter) {
+    struct filter parsed = {0};
+    char *name = cmd->args[0], *opt;
+    int i = 1, isFixed = FALSE;
+
+    if (strcmp(name, "grep") == 0) {
+        parsed.type = FILTER_GREP;
+
+        // single letter options, alone or combined, until the pattern
+        for (; i < cmd->numArgs && cmd->args[i][0] == '-' && cmd->args[i][1] != '\0'; i++) {
+            if (strcmp(cmd->args[i], "--") == 0) {
+                i++;
+                break;
+            }
+            for (opt = cmd->args[i] + 1; *opt != '\0'; opt++) {
+                if (*opt == 'F') {
+                    isFixed = TRUE;
+                } else if (*opt == 'v') {
+                    parsed.isInverted = TRUE;
+                } else if (*opt == 'c') {
+                    parsed.isCount = TRUE;
+                } else {
+                    return FALSE;
+                }
+            }
+        }
+
+        // exactly one pattern, which without -F must not use regular expressions
+        if (i != cmd->numArgs - 1 || (!isFixed && strpbrk(cmd->args[i], ".[]*^$\\") != NULL)) {
+            return FALSE;
+        }
+        parsed.pattern = cmd->args[i];
+        parsed.patternLen = strlen(cmd->args[i]);
+    } else if (strcmp(name, "wc") == 0) {
+        parsed.type = FILTER_WC;
+        for (; i < cmd->numArgs && cmd->args[i][0] == '-'; i++) {
+            for (opt = cmd->args[i] + 1; *opt != '\0'; opt++) {
+                if (*opt == 'l') {
+                    parsed.countLines = TRUE;
+                } else if (*opt == 'c') {
+                    parsed.countBytes = TRUE;
+                } else {
+                    return FALSE;
+                }
+            }
+        }
+
+        // plain wc also counts words, which is left to the program
+        if (i != cmd->numArgs || (!parsed.countLines && !parsed.countBytes)) {
+            return FALSE;
+        }
+    } else if (strcmp(name, "head") == 0 || strcmp(name, "tail") == 0) {
+        parsed.type = name[0] == 'h' ? FILTER_HEAD : FILTER_TAIL;
+        if (!parseLineCount(cmd->args + 1, cmd->numArgs - 1, &parsed.numLines)) {
+            return FALSE;
+        }
+    } else {
+        return FALSE;
+    }
+
+    if (filter != NULL) {
+        *filter = parsed;
+    }
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to check if a command can be run as a filter
+ *
+ * @param cmd: the command
+ * @return: TRUE if the command can be run as a filter
+ ***********************************************************************************/
+int isFilter(struct command *cmd) {
+    return parseFilter(cmd, NULL);
+}
+
+/************************************************************************************
+ * Function to write the output buffered by a sink
+ *
+ * @param sink: the sink
+ * @return: FALSE if the output could not be written
+ ***********************************************************************************/
+static int flushSink(struct filterSink *sink) {
+    size_t done = 0;
+    ssize_t written;
+
+    while (done < sink->len && !sink->isBroken) {
+        written = write(sink->fd, sink->buf + done, sink->len - done);
+        if (written > 0) {
+            done += written;
+        } else if (written == -1 && errno != EINTR) {
+            sink->isBroken = TRUE;
+        }
+    }
+    sink->len = 0;
+
+    return !sink->isBroken;
+}
+
+/************************************************************************************
+ * Function to pass output of a filter on to the next filter of the chain, or to the
+ * sink after the last filter
+ *
+ * @param filter: filter producing the output
+ * @param data: the output
+ * @param len: length of the output
+ * @return: FALSE if no more output is wanted
+ ***********************************************************************************/
+static int emit(struct filter *filter, const char *data, size_t len) {
+    struct filterSink *sink = filter->sink;
+
+    if (filter->next != NULL) {
+        return pushFilter(filter->next, data, len);
+    }
+
+    // large output is written straight from the data once the buffer is flushed
+    if (sink->len + len > FILTER_BUF_SIZE) {
+        if (!flushSink(sink)) {
+            return FALSE;
+        }
+        if (len > FILTER_BUF_SIZE / 2) {
+            struct filterSink direct = {sink->fd, (char *) data, len, FALSE};
+            sink->isBroken = !flushSink(&direct);
+            return !sink->isBroken;
+        }
+    }
+
+    memcpy(sink->buf + sink->len, data, len);
+    sink->len += len;
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to append data to the pending buffer of a filter
+ *
+ * @param filter: the filter
+ * @param data: data to append
+ * @param len: length of the data
+ ***********************************************************************************/
+static void appendPending(struct filter *filter, const char *data, size_t len) {
+    if (filter->pendingLen + len > filter->pendingCap) {
+        filter->pendingCap = (filter->pendingLen + len) * 2;
+        filter->pending = MEM_REALLOC(MEM_FILTERS, filter->pending, filter->pendingCap);
+    }
+    memcpy(filter->pending + filter->pendingLen, data, len);
+    filter->pendingLen += len;
+}
+
+/************************************************************************************
+ * Function to run grep over complete lines. Matches are found by searching the whole
+ * block for the pattern rather than line by line, so the lines between matches are
+ * skipped (or, with -v, passed on) without being looked at individually.
+ *
+ * @param filter: the grep filter
+ * @param block: complete lines, ending with a newline
+ * @param len: length of the block
+ * @return: FALSE if no more input is wanted
+ ***********************************************************************************/
+static int grepLines(struct filter *filter, const char *block, size_t len) {
+    const char *pos = block, *end = block + len, *match, *lineStart, *lineEnd;
+
+    while (pos < end) {
+        match = filter->patternLen > 0 ? findSubstring(pos, end - pos, filter->pattern, filter->patternLen) : pos;
+
+        // the lines before the matching line (or all of them) do not match
+        if (match == NULL) {
+            lineStart = lineEnd = end;
+        } else {
+            lineStart = memrchr(pos, '\n', match - pos);
+            lineStart = lineStart != NULL ? lineStart + 1 : pos;
+            lineEnd = (const char *) memchr(match, '\n', end - match) + 1;
+        }
+
+        if (filter->isInverted && lineStart > pos) {
+            filter->lines += countByte(pos, lineStart - pos, '\n');
+            if (!filter->isCount && !emit(filter, pos, lineStart - pos)) {
+                return FALSE;
+            }
+        } else if (!filter->isInverted && match != NULL) {
+            filter->lines++;
+            if (!filter->isCount && !emit(filter, lineStart, lineEnd - lineStart)) {
+                return FALSE;
+            }
+        }
+
+        pos = lineEnd;
+    }
+
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to drop all but the last lines kept by tail
+ *
+ * @param filter: the tail filter
+ ***********************************************************************************/
+static void trimTail(struct filter *filter) {
+    size_t len = filter->pendingLen, keep;
+    long long found = 0;
+    const char *newline;
+
+    if (filter->numLines == 0) {
+        filter->pendingLen = 0;
+        return;
+    }
+
+    // a final newline ends the last line rather than starting another
+    if (len > 0 && filter->pending[len - 1] == '\n') {
+        len--;
+    }
+    while (found < filter->numLines && (newline = memrchr(filter->pending, '\n', len)) != NULL) {
+        len = newline - filter->pending;
+        found++;
+    }
+
+    // keep everything if there are fewer lines than are wanted
+    if (found < filter->numLines) {
+        return;
+    }
+
+    keep = filter->pendingLen - (len + 1);
+    memmove(filter->pending, filter->pending + len + 1, keep);
+    filter->pendingLen = keep;
+}
+
+/************************************************************************************
+ * Function to give input to a filter
+ *
+ * @param filter: the filter
+ * @param data: the input
+ * @param len: length of the input
+ * @return: FALSE if no more input is wanted
+ ***********************************************************************************/
+static int pushFilter(struct filter *filter, const char *data, size_t len) {
+    const char *lastNewline, *newline;
+    size_t numLines, lineLen;
+
+    switch (filter->type) {
+        case FILTER_GREP:
+            // finish the incomplete line left by the last input
+            if (filter->pendingLen > 0) {
+                if ((newline = memchr(data, '\n', len)) == NULL) {
+                    appendPending(filter, data, len);
+                    return TRUE;
+                }
+                lineLen = newline + 1 - data;
+                appendPending(filter, data, lineLen);
+                numLines = filter->pendingLen;
+                filter->pendingLen = 0;
+                if (!grepLines(filter, filter->pending, numLines)) {
+                    return FALSE;
+                }
+                data += lineLen;
+                len -= lineLen;
+            }
+
+            // search the complete lines and keep the rest for the next input
+            if ((lastNewline = memrchr(data, '\n', len)) == NULL) {
+                appendPending(filter, data, len);
+                return TRUE;
+            }
+            lineLen = lastNewline + 1 - data;
+            appendPending(filter, data + lineLen, len - lineLen);
+            return grepLines(filter, data, lineLen);
+        case FILTER_WC:
+            if (filter->countLines) {
+                filter->lines += countByte(data, len, '\n');
+            }
+            filter->bytes += len;
+            return TRUE;
+        case FILTER_HEAD:
+            // pass on everything up to the newline ending the last line wanted
+            if (filter->lines <= 0) {
+                return FALSE;
+            }
+            numLines = filter->lines;
+            newline = findNthByte(data, len, '\n', &numLines);
+            filter->lines = newline != NULL ? 0 : (long long) numLines;
+            if (!emit(filter, data, newline != NULL ? (size_t) (newline + 1 - data) : len)) {
+                return FALSE;
+            }
+            return filter->lines > 0;
+        case FILTER_TAIL:
+            appendPending(filter, data, len);
+            if (filter->pendingLen > 2 * FILTER_BUF_SIZE) {
+                trimTail(filter);
+            }
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/************************************************************************************
+ * Function to tell a filter its input has ended, so it passes on its remaining output
+ * and tells the next filter in turn
+ *
+ * @param filter: the filter
+ ***********************************************************************************/
+static void finishFilter(struct filter *filter) {
+    char text[64];
+
+    switch (filter->type) {
+        case FILTER_GREP:
+            // the last line does not have to end with a newline
+            if (filter->pendingLen > 0) {
+                appendPending(filter, "\n", 1);
+                grepLines(filter, filter->pending, filter->pendingLen);
+            }
+            if (filter->isCount) {
+                snprintf(text, sizeof(text), "%lld\n", filter->lines);
+                emit(filter, text, strlen(text));
+            }
+            break;
+        case FILTER_WC:
+            if (filter->countLines && filter->countBytes) {
+                snprintf(text, sizeof(text), "%*lld %*lld\n", filter->width, filter->lines, filter->width, filter->bytes);
+            } else {
+                snprintf(text, sizeof(text), "%lld\n", filter->countLines ? filter->lines : filter->bytes);
+            }
+            emit(filter, text, strlen(text));
+            break;
+        case FILTER_TAIL:
+            trimTail(filter);
+            emit(filter, filter->pending, filter->pendingLen);
+            break;
+    }
+
+    if (filter->next != NULL) {
+        finishFilter(filter->next);
+    }
+}
+
+/************************************************************************************
+ * Function to run a chain of filters, each passing its output to the next, from an
+ * input to an output. Reading stops early once the chain wants no more input (after
+ * head has its lines), closing the input for whatever was writing it.
+ *
+ * @param filters: array of filters loaded by parseFilter, in the order of the chain
+ * @param numFilters: number of filters
+ * @param inFd: file descriptor to read from
+ * @param outFd: file descriptor to write to
+ * @return: exit status of the last filter
+ ***********************************************************************************/
+int runFilters(struct filter *filters, int numFilters, int inFd, int outFd) {
+    struct filterSink sink = {outFd, NULL, 0, FALSE};
+    char *input = MEM_CALLOC(MEM_FILTERS, FILTER_BUF_SIZE, sizeof(char));
+    struct filter *last = filters + numFilters - 1;
+    int i, status = 0;
+    ssize_t numRead;
+    struct stat info;
+
+    sink.buf = MEM_CALLOC(MEM_FILTERS, FILTER_BUF_SIZE, sizeof(char));
+    for (i = 0; i < numFilters; i++) {
+        filters[i].next = i + 1 < numFilters ? filters + i + 1 : NULL;
+        filters[i].sink = &sink;
+        filters[i].lines = filters[i].type == FILTER_HEAD ? filters[i].numLines : 0;
+        filters[i].width = FILTER_WC_WIDTH;
+    }
+
+    // as with coreutils the columns fit the size of a file read directly
+    if (fstat(inFd, &info) == 0 && S_ISREG(info.st_mode)) {
+        filters[0].width = snprintf(NULL, 0, "%lld", (long long) info.st_size);
+    }
+
+    while ((numRead = read(inFd, input, FILTER_BUF_SIZE)) != 0) {
+        if (numRead == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            status = 2;
+            break;
+        }
+        if (!pushFilter(filters, input, numRead)) {
+            break;
+        }
+    }
+    finishFilter(filters);
+    flushSink(&sink);
+
+    // grep fails if it selected no lines
+    if (last->type == FILTER_GREP && last->lines == 0 && status == 0) {
+        status = 1;
+    }
+    if (sink.isBroken && status == 0) {
+        status = 1;
+    }
+
+    for (i = 0; i < numFilters; i++) {
+        MEM_FREE(filters[i].pending);
+        filters[i].pending = NULL;
+    }
+    MEM_FREE(input);
+    MEM_FREE(sink.buf);
+
+    return status;
+}
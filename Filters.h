@@ -0,0 +1,75 @@
+/************************************************************************************
+ * This file defines functions related to the filter built ins, which run common
+ * pipeline stages in the shell instead of forking and executing a program:
+ *
+ *   grep [-F] [-v] [-c] pattern   lines containing a fixed string
+ *   wc -l | -c | -lc              line and byte counts
+ *   head [-n N | -N]              the first N lines (10 by default)
+ *   tail [-n N | -N]              the last N lines (10 by default)
+ *
+ * Other forms (files as operands, regular expressions, other options) are left to the
+ * programs on the PATH. Consecutive filters of a pipeline are chained in one process,
+ * each passing its output to the next in memory, and input is read in large blocks
+ * that are searched with the simd scans in Scan.h.
+ ***********************************************************************************/
+#ifndef CS344_FILTERS_H
+#define CS344_FILTERS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "CommandParser.h"
+#include "Scan.h"
+
+// kinds of filter
+#define FILTER_GREP 1
+#define FILTER_WC 2
+#define FILTER_HEAD 3
+#define FILTER_TAIL 4
+
+#define FILTER_BUF_SIZE (256 * 1024)  // size of the reads and of the output buffer
+#define FILTER_DEFAULT_LINES 10
+#define FILTER_WC_WIDTH 7  // width of wc's columns unless reading a regular file
+
+// structure holding the options and state of a filter in a chain
+struct filter {
+    int type;  // FILTER_ value
+
+    // options
+    char *pattern;   // grep
+    size_t patternLen;
+    int isInverted;  // grep -v
+    int isCount;     // grep -c
+    int countLines;  // wc -l
+    int countBytes;  // wc -c
+    long long numLines;  // head and tail
+    int width;           // width of wc's columns when counting both
+
+    // the incomplete last line given to grep, or the lines kept by tail
+    char *pending;
+    size_t pendingLen;
+    size_t pendingCap;
+
+    long long lines;     // lines selected by grep, counted by wc, or left for head
+    long long bytes;     // bytes counted by wc
+    struct filter *next;
+    struct filterSink *sink;
+};
+
+// structure for the buffered output of the last filter in a chain
+struct filterSink {
+    int fd;
+    char *buf;
+    size_t len;
+    int isBroken;  // set if the output could not be written
+};
+
+int parseFilter(struct command *cmd, struct filter *filter);
+int isFilter(struct command *cmd);
+int runFilters(struct filter *filters, int numFilters, int inFd, int outFd);
+
+#endif //CS344_FILTERS_H
@@ -0,0 +1,319 @@
+#include "Functions.h"
+#include "Events.h"
+
+// tables of the defined functions and aliases by name
+static struct hashTable *functions = NULL;
+static struct hashTable *aliases = NULL;
+
+// names of the aliases being expanded, which are not expanded again
+static char *expanding[ALIAS_MAX_DEPTH];
+static int numExpanding = 0;
+
+// number of function calls running in the shell
+static int callDepth = 0;
+
+/************************************************************************************
+ * Function to find a defined function
+ *
+ * @param name: name of the function
+ * @return: the function or NULL if there is none by that name
+ ***********************************************************************************/
+struct shellFunction *findFunction(const char *name) {
+    return functions != NULL ? tableGet(functions, name) : NULL;
+}
+
+/************************************************************************************
+ * Function to check if a name has been defined as a function or an alias, in which
+ * case the command can not simply be executed from the PATH
+ *
+ * @param name: name of the command
+ * @return: TRUE if there is a function or alias by that name
+ ***********************************************************************************/
+int isDefined(const char *name) {
+    return findFunction(name) != NULL || (aliases != NULL && tableGet(aliases, name) != NULL);
+}
+
+/************************************************************************************
+ * Function to define a function, taking the parsed body from its definition. A
+ * function that is redefined while it is running is freed when its calls return.
+ *
+ * @param cmd: the function definition
+ ***********************************************************************************/
+void defineFunction(struct command *cmd) {
+    struct shellFunction *func = MEM_CALLOC(MEM_FUNCTIONS, 1, sizeof(struct shellFunction)), *old;
+
+    if (functions == NULL) {
+        functions = createTable(DEFAULT_BUCKETS);
+    }
+
+    func->body = cmd->body;
+    func->bodyArgs = cmd->bodyArgs;
+    cmd->body = NULL;
+    cmd->bodyArgs = NULL;
+
+    old = tablePut(functions, cmd->args[0], func);
+    if (old != NULL && old->numCalls > 0) {
+        old->isStale = TRUE;
+    } else if (old != NULL) {
+        freeFunction(old);
+    }
+}
+
+/************************************************************************************
+ * Function to free a function and its body
+ *
+ * @param value: the function
+ ***********************************************************************************/
+void freeFunction(void *value) {
+    struct shellFunction *func = value;
+
+    freeCommand(func->body);
+    MEM_FREE(func->bodyArgs);
+    MEM_FREE(func);
+}
+
+/************************************************************************************
+ * Function to call a function in the shell. A call with redirections or in the
+ * background is run in a child like other commands instead (see runFunction).
+ *
+ * @param cmd: the command calling the function
+ * @param func: the function
+ * @param procList: linked list of outstanding processes
+ * @param isForeOnlyMode: pointer to the foreground only flag
+ * @return: exit status of the last command of the body that was run
+ ***********************************************************************************/
+int callFunction(struct command *cmd, struct shellFunction *func, struct processLinkedList *procList, int *isForeOnlyMode) {
+    if (callDepth >= FUNCTION_MAX_DEPTH) {
+        queueFormat("%s: maximum function call depth exceeded\n", cmd->args[0]);
+        return 1;
+    }
+
+    callDepth++;
+    func->numCalls++;
+    executeList(func->body, procList, isForeOnlyMode);
+    func->numCalls--;
+    callDepth--;
+
+    if (func->isStale && func->numCalls == 0) {
+        freeFunction(func);
+    }
+
+    return lastExitStatus;
+}
+
+/************************************************************************************
+ * Function to run a function's body in a forked child, after its handlers and
+ * redirections have been applied. It never returns, exiting with the status of the
+ * body once the body's own processes have finished.
+ *
+ * @param func: the function
+ ***********************************************************************************/
+void runFunction(struct shellFunction *func) {
+    struct processLinkedList subProcs = {NULL, NULL};
+    struct processNode *node;
+    int isForeOnlyMode = FALSE;
+
+    // only the shell publishes metrics, events and prompts
+    detachMetrics();
+    detachEvents();
+    showPrompt = FALSE;
+    executeList(func->body, &subProcs, &isForeOnlyMode);
+    flushOutput();
+
+    // wait for anything the body left running as the shell will not see it
+    for (node = subProcs.head; node != NULL; node = node->next) {
+        while (waitpid(node->pid, NULL, 0) == -1 && errno == EINTR);
+    }
+    _exit(lastExitStatus);
+}
+
+/************************************************************************************
+ * Function to run a command whose name is an alias with the alias's words in place of
+ * the name. The expanded command is dispatched again, so an alias may name a built
+ * in, a function or another alias, but an alias is not expanded within itself.
+ *
+ * @param cmd: the command
+ * @param procList: linked list of outstanding processes
+ * @param isForeOnlyMode: pointer to the foreground only flag
+ * @return: FALSE if the name is not an alias (the command was not run)
+ ***********************************************************************************/
+int expandAlias(struct command *cmd, struct processLinkedList *procList, int *isForeOnlyMode) {
+    struct shellAlias *alias = aliases != NULL ? tableGet(aliases, cmd->args[0]) : NULL;
+    char **savedArgs = cmd->args, **args, *name;
+    int i, numWords, savedNumArgs = cmd->numArgs;
+    struct procSub *sub;
+
+    for (i = 0; alias != NULL && i < numExpanding; i++) {
+        if (strcmp(expanding[i], cmd->args[0]) == 0) {
+            alias = NULL;
+        }
+    }
+    if (alias == NULL) {
+        return FALSE;
+    }
+
+    numWords = alias->numWords;
+    if (numExpanding == ALIAS_MAX_DEPTH || numWords + cmd->numArgs > MAX_ARGS) {
+        queueFormat("%s: alias expansion too long\n", cmd->args[0]);
+        lastExitStatus = 1;
+        return TRUE;
+    }
+
+    // the alias may be redefined while it runs so its words are copied
+    args = MEM_CALLOC(MEM_PARSER, numWords + cmd->numArgs, sizeof(char *));
+    for (i = 0; i < numWords; i++) {
+        args[i] = MEM_CALLOC(MEM_PARSER, strlen(alias->words[i]) + 1, sizeof(char));
+        strcpy(args[i], alias->words[i]);
+    }
+    memcpy(args + numWords, cmd->args + 1, (cmd->numArgs - 1) * sizeof(char *));
+
+    name = MEM_CALLOC(MEM_PARSER, strlen(cmd->args[0]) + 1, sizeof(char));
+    strcpy(name, cmd->args[0]);
+    expanding[numExpanding++] = name;
+
+    // run the command with the expanded args, moving its substitutions along with them
+    cmd->args = args;
+    cmd->numArgs = numWords + savedNumArgs - 1;
+    for (sub = cmd->procSubs; sub != NULL; sub = sub->next) {
+        sub->argIdx += sub->argIdx >= 0 ? numWords - 1 : 0;
+    }
+    executeCommand(cmd, procList, isForeOnlyMode);
+
+    // put back the command's own args, which may have been replaced while it ran
+    for (sub = cmd->procSubs; sub != NULL; sub = sub->next) {
+        sub->argIdx -= sub->argIdx >= 0 ? numWords - 1 : 0;
+    }
+    memcpy(savedArgs + 1, args + numWords, (savedNumArgs - 1) * sizeof(char *));
+    for (i = 0; i < numWords; i++) {
+        MEM_FREE(args[i]);
+    }
+    MEM_FREE(args);
+    cmd->args = savedArgs;
+    cmd->numArgs = savedNumArgs;
+
+    MEM_FREE(expanding[--numExpanding]);
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to free an alias and its words
+ *
+ * @param value: the alias
+ ***********************************************************************************/
+void freeAlias(void *value) {
+    struct shellAlias *alias = value;
+    int i;
+
+    for (i = 0; i < alias->numWords; i++) {
+        MEM_FREE(alias->words[i]);
+    }
+    MEM_FREE(alias->words);
+    MEM_FREE(alias);
+}
+
+/************************************************************************************
+ * Function to queue the definition of an alias
+ *
+ * @param name: name of the alias
+ * @param value: the alias
+ ***********************************************************************************/
+static void showAlias(const char *name, void *value) {
+    struct shellAlias *alias = value;
+    int i;
+
+    queueFormat("alias %s=", name);
+    for (i = 0; i < alias->numWords; i++) {
+        queueFormat(i ? " %s" : "%s", alias->words[i]);
+    }
+    queueConstant("\n");
+}
+
+/************************************************************************************
+ * Function to implement the alias built in command. With no args every alias is
+ * shown, "alias name" shows one alias and "alias name=word [words...]" defines one.
+ *
+ * @param cmd: the alias command
+ * @return: exit status of the command
+ ***********************************************************************************/
+int aliasCommand(struct command *cmd) {
+    struct shellAlias *alias, *old;
+    char *equals;
+    int i;
+
+    if (aliases == NULL) {
+        aliases = createTable(DEFAULT_BUCKETS);
+    }
+
+    if (cmd->numArgs < 2) {
+        tableForEach(aliases, showAlias);
+        return 0;
+    }
+
+    // show a single alias
+    if ((equals = strchr(cmd->args[1], '=')) == NULL) {
+        if ((alias = tableGet(aliases, cmd->args[1])) == NULL) {
+            queueFormat("alias: %s: not found\n", cmd->args[1]);
+            return 1;
+        }
+        showAlias(cmd->args[1], alias);
+        return 0;
+    }
+
+    if (equals == cmd->args[1] || (equals[1] == '\0' && cmd->numArgs == 2)) {
+        queueConstant("usage: alias [name[=word [words...]]]\n");
+        return 1;
+    }
+
+    // the first word follows the = and the rest are the remaining args
+    alias = MEM_CALLOC(MEM_FUNCTIONS, 1, sizeof(struct shellAlias));
+    alias->words = MEM_CALLOC(MEM_FUNCTIONS, cmd->numArgs, sizeof(char *));
+    if (equals[1] != '\0') {
+        alias->words[alias->numWords] = MEM_CALLOC(MEM_FUNCTIONS, strlen(equals + 1) + 1, sizeof(char));
+        strcpy(alias->words[alias->numWords++], equals + 1);
+    }
+    for (i = 2; i < cmd->numArgs; i++) {
+        alias->words[alias->numWords] = MEM_CALLOC(MEM_FUNCTIONS, strlen(cmd->args[i]) + 1, sizeof(char));
+        strcpy(alias->words[alias->numWords++], cmd->args[i]);
+    }
+
+    *equals = '\0';
+    old = tablePut(aliases, cmd->args[1], alias);
+    *equals = '=';
+    if (old != NULL) {
+        freeAlias(old);
+    }
+
+    return 0;
+}
+
+/************************************************************************************
+ * Function to implement the unalias built in command, removing each alias named or
+ * every alias with -a
+ *
+ * @param cmd: the unalias command
+ * @return: exit status of the command (1 if an alias was not found)
+ ***********************************************************************************/
+int unaliasCommand(struct command *cmd) {
+    struct shellAlias *alias;
+    int i, res = 0;
+
+    if (cmd->numArgs < 2) {
+        queueConstant("usage: unalias -a | name [names...]\n");
+        return 1;
+    }
+
+    for (i = 1; i < cmd->numArgs; i++) {
+        if (strcmp(cmd->args[i], "-a") == 0) {
+            if (aliases != NULL) {
+                clearTable(aliases, freeAlias);
+            }
+        } else if (aliases != NULL && (alias = tableRemove(aliases, cmd->args[i])) != NULL) {
+            freeAlias(alias);
+        } else {
+            queueFormat("unalias: %s: not found\n", cmd->args[i]);
+            res = 1;
+        }
+    }
+
+    return res;
+}
@@ -0,0 +1,53 @@
+/************************************************************************************
+ * This file defines functions related to the aliases and shell functions the user
+ * defines. Both are kept in hash tables by name. A command that is not built in is
+ * looked up as a function, then as an alias, and only then searched for on the PATH.
+ *
+ * A function is defined with "name() { list }" or "function name { list }" and its
+ * body is kept parsed, so a call runs the stored command list directly: in the shell
+ * itself when the call has no redirections and is not run in the background, and
+ * otherwise in a forked copy of the shell like any other command.
+ *
+ * An alias is defined with "alias name=word [words...]" and replaces the name with its
+ * words when the command runs, ahead of the rest of the command's args.
+ ***********************************************************************************/
+#ifndef CS344_FUNCTIONS_H
+#define CS344_FUNCTIONS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "CommandParser.h"
+#include "CommandDelegator.h"
+#include "HashTable.h"
+
+#define ALIAS_MAX_DEPTH 16      // most aliases being expanded at once (for alias loops)
+#define FUNCTION_MAX_DEPTH 100  // most function calls running in the shell at once
+
+// structure to hold a defined function
+struct shellFunction {
+    struct command *body;
+    char **bodyArgs;
+    int numCalls;  // calls of the function running in the shell
+    int isStale;   // set if redefined during a call, freed when the last call returns
+};
+
+// structure to hold a defined alias
+struct shellAlias {
+    char **words;
+    int numWords;
+};
+
+struct shellFunction *findFunction(const char *name);
+int isDefined(const char *name);
+void defineFunction(struct command *cmd);
+void freeFunction(void *value);
+int callFunction(struct command *cmd, struct shellFunction *func, struct processLinkedList *procList, int *isForeOnlyMode);
+void runFunction(struct shellFunction *func);
+int expandAlias(struct command *cmd, struct processLinkedList *procList, int *isForeOnlyMode);
+void freeAlias(void *value);
+int aliasCommand(struct command *cmd);
+int unaliasCommand(struct command *cmd);
+
+#endif //CS344_FUNCTIONS_H
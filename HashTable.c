@@ -0,0 +1,166 @@
+#include "HashTable.h"
+
+/************************************************************************************
+ * Function to create an empty hash table
+ *
+ * @param numBuckets: number of buckets in the table
+ * @return: the new table
+ ***********************************************************************************/
+struct hashTable *createTable(int numBuckets) {
+    struct hashTable *table = MEM_CALLOC(MEM_TABLE, 1, sizeof(struct hashTable));
+    table->numBuckets = numBuckets;
+    table->buckets = MEM_CALLOC(MEM_TABLE, numBuckets, sizeof(struct hashEntry *));
+    return table;
+}
+
+/************************************************************************************
+ * Function to find the bucket a key belongs in
+ *
+ * @param table: table containing the bucket
+ * @param key: key to find the bucket for
+ * @return: pointer to the head of the bucket's list
+ ***********************************************************************************/
+static struct hashEntry **findBucket(struct hashTable *table, const char *key) {
+    return &table->buckets[hashBytes(key, strlen(key)) % table->numBuckets];
+}
+
+/************************************************************************************
+ * Function to look up the value stored for a key
+ *
+ * @param table: table to search
+ * @param key: key to look up
+ * @return: the value or NULL if the key is not in the table
+ ***********************************************************************************/
+void *tableGet(struct hashTable *table, const char *key) {
+    struct hashEntry *cur = *findBucket(table, key);
+
+    while (cur != NULL) {
+        if (strcmp(cur->key, key) == 0) {
+            return cur->value;
+        }
+        cur = cur->next;
+    }
+
+    return NULL;
+}
+
+/************************************************************************************
+ * Function to store a value for a key, replacing any value already stored for it
+ *
+ * @param table: table to store the value in
+ * @param key: key to store the value under (copied)
+ * @param value: value to store
+ * @return: the replaced value or NULL if the key was not in the table
+ ***********************************************************************************/
+void *tablePut(struct hashTable *table, const char *key, void *value) {
+    struct hashEntry **bucket = findBucket(table, key);
+    struct hashEntry *cur = *bucket;
+    void *old;
+
+    // if the key is already present replace its value
+    while (cur != NULL) {
+        if (strcmp(cur->key, key) == 0) {
+            old = cur->value;
+            cur->value = value;
+            return old;
+        }
+        cur = cur->next;
+    }
+
+    // otherwise add a new entry to the front of the bucket
+    cur = MEM_CALLOC(MEM_TABLE, 1, sizeof(struct hashEntry));
+    cur->key = MEM_CALLOC(MEM_TABLE, strlen(key) + 1, sizeof(char));
+    strcpy(cur->key, key);
+    cur->value = value;
+    cur->next = *bucket;
+    *bucket = cur;
+    table->numEntries++;
+
+    return NULL;
+}
+
+/************************************************************************************
+ * Function to remove a key from the table
+ *
+ * @param table: table to remove the key from
+ * @param key: key to remove
+ * @return: the value that was stored for the key or NULL if it was not present
+ ***********************************************************************************/
+void *tableRemove(struct hashTable *table, const char *key) {
+    struct hashEntry **link = findBucket(table, key);
+    struct hashEntry *cur;
+    void *value;
+
+    while ((cur = *link) != NULL) {
+        if (strcmp(cur->key, key) == 0) {
+            // unlink the entry and free it, handing the value back to the caller
+            *link = cur->next;
+            value = cur->value;
+            MEM_FREE(cur->key);
+            MEM_FREE(cur);
+            table->numEntries--;
+            return value;
+        }
+        link = &cur->next;
+    }
+
+    return NULL;
+}
+
+/************************************************************************************
+ * Function to visit every entry of the table, in no particular order
+ *
+ * @param table: table to visit
+ * @param visit: function called with the key and value of each entry
+ ***********************************************************************************/
+void tableForEach(struct hashTable *table, void (*visit)(const char *, void *)) {
+    struct hashEntry *cur;
+    int i;
+
+    for (i = 0; i < table->numBuckets; i++) {
+        for (cur = table->buckets[i]; cur != NULL; cur = cur->next) {
+            visit(cur->key, cur->value);
+        }
+    }
+}
+
+/************************************************************************************
+ * Function to remove every entry from the table
+ *
+ * @param table: table to clear
+ * @param freeValue: function used to free each value (NULL to leave them alone)
+ ***********************************************************************************/
+void clearTable(struct hashTable *table, void (*freeValue)(void *)) {
+    struct hashEntry *cur, *next;
+    int i;
+
+    for (i = 0; i < table->numBuckets; i++) {
+        cur = table->buckets[i];
+        while (cur != NULL) {
+            next = cur->next;
+            if (freeValue != NULL) {
+                freeValue(cur->value);
+            }
+            MEM_FREE(cur->key);
+            MEM_FREE(cur);
+            cur = next;
+        }
+        table->buckets[i] = NULL;
+    }
+
+    table->numEntries = 0;
+}
+
+/************************************************************************************
+ * Function to free the table and all of its entries
+ *
+ * @param table: table to free
+ * @param freeValue: function used to free each value (NULL to leave them alone)
+ ***********************************************************************************/
+void freeTable(struct hashTable *table, void (*freeValue)(void *)) {
+    if (table != NULL) {
+        clearTable(table, freeValue);
+        MEM_FREE(table->buckets);
+        MEM_FREE(table);
+    }
+}
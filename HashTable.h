@@ -0,0 +1,38 @@
+/************************************************************************************
+ * This file defines a simple hash table mapping strings to values, used for the
+ * caches and name tables kept by the shell
+ ***********************************************************************************/
+#ifndef CS344_HASHTABLE_H
+#define CS344_HASHTABLE_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Utils.h"
+#include "Memory.h"
+
+#define DEFAULT_BUCKETS 64
+
+// structure to create a node for a bucket's linked list of entries
+struct hashEntry {
+    char *key;
+    void *value;
+    struct hashEntry *next;
+};
+
+// structure to hold the table of buckets
+struct hashTable {
+    struct hashEntry **buckets;
+    int numBuckets;
+    int numEntries;
+};
+
+struct hashTable *createTable(int numBuckets);
+void *tableGet(struct hashTable *table, const char *key);
+void *tablePut(struct hashTable *table, const char *key, void *value);
+void *tableRemove(struct hashTable *table, const char *key);
+void tableForEach(struct hashTable *table, void (*visit)(const char *, void *));
+void clearTable(struct hashTable *table, void (*freeValue)(void *));
+void freeTable(struct hashTable *table, void (*freeValue)(void *));
+
+#endif //CS344_HASHTABLE_H
@@ -1,4 +1,6 @@
 #include "InterruptHandlers.h"
+#include "Events.h"
+#include "JobControl.h"
 
 volatile sig_atomic_t toggleFgMode = 0;
 
@@ -32,7 +34,9 @@ void printHandlers(int processMask) {
 
 /*************************************************************************************
  * This function will set the signal handlers for SIGINT and SIGTSTP based on the
- * process state as communicated by the processMask integer value
+ * process state as communicated by the processMask integer value. The shell passes
+ * the signals on to its foreground job, while children are left with the default
+ * dispositions since only the foreground job's process group is ever signalled.
  *
  * @param processMask: integer value containing bits set to indicate which
  * combination of states the current process is in
@@ -45,32 +49,48 @@ void loadHandlers(int processMask) {
     // creat struct for SIGTSTP handler
     struct sigaction SIGTSTP_action = {0};
     sigaddset(&SIGTSTP_action.sa_mask, SIGTSTP);
+    sigset_t signals;
 
     // set the appropriate handlers based on combination of states indicated by processMask
-    if (processMask & BACKGROUND) {
-        SIGINT_action.sa_handler = OBLIVIOUS;
-        SIGTSTP_action.sa_handler = OBLIVIOUS;
+    if (processMask & CHILD) {
+        SIGINT_action.sa_handler = FILICIDE;
+        SIGTSTP_action.sa_handler = FILICIDE;
     } else if (processMask & PARENT){
-        SIGINT_action.sa_handler = OBLIVIOUS;
+        SIGINT_action.sa_handler = forwardInterrupt;
         SIGTSTP_action.sa_handler = toggleFgOnlyMode;
-    } else if (processMask & FOREGROUND) {
-        SIGINT_action.sa_handler = FILICIDE;
-        SIGTSTP_action.sa_handler = OBLIVIOUS;
     }
 
     // load the custom handlers
     sigaction(SIGINT, &SIGINT_action, NULL);
     sigaction(SIGTSTP, &SIGTSTP_action, NULL);
+
+    // children start with the signals unblocked and the terminal signals the shell
+    // ignores restored, and do no job control of their own
+    if (processMask & CHILD) {
+        signal(SIGTTOU, FILICIDE);
+        signal(SIGTTIN, FILICIDE);
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTSTP);
+        sigaddset(&signals, SIGCHLD);
+        sigprocmask(SIG_UNBLOCK, &signals, NULL);
+        jobControl = JOBS_NONE;
+        foregroundPgid = 0;
+    }
 }
 
 /*************************************************************************************
  * The function handles SIGTSTP interrupt signals to set the toggle flag for FG only
- * mode
+ * mode, or passes the signal on to the foreground job if there is one
  *
  * @param signum: an integer indicating the signal that the process received
  ************************************************************************************/
 void toggleFgOnlyMode(int signum) {
-    toggleFgMode = 1;
+    if (foregroundPgid > 0) {
+        forwardInterrupt(signum);
+    } else {
+        toggleFgMode = 1;
+    }
 }
 
 /*************************************************************************************
@@ -88,6 +108,7 @@ void applyFgOnlyToggle(int *isForeOnly) {
 
     // print the mode change message
     printForeGroundMsg(*isForeOnly);
+    eventModeToggled(*isForeOnly);
 }
 
 /*************************************************************************************
@@ -97,11 +118,9 @@ void applyFgOnlyToggle(int *isForeOnly) {
  ************************************************************************************/
 void printForeGroundMsg(int isFgOnly) {
     if (isFgOnly){
-        printf("\033[93mEntering foreground-only mode (& is now ignored)\033[96m\n");
-        fflush(stdout);
+        queueConstant("\033[93mEntering foreground-only mode (& is now ignored)\033[96m\n");
     } else {
-        printf("\033[93mExiting foreground-only mode\033[96m\n");
-        fflush(stdout);
+        queueConstant("\033[93mExiting foreground-only mode\033[96m\n");
     }
 }
 
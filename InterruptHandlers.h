@@ -13,6 +13,7 @@
 #include <errno.h>
 
 #include "CommandParser.h"
+#include "Output.h"
 
 #define CHILD 1
 #define PARENT 2
@@ -0,0 +1,389 @@
+#include "JobControl.h"
+#include "Timeout.h"
+#include "JobState.h"
+#include "Variables.h"
+#include "Prompt.h"
+
+// kind of job control done by this process (children do none of their own)
+int jobControl = JOBS_NONE;
+
+// process group of the job in the foreground (0 while the shell is)
+volatile sig_atomic_t foregroundPgid = 0;
+
+// process group the shell takes the terminal back for
+static pid_t shellPgid = 0;
+
+// signalfd reporting SIGCHLD so the shell can see a foreground job stop
+static int childFd = -1;
+
+/************************************************************************************
+ * Function to start job control for the shell. The foreground job is given the
+ * terminal when the shell is in the foreground of one, otherwise ^C and ^Z are
+ * forwarded to it by the shell.
+ ***********************************************************************************/
+void initJobControl() {
+    struct sigaction ignore = {0};
+    sigset_t signals;
+
+    shellPgid = getpgrp();
+    if (isatty(STDIN_FILENO) && tcgetpgrp(STDIN_FILENO) == shellPgid) {
+        jobControl = JOBS_TERMINAL;
+
+        // the shell takes the terminal back while it is in the background of it
+        ignore.sa_handler = OBLIVIOUS;
+        sigaction(SIGTTOU, &ignore, NULL);
+        sigaction(SIGTTIN, &ignore, NULL);
+    } else {
+        jobControl = JOBS_FORWARD;
+    }
+
+    // SIGCHLD is blocked and read from a signalfd (children unblock it)
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+    childFd = moveHigh(signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC));
+}
+
+/************************************************************************************
+ * Function to put a process in the process group of its job. Both the shell and the
+ * child call it so neither can run ahead of the other.
+ *
+ * @param pid: the process
+ * @param pgid: process group of the job (the process's own pid for a new job)
+ * @param isForeground: TRUE if the job is run in the foreground
+ ***********************************************************************************/
+void joinJob(pid_t pid, pid_t pgid, int isForeground) {
+    if (jobControl == JOBS_NONE) {
+        return;
+    }
+
+    setpgid(pid, pgid);
+    if (isForeground) {
+        giveTerminal(pgid);
+    }
+}
+
+/************************************************************************************
+ * Function to make a job the foreground job, giving it the terminal if there is one
+ *
+ * @param pgid: process group of the job
+ ***********************************************************************************/
+void giveTerminal(pid_t pgid) {
+    if (jobControl == JOBS_NONE) {
+        return;
+    }
+
+    foregroundPgid = pgid;
+    if (jobControl == JOBS_TERMINAL) {
+        tcsetpgrp(STDIN_FILENO, pgid);
+    }
+}
+
+/************************************************************************************
+ * Function to put the shell back in the foreground once the foreground job has
+ * finished or stopped
+ ***********************************************************************************/
+void reclaimTerminal() {
+    foregroundPgid = 0;
+    if (jobControl == JOBS_TERMINAL) {
+        tcsetpgrp(STDIN_FILENO, shellPgid);
+    }
+}
+
+/************************************************************************************
+ * Function to send a signal to every process of a job. Without job control the job
+ * shares the group of the shell, so only its process is signalled.
+ *
+ * @param pgid: process group of the job (its pid without job control)
+ * @param signal: the signal to send
+ ***********************************************************************************/
+void signalJob(pid_t pgid, int signal) {
+    kill(jobControl == JOBS_NONE ? pgid : -pgid, signal);
+}
+
+/************************************************************************************
+ * The function handles SIGINT in the shell by passing it on to the foreground job,
+ * which is not in the group the signal was sent to unless it has the terminal
+ *
+ * @param signum: an integer indicating the signal that the process received
+ ************************************************************************************/
+void forwardInterrupt(int signum) {
+    int savedErrno = errno;
+
+    if (foregroundPgid > 0) {
+        kill(-foregroundPgid, signum);
+    }
+    errno = savedErrno;
+}
+
+/************************************************************************************
+ * Function to get the signalfd that becomes readable when a child changes state
+ *
+ * @return: the signalfd (-1 without job control)
+ ***********************************************************************************/
+int childSignalFd() {
+    struct signalfd_siginfo info[8];
+
+    // the signals already reported are read so the fd only wakes for new ones
+    if (childFd != -1) {
+        while (read(childFd, info, sizeof(info)) > 0);
+    }
+
+    return childFd;
+}
+
+/************************************************************************************
+ * Function to check if a child has stopped, collecting the report of the stop
+ *
+ * @param pid: the child
+ * @return: TRUE if the child has stopped
+ ***********************************************************************************/
+int checkStopped(pid_t pid) {
+    siginfo_t info;
+
+    info.si_pid = 0;
+    return waitid(P_PID, pid, &info, WSTOPPED | WNOHANG) == 0 && info.si_pid == pid;
+}
+
+/************************************************************************************
+ * Function to queue the notice of a job being stopped
+ *
+ * @param pid: the job's (last) process
+ ***********************************************************************************/
+void announceStopped(pid_t pid) {
+    queueConstant("background pid ");
+    queueInt(pid);
+    queueConstant(" is stopped\n");
+}
+
+/************************************************************************************
+ * Function to mark a process stopped in the foreground as stopped. The process that
+ * reports the job is announced and its stop becomes the shell's status.
+ *
+ * @param procList: linked list of outstanding processes
+ * @param node: process node of the process
+ ***********************************************************************************/
+static void markStopped(struct processLinkedList *procList, struct processNode *node) {
+    char stat[100];
+
+    node->isStopped = TRUE;
+    if (!node->isQuiet) {
+        announceStopped(node->pid);
+        lastExitStatus = STOPPED_EXIT_STATUS;
+        sprintf(stat, "stopped by signal %d\n", SIGTSTP);
+        setShellVar(STATUS, stat);
+        metricsSetStatus(lastExitStatus, stat);
+    }
+    saveJobState(procList);
+}
+
+/************************************************************************************
+ * Function to keep a foreground process that stopped as a background job
+ *
+ * @param procList: linked list of outstanding processes
+ * @param pid: the process
+ * @param pgid: process group of its job
+ * @param cmd: command the process is running
+ * @param isQuiet: TRUE if another process of the job reports it
+ * @return: process node of the process
+ ***********************************************************************************/
+struct processNode *stopJob(struct processLinkedList *procList, pid_t pid, pid_t pgid, struct command *cmd, int isQuiet) {
+    struct processNode *node;
+
+    addProcess(procList, pid);
+    node = procList->tail;
+    node->pgid = pgid;
+    node->isQuiet = isQuiet;
+    setProcessCommand(node, cmd);
+    markStopped(procList, node);
+
+    return node;
+}
+
+/************************************************************************************
+ * Function to find the job fg or bg acts on: the one with the pid given, or else the
+ * most recent job. Jobs adopted from another shell are not children of this one.
+ *
+ * @param cmd: the fg or bg command
+ * @param procList: linked list of outstanding processes
+ * @return: process node reporting the job, or NULL if there is none
+ ***********************************************************************************/
+struct processNode *findJob(struct command *cmd, struct processLinkedList *procList) {
+    struct processNode *cur, *job = NULL;
+
+    if (jobControl == JOBS_NONE) {
+        queueFormat("%s: no job control\n", cmd->args[0]);
+        return NULL;
+    }
+
+    if (cmd->numArgs > 1) {
+        job = findProcess(procList, atoi(cmd->args[1]));
+        if (job == NULL || job->pidFd != -1 || job->pgid == 0) {
+            queueFormat("%s: %s: no such job\n", cmd->args[0], cmd->args[1]);
+            return NULL;
+        }
+        return job;
+    }
+
+    for (cur = procList->head; cur != NULL; cur = cur->next) {
+        if (!cur->isQuiet && cur->pidFd == -1 && cur->pgid != 0) {
+            job = cur;
+        }
+    }
+    if (job == NULL) {
+        queueFormat("%s: no current job\n", cmd->args[0]);
+    }
+
+    return job;
+}
+
+/************************************************************************************
+ * Function to take the processes of a job out of the process list, keeping their
+ * nodes
+ *
+ * @param procList: linked list of outstanding processes
+ * @param pgid: process group of the job
+ * @param numMembers: loaded with the number of processes taken
+ * @return: array of the processes' nodes, in the order they were started
+ ***********************************************************************************/
+static struct processNode **takeJob(struct processLinkedList *procList, pid_t pgid, int *numMembers) {
+    struct processNode *cur, *next, *prev = NULL, **members;
+
+    *numMembers = 0;
+    for (cur = procList->head; cur != NULL; cur = cur->next) {
+        *numMembers += cur->pgid == pgid && cur->pidFd == -1;
+    }
+    members = MEM_CALLOC(MEM_JOBS, *numMembers, sizeof(struct processNode *));
+
+    *numMembers = 0;
+    for (cur = procList->head; cur != NULL; cur = next) {
+        next = cur->next;
+        if (cur->pgid == pgid && cur->pidFd == -1) {
+            if (prev == NULL) {
+                procList->head = next;
+            } else {
+                prev->next = next;
+            }
+            cur->next = NULL;
+            members[(*numMembers)++] = cur;
+        } else {
+            prev = cur;
+        }
+    }
+    procList->tail = prev;
+
+    saveJobState(procList);
+    promptJobsChanged(procList);
+    return members;
+}
+
+/************************************************************************************
+ * Function to put a process node taken by takeJob back at the end of the list
+ *
+ * @param procList: linked list of outstanding processes
+ * @param node: the process node
+ ***********************************************************************************/
+static void returnProcess(struct processLinkedList *procList, struct processNode *node) {
+    if (procList->tail != NULL) {
+        procList->tail->next = node;
+    } else {
+        procList->head = node;
+    }
+    procList->tail = node;
+    promptJobsChanged(procList);
+}
+
+/************************************************************************************
+ * Function to implement the fg built in command. The job is given the terminal and
+ * continued, then waited for like any foreground job, including its deadline if it
+ * was started by timeout.
+ *
+ * @param cmd: the fg command
+ * @param procList: linked list of outstanding processes
+ * @param isForeOnlyMode: pointer to the foreground only flag
+ * @return: exit status of the job, STOPPED_EXIT_STATUS if it was stopped again, or
+ *          JOB_FAILED_STATUS if there is no such job
+ ***********************************************************************************/
+int fgCommand(struct command *cmd, struct processLinkedList *procList, int *isForeOnlyMode) {
+    struct processNode *job = findJob(cmd, procList), **members;
+    int i, numMembers, isStopped = FALSE;
+    pid_t pgid;
+
+    if (job == NULL) {
+        return JOB_FAILED_STATUS;
+    }
+
+    // show the job's command line, as it will now have the terminal
+    pgid = job->pgid;
+    queueString(job->command);
+    queueConstant("\n");
+    members = takeJob(procList, pgid, &numMembers);
+
+    // reports of the job having stopped are collected so they are not seen again
+    for (i = 0; i < numMembers; i++) {
+        checkStopped(members[i]->pid);
+        members[i]->isStopped = FALSE;
+    }
+
+    flushOutput();
+    giveTerminal(pgid);
+    signalJob(pgid, SIGCONT);
+
+    // wait for every process, only reporting how the job's last one finished
+    for (i = 0; i < numMembers; i++) {
+        if (!isStopped && waitForeground(members[i]->pid, members[i]->timeout, procList)) {
+            isStopped = TRUE;
+        }
+
+        if (isStopped) {
+            returnProcess(procList, members[i]);
+            markStopped(procList, members[i]);
+        } else {
+            while (clearFinished(members[i]->pid, members[i]->isQuiet) == -1);
+            freeProcessNode(members[i]);
+        }
+    }
+    reclaimTerminal();
+    MEM_FREE(members);
+
+    if (toggleFgMode) {
+        applyFgOnlyToggle(isForeOnlyMode);
+    }
+
+    return lastExitStatus;
+}
+
+/************************************************************************************
+ * Function to implement the bg built in command, continuing a stopped job in the
+ * background
+ *
+ * @param cmd: the bg command
+ * @param procList: linked list of outstanding processes
+ * @return: 0 if the job was continued, or JOB_FAILED_STATUS if there is no such job
+ ***********************************************************************************/
+int bgCommand(struct command *cmd, struct processLinkedList *procList) {
+    struct processNode *job = findJob(cmd, procList), *cur;
+
+    if (job == NULL) {
+        return JOB_FAILED_STATUS;
+    }
+
+    if (!job->isStopped) {
+        queueFormat("bg: job %d is already in the background\n", job->pid);
+        return 0;
+    }
+
+    // reports of the job having stopped are collected so they are not seen again
+    for (cur = procList->head; cur != NULL; cur = cur->next) {
+        if (cur->pgid == job->pgid && cur->pidFd == -1) {
+            checkStopped(cur->pid);
+            cur->isStopped = FALSE;
+        }
+    }
+    signalJob(job->pgid, SIGCONT);
+
+    queueConstant("background pid is ");
+    queueInt(job->pid);
+    queueConstant("\n");
+    return 0;
+}
@@ -0,0 +1,51 @@
+/************************************************************************************
+ * This file defines functions related to job control. Every job (a command, or all
+ * the stages of a pipeline) runs in a process group of its own. When the shell is in
+ * the foreground of a terminal the foreground job is given the terminal, so ^C and ^Z
+ * reach exactly that group. Otherwise the shell passes SIGINT and SIGTSTP on to the
+ * foreground group itself with a single kill().
+ *
+ * usage: fg [pid]
+ *        bg [pid]
+ *
+ * A job stopped by ^Z is kept as a background job, which fg continues in the
+ * foreground and bg continues in the background. Without a pid they act on the most
+ * recent job.
+ ***********************************************************************************/
+#ifndef CS344_JOBCONTROL_H
+#define CS344_JOBCONTROL_H
+
+#include <signal.h>
+#include <termios.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+
+#include "CommandParser.h"
+#include "CommandDelegator.h"
+
+// kinds of job control the shell can do
+#define JOBS_NONE 0      // a copy of the shell running part of a job, or a server
+#define JOBS_FORWARD 1   // jobs have their own groups, the shell forwards ^C and ^Z
+#define JOBS_TERMINAL 2  // as well, the foreground job is given the terminal
+
+#define STOPPED_EXIT_STATUS (128 + SIGTSTP)  // exit status of a job stopped by ^Z
+#define JOB_FAILED_STATUS 1                  // exit status if fg or bg failed
+
+extern int jobControl;
+extern volatile sig_atomic_t foregroundPgid;
+
+void initJobControl();
+void joinJob(pid_t pid, pid_t pgid, int isForeground);
+void giveTerminal(pid_t pgid);
+void reclaimTerminal();
+void signalJob(pid_t pgid, int signal);
+void forwardInterrupt(int signum);
+int childSignalFd();
+int checkStopped(pid_t pid);
+struct processNode *stopJob(struct processLinkedList *procList, pid_t pid, pid_t pgid, struct command *cmd, int isQuiet);
+void announceStopped(pid_t pid);
+struct processNode *findJob(struct command *cmd, struct processLinkedList *procList);
+int fgCommand(struct command *cmd, struct processLinkedList *procList, int *isForeOnlyMode);
+int bgCommand(struct command *cmd, struct processLinkedList *procList);
+
+#endif //CS344_JOBCONTROL_H
@@ -0,0 +1,254 @@
+#include "JobState.h"
+
+// state file of this shell and the pid of the shell that owns it, so forked copies of
+// the shell do not write it
+static char *statePath = NULL;
+static pid_t ownerPid = 0;
+
+/************************************************************************************
+ * Function to make the shell the reaper of its orphaned descendants
+ *
+ * @return: FALSE if subreapers are not supported
+ ***********************************************************************************/
+int enableSubreaper() {
+    return prctl(PR_SET_CHILD_SUBREAPER, 1) == 0;
+}
+
+/************************************************************************************
+ * Function to read the start time of a process, which identifies it along with its
+ * pid as pids are reused
+ *
+ * @param pid: the process
+ * @return: start time in clock ticks since boot or -1 if the process does not exist
+ ***********************************************************************************/
+long long processStartTime(pid_t pid) {
+    char path[64], stat[1024], *field;
+    long long startTime = -1;
+    int i, len, fd;
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1) {
+        return -1;
+    }
+    len = read(fd, stat, sizeof(stat) - 1);
+    close(fd);
+    if (len <= 0) {
+        return -1;
+    }
+    stat[len] = '\0';
+
+    // the command name may contain spaces so fields are counted from its closing )
+    if ((field = strrchr(stat, ')')) == NULL) {
+        return -1;
+    }
+
+    // the start time is the 22nd field, the 20th after the command name
+    for (i = 0; i < 20 && field != NULL; i++) {
+        field = strchr(field + 1, ' ');
+    }
+    if (field != NULL) {
+        startTime = atoll(field + 1);
+    }
+
+    return startTime;
+}
+
+/************************************************************************************
+ * Function to find the state directory, creating it if necessary
+ *
+ * @param dir: loaded with the directory (PATH_MAX characters)
+ * @return: FALSE if there is no usable state directory
+ ***********************************************************************************/
+int getStateDir(char *dir) {
+    // create the parent directories of the default location
+    if (getenv(STATE_DIR)) {
+        snprintf(dir, PATH_MAX, "%s", getenv(STATE_DIR));
+    } else if (getenv("XDG_STATE_HOME")) {
+        snprintf(dir, PATH_MAX, "%s/smallsh", getenv("XDG_STATE_HOME"));
+    } else if (getenv("HOME")) {
+        snprintf(dir, PATH_MAX, "%s/.local", getenv("HOME"));
+        mkdir(dir, 0700);
+        snprintf(dir, PATH_MAX, "%s/.local/state", getenv("HOME"));
+        mkdir(dir, 0700);
+        snprintf(dir, PATH_MAX, "%s/.local/state/smallsh", getenv("HOME"));
+    } else {
+        return FALSE;
+    }
+
+    return mkdir(dir, 0700) == 0 || errno == EEXIST;
+}
+
+/************************************************************************************
+ * Function to start saving the shell's job table, adopting the jobs of any shell
+ * that exited without cleaning up its state file
+ *
+ * @param procList: linked list of outstanding processes
+ * @return: FALSE if there is no usable state directory
+ ***********************************************************************************/
+int openJobState(struct processLinkedList *procList) {
+    char dir[PATH_MAX];
+
+    if (!getStateDir(dir)) {
+        return FALSE;
+    }
+
+    // a state directory too long to hold the file name is not usable
+    ownerPid = getpid();
+    statePath = MEM_CALLOC(MEM_JOBS, PATH_MAX, sizeof(char));
+    if (snprintf(statePath, PATH_MAX, "%s/%s%d", dir, STATE_PREFIX, ownerPid) >= PATH_MAX) {
+        MEM_FREE(statePath);
+        statePath = NULL;
+        return FALSE;
+    }
+
+    adoptJobs(dir, procList);
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to save the job table to the state file, replacing it atomically. The
+ * file is removed when there are no jobs to save.
+ *
+ * @param procList: linked list of outstanding processes
+ ***********************************************************************************/
+void saveJobState(struct processLinkedList *procList) {
+    char tempPath[PATH_MAX];
+    struct processNode *cur;
+    long long startTime;
+    int numJobs = 0;
+    FILE *file;
+
+    if (statePath == NULL || getpid() != ownerPid) {
+        return;
+    }
+
+    // process substitutions are not jobs
+    for (cur = procList->head; cur != NULL; cur = cur->next) {
+        numJobs += !cur->isQuiet;
+    }
+    if (numJobs == 0) {
+        unlink(statePath);
+        return;
+    }
+
+    if (snprintf(tempPath, PATH_MAX, "%s.tmp", statePath) >= PATH_MAX ||
+        (file = fopen(tempPath, "we")) == NULL) {
+        return;
+    }
+
+    fprintf(file, "shell %d %lld\n", ownerPid, processStartTime(ownerPid));
+    for (cur = procList->head; cur != NULL; cur = cur->next) {
+        if (!cur->isQuiet && (startTime = processStartTime(cur->pid)) != -1) {
+            fprintf(file, "%d %lld %s\n", cur->pid, startTime, cur->command);
+        }
+    }
+
+    if (fclose(file) == 0) {
+        rename(tempPath, statePath);
+    } else {
+        unlink(tempPath);
+    }
+}
+
+/************************************************************************************
+ * Function to adopt the surviving jobs from the state files of shells that are no
+ * longer running. A state file is claimed by renaming it so that shells starting at
+ * the same time do not both adopt its jobs.
+ *
+ * @param dir: the state directory
+ * @param procList: linked list of outstanding processes
+ ***********************************************************************************/
+void adoptJobs(char *dir, struct processLinkedList *procList) {
+    char path[PATH_MAX], claimPath[PATH_MAX], command[JOB_CMD_LEN];
+    long long shellStart, startTime;
+    int shellPid, pid, pidFd, numAdopted = 0;
+    struct dirent *entry;
+    DIR *stateDir;
+    FILE *file;
+
+    if ((stateDir = opendir(dir)) == NULL) {
+        return;
+    }
+
+    while ((entry = readdir(stateDir)) != NULL) {
+        // only the finished state files of other shells
+        if (strncmp(entry->d_name, STATE_PREFIX, strlen(STATE_PREFIX)) != 0 ||
+            strchr(entry->d_name + strlen(STATE_PREFIX), '.') != NULL) {
+            continue;
+        }
+        snprintf(path, PATH_MAX, "%s/%s", dir, entry->d_name);
+        if ((file = fopen(path, "re")) == NULL) {
+            continue;
+        }
+        if (fscanf(file, "shell %d %lld\n", &shellPid, &shellStart) != 2 || shellPid == ownerPid ||
+            (shellStart != -1 && processStartTime(shellPid) == shellStart)) {
+            fclose(file);
+            continue;
+        }
+
+        if (snprintf(claimPath, PATH_MAX, "%s.%d", path, ownerPid) >= PATH_MAX ||
+            rename(path, claimPath) == -1) {
+            fclose(file);
+            continue;
+        }
+
+        // watch each job that is still the process that was saved
+        while (fscanf(file, "%d %lld %63[^\n]\n", &pid, &startTime, command) == 3) {
+            if (processStartTime(pid) != startTime || (pidFd = moveHigh(pidfdOpen(pid))) == -1) {
+                continue;
+            }
+
+            addProcess(procList, pid);
+            procList->tail->pidFd = pidFd;
+            snprintf(procList->tail->command, JOB_CMD_LEN, "%s", command);
+            queueFormat("adopted background pid %d (%s) from shell %d\n", pid, command, shellPid);
+            numAdopted++;
+        }
+
+        fclose(file);
+        unlink(claimPath);
+    }
+    closedir(stateDir);
+
+    if (numAdopted > 0) {
+        saveJobState(procList);
+    }
+}
+
+/************************************************************************************
+ * Function to remove the adopted jobs that have finished, reporting each. Adopted
+ * jobs are not children of the shell so their exit status can not be collected.
+ *
+ * @param procList: linked list of outstanding processes
+ ***********************************************************************************/
+void reapAdopted(struct processLinkedList *procList) {
+    struct processNode *cur = procList->head, *next;
+    struct pollfd fd;
+
+    while (cur != NULL) {
+        // save the next node now since cur may be freed by removeProcess
+        next = cur->next;
+
+        if (cur->pidFd != -1) {
+            fd.fd = cur->pidFd;
+            fd.events = POLLIN;
+            if (poll(&fd, 1, 0) > 0) {
+                queueFormat("background pid %d is done: exit status unknown (adopted)\n", cur->pid);
+                removeProcess(procList, cur->pid);
+            }
+        }
+
+        cur = next;
+    }
+}
+
+/************************************************************************************
+ * Function to stop saving the job table, removing the state file
+ ***********************************************************************************/
+void closeJobState() {
+    if (statePath != NULL && getpid() == ownerPid) {
+        unlink(statePath);
+        MEM_FREE(statePath);
+        statePath = NULL;
+    }
+}
@@ -0,0 +1,42 @@
+/************************************************************************************
+ * This file defines functions related to keeping track of background jobs across
+ * shell restarts. The interactive shell saves its job table to a state file named
+ * after its pid whenever the table changes. A new shell adopts the surviving jobs of
+ * any shell whose state file was left behind (because it crashed or was killed),
+ * watching each through a pidfd and reporting when it finishes.
+ *
+ * The state directory is taken from SMALLSH_STATE_DIR, then XDG_STATE_HOME/smallsh,
+ * then HOME/.local/state/smallsh. Each file starts with "shell <pid> <start time>"
+ * followed by a "<pid> <start time> <command>" line for each job, where the start
+ * times (from /proc) guard against reused pids.
+ *
+ * Subreaper mode makes the shell the reaper of orphaned descendants of its jobs, so
+ * they are collected by the shell instead of being left as zombies under init.
+ ***********************************************************************************/
+#ifndef CS344_JOBSTATE_H
+#define CS344_JOBSTATE_H
+
+#include <stdio.h>
+#include <dirent.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+
+#include "CommandParser.h"
+#include "CommandDelegator.h"
+
+#define STATE_DIR "SMALLSH_STATE_DIR"  // env var to override the state directory
+#define STATE_PREFIX "jobs."
+
+int enableSubreaper();
+long long processStartTime(pid_t pid);
+int getStateDir(char *dir);
+int openJobState(struct processLinkedList *procList);
+void saveJobState(struct processLinkedList *procList);
+void adoptJobs(char *dir, struct processLinkedList *procList);
+void reapAdopted(struct processLinkedList *procList);
+void closeJobState();
+
+#endif //CS344_JOBSTATE_H
@@ -0,0 +1,157 @@
+#include "Memory.h"
+#include "Output.h"
+
+#ifdef MEM_ACCOUNTING
+
+// names of the subsystems in the order of their MEM_ values
+static char *subsystemNames[MEM_SUBSYSTEMS] = {"input", "parser", "echo", "redirect", "status", "jobs",
+                                               "script", "path", "table", "server", "bench", "replay",
+                                               "metrics", "events", "functions", "filters", "variables", "watch"};
+
+// counters for each subsystem and for the shell as a whole
+static struct memStats stats[MEM_SUBSYSTEMS];
+static struct memStats totals;
+
+/************************************************************************************
+ * Function to count a block that has been allocated
+ *
+ * @param subsystem: MEM_ value the block belongs to
+ * @param size: size of the block
+ ***********************************************************************************/
+static void countAlloc(int subsystem, size_t size) {
+    struct memStats *counters[2] = {&stats[subsystem], &totals};
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        counters[i]->liveBytes += size;
+        counters[i]->liveObjects++;
+        counters[i]->totalAllocs++;
+        if (counters[i]->liveBytes > counters[i]->peakBytes) {
+            counters[i]->peakBytes = counters[i]->liveBytes;
+        }
+    }
+}
+
+/************************************************************************************
+ * Function to count a block that has been released
+ *
+ * @param subsystem: MEM_ value the block belongs to
+ * @param size: size of the block
+ ***********************************************************************************/
+static void countFree(int subsystem, size_t size) {
+    stats[subsystem].liveBytes -= size;
+    stats[subsystem].liveObjects--;
+    totals.liveBytes -= size;
+    totals.liveObjects--;
+}
+
+/************************************************************************************
+ * Function to allocate zeroed memory accounted to a subsystem
+ *
+ * @param subsystem: MEM_ value to account the memory to
+ * @param count: number of elements
+ * @param size: size of each element
+ * @return: the memory or NULL if it could not be allocated
+ ***********************************************************************************/
+void *memCalloc(int subsystem, size_t count, size_t size) {
+    struct memHeader *header;
+
+    if (size != 0 && count > (((size_t) -1) - sizeof(struct memHeader)) / size) {
+        return NULL;
+    }
+
+    header = calloc(1, sizeof(struct memHeader) + count * size);
+    if (header == NULL) {
+        return NULL;
+    }
+
+    header->size = count * size;
+    header->subsystem = subsystem;
+    countAlloc(subsystem, header->size);
+    return header + 1;
+}
+
+/************************************************************************************
+ * Function to resize accounted memory. The memory stays accounted to the subsystem
+ * it was first allocated for.
+ *
+ * @param subsystem: MEM_ value to account the memory to if ptr is NULL
+ * @param ptr: memory from memCalloc or memRealloc (or NULL)
+ * @param size: new size
+ * @return: the resized memory or NULL if it could not be resized
+ ***********************************************************************************/
+void *memRealloc(int subsystem, void *ptr, size_t size) {
+    struct memHeader *header = NULL, *resized;
+    size_t oldSize = 0;
+
+    if (ptr != NULL) {
+        header = (struct memHeader *) ptr - 1;
+        oldSize = header->size;
+        subsystem = header->subsystem;
+    }
+
+    resized = realloc(header, sizeof(struct memHeader) + size);
+    if (resized == NULL) {
+        return NULL;
+    }
+
+    // a resize counts as releasing the old block and allocating the new one
+    if (ptr != NULL) {
+        countFree(subsystem, oldSize);
+    }
+    resized->size = size;
+    resized->subsystem = subsystem;
+    countAlloc(subsystem, size);
+    return resized + 1;
+}
+
+/************************************************************************************
+ * Function to release accounted memory
+ *
+ * @param ptr: memory from memCalloc or memRealloc (or NULL)
+ ***********************************************************************************/
+void memFree(void *ptr) {
+    struct memHeader *header;
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    header = (struct memHeader *) ptr - 1;
+    countFree(header->subsystem, header->size);
+    free(header);
+}
+
+/************************************************************************************
+ * Function to implement the mem built in command, reporting the allocation counters
+ * of each subsystem
+ *
+ * @return: exit status of the built in
+ ***********************************************************************************/
+int showMemStats() {
+    int i;
+
+    queueFormat("%-10s %12s %10s %12s %12s\n", "subsystem", "live_bytes", "live_objs", "total_allocs", "peak_bytes");
+    for (i = 0; i < MEM_SUBSYSTEMS; i++) {
+        queueFormat("%-10s %12zu %10zu %12zu %12zu\n", subsystemNames[i], stats[i].liveBytes,
+                    stats[i].liveObjects, stats[i].totalAllocs, stats[i].peakBytes);
+    }
+    queueFormat("%-10s %12zu %10zu %12zu %12zu\n", "total", totals.liveBytes, totals.liveObjects,
+                totals.totalAllocs, totals.peakBytes);
+
+    return 0;
+}
+
+#else
+
+/************************************************************************************
+ * Function to implement the mem built in command when accounting is compiled out
+ *
+ * @return: exit status of the built in
+ ***********************************************************************************/
+int showMemStats() {
+    queueConstant("mem: allocation accounting is not compiled in (build with MEM_ACCOUNTING=1)\n");
+    return 1;
+}
+
+#endif
@@ -0,0 +1,66 @@
+/************************************************************************************
+ * This file defines functions related to accounting for the shell's dynamic memory by
+ * subsystem, reported by the mem built in command. Allocations made through the
+ * MEM_ macros record their size and subsystem in a header before the block.
+ *
+ * Accounting is enabled by compiling with MEM_ACCOUNTING defined (see the makefile).
+ * Without it the macros are the plain allocator and nothing is counted.
+ ***********************************************************************************/
+#ifndef CS344_MEMORY_H
+#define CS344_MEMORY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// subsystems memory is accounted to
+#define MEM_INPUT 0     // command line input
+#define MEM_PARSER 1    // commands, args and process substitutions
+#define MEM_ECHO 2      // echoModifier
+#define MEM_REDIRECT 3  // redirections, including setNullRedirects
+#define MEM_STATUS 4    // status text in clearFinished
+#define MEM_JOBS 5      // outstanding process list and fork results
+#define MEM_SCRIPT 6    // script contents, compiled code and loaded commands
+#define MEM_PATH 7      // PATH lookups and the cached PATH
+#define MEM_TABLE 8     // hash tables
+#define MEM_SERVER 9    // command server sessions
+#define MEM_BENCH 10    // bench measurements
+#define MEM_REPLAY 11   // recorded sessions and replay samples
+#define MEM_METRICS 12  // metrics page path
+#define MEM_EVENTS 13   // event stream buffer and announced jobs
+#define MEM_FUNCTIONS 14  // aliases and function definitions
+#define MEM_FILTERS 15    // buffers of the filter built ins
+#define MEM_VARIABLES 16  // shell variables and the cached exec environment
+#define MEM_WATCH 17      // paths watched by the watch built in
+#define MEM_SUBSYSTEMS 18
+
+#ifdef MEM_ACCOUNTING
+#define MEM_CALLOC(subsystem, count, size) memCalloc(subsystem, count, size)
+#define MEM_REALLOC(subsystem, ptr, size) memRealloc(subsystem, ptr, size)
+#define MEM_FREE memFree
+#else
+#define MEM_CALLOC(subsystem, count, size) calloc(count, size)
+#define MEM_REALLOC(subsystem, ptr, size) realloc(ptr, size)
+#define MEM_FREE free
+#endif
+
+// header placed before each accounted block (16 bytes to keep the block aligned)
+struct memHeader {
+    size_t size;
+    size_t subsystem;
+};
+
+// structure holding the counters of a subsystem
+struct memStats {
+    size_t liveBytes;
+    size_t liveObjects;
+    size_t totalAllocs;
+    size_t peakBytes;
+};
+
+void *memCalloc(int subsystem, size_t count, size_t size);
+void *memRealloc(int subsystem, void *ptr, size_t size);
+void memFree(void *ptr);
+int showMemStats();
+
+#endif //CS344_MEMORY_H
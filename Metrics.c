@@ -0,0 +1,188 @@
+#include "Metrics.h"
+
+// the mapped page, NULL if metrics are not being published
+static struct metricsPage *page = NULL;
+static char *pagePath = NULL;
+
+/************************************************************************************
+ * Function to start a write to the page, making the sequence number odd so readers
+ * know to retry
+ ***********************************************************************************/
+static void beginWrite() {
+    __atomic_store_n(&page->seq, page->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/************************************************************************************
+ * Function to finish a write to the page, making the sequence number even again
+ ***********************************************************************************/
+static void endWrite() {
+    __atomic_store_n(&page->seq, page->seq + 1, __ATOMIC_RELEASE);
+}
+
+/************************************************************************************
+ * Function to create the metrics page at a path and map it into the shell
+ *
+ * @param path: path of the file to publish the page in (e.g. under /dev/shm)
+ * @return: flag indicating whether the page was created
+ ***********************************************************************************/
+int openMetrics(char *path) {
+    size_t size = (sizeof(struct metricsPage) + 4095) & ~((size_t) 4095);
+    void *map;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return FALSE;
+    }
+
+    if (ftruncate(fd, size) == -1) {
+        close(fd);
+        return FALSE;
+    }
+
+    // the mapping stays valid after the file is closed
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return FALSE;
+    }
+
+    page = map;
+    page->version = METRICS_VERSION;
+    page->shellPid = getpid();
+    strcpy(page->lastStatusText, "exit value 0");
+    __atomic_store_n(&page->magic, METRICS_MAGIC, __ATOMIC_RELEASE);
+
+    pagePath = MEM_CALLOC(MEM_METRICS, strlen(path) + 1, sizeof(char));
+    strcpy(pagePath, path);
+
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to stop publishing metrics and remove the page
+ ***********************************************************************************/
+void closeMetrics() {
+    if (page != NULL) {
+        munmap(page, (sizeof(struct metricsPage) + 4095) & ~((size_t) 4095));
+        unlink(pagePath);
+        MEM_FREE(pagePath);
+        page = NULL;
+        pagePath = NULL;
+    }
+}
+
+/************************************************************************************
+ * Function to stop a forked copy of the shell from publishing metrics, leaving the
+ * page in place for the shell itself
+ ***********************************************************************************/
+void detachMetrics() {
+    if (page != NULL) {
+        munmap(page, (sizeof(struct metricsPage) + 4095) & ~((size_t) 4095));
+        MEM_FREE(pagePath);
+        page = NULL;
+        pagePath = NULL;
+    }
+}
+
+/************************************************************************************
+ * Function to add a job that has just been started to the job table
+ *
+ * @param pid: process id of the job
+ * @param cmd: command the job is running
+ * @param state: JOB_FOREGROUND or JOB_BACKGROUND
+ ***********************************************************************************/
+void metricsJobStarted(pid_t pid, struct command *cmd, int state) {
+    struct timespec now;
+    struct metricsJob *job = NULL;
+    int i, len = 0;
+
+    if (page == NULL) {
+        return;
+    }
+
+    // find a free slot for the job (only the spawn count is updated if the table is full)
+    for (i = 0; i < METRICS_MAX_JOBS && job == NULL; i++) {
+        if (page->jobs[i].state == JOB_EMPTY) {
+            job = &page->jobs[i];
+        }
+    }
+
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    beginWrite();
+    page->commandsSpawned++;
+    if (job != NULL) {
+        page->numJobs++;
+        job->pid = pid;
+        job->state = state;
+        job->startTime = (int64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+
+        // store as much of the command line as fits
+        memset(job->command, 0, METRICS_CMD_LEN);
+        for (i = 0; i < cmd->numArgs && len < METRICS_CMD_LEN - 1; i++) {
+            len += snprintf(job->command + len, METRICS_CMD_LEN - len, i ? " %s" : "%s", cmd->args[i]);
+        }
+    }
+    endWrite();
+}
+
+/************************************************************************************
+ * Function to remove a finished job from the job table and count how it finished
+ *
+ * @param pid: process id of the job
+ * @param statusCode: status of the job as returned by waitpid
+ ***********************************************************************************/
+void metricsJobFinished(pid_t pid, int statusCode) {
+    int i;
+
+    if (page == NULL) {
+        return;
+    }
+
+    beginWrite();
+    for (i = 0; i < METRICS_MAX_JOBS; i++) {
+        if (page->jobs[i].state != JOB_EMPTY && page->jobs[i].pid == pid) {
+            page->jobs[i].state = JOB_EMPTY;
+            page->numJobs--;
+            break;
+        }
+    }
+
+    if (WIFSIGNALED(statusCode)) {
+        page->signals++;
+    } else if (WIFEXITED(statusCode) && WEXITSTATUS(statusCode) != 0) {
+        page->failures++;
+    }
+    endWrite();
+}
+
+/************************************************************************************
+ * Function to count a command that could not be started
+ ***********************************************************************************/
+void metricsSpawnFailed() {
+    if (page == NULL) {
+        return;
+    }
+
+    beginWrite();
+    page->failures++;
+    endWrite();
+}
+
+/************************************************************************************
+ * Function to publish the status most recently collected for the status command
+ *
+ * @param exitStatus: numeric exit status
+ * @param statusText: status as shown by the status command
+ ***********************************************************************************/
+void metricsSetStatus(int exitStatus, char *statusText) {
+    if (page == NULL) {
+        return;
+    }
+
+    beginWrite();
+    page->lastStatus = exitStatus;
+    snprintf(page->lastStatusText, METRICS_STATUS_LEN, "%.*s", (int) strcspn(statusText, "\n"), statusText);
+    endWrite();
+}
@@ -0,0 +1,65 @@
+/************************************************************************************
+ * This file defines functions related to publishing live metrics about the shell in
+ * a shared memory page that external monitors can map and read without locking.
+ *
+ * The page is protected by a sequence lock. A reader loads seq (acquire), retries if
+ * it is odd, copies the fields it wants, issues an acquire fence, and accepts the copy
+ * only if seq is unchanged.
+ ***********************************************************************************/
+#ifndef CS344_METRICS_H
+#define CS344_METRICS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "CommandParser.h"
+
+#define METRICS_MAGIC 0x54454d53  // "SMET"
+#define METRICS_VERSION 1
+#define METRICS_MAX_JOBS 64
+#define METRICS_CMD_LEN 64
+#define METRICS_STATUS_LEN 64
+
+// states of a slot in the job table
+#define JOB_EMPTY 0
+#define JOB_FOREGROUND 1
+#define JOB_BACKGROUND 2
+
+// structure for one entry of the job table
+struct metricsJob {
+    int32_t pid;
+    int32_t state;
+    int64_t startTime;  // wall clock time in nanoseconds since the epoch
+    char command[METRICS_CMD_LEN];
+};
+
+// structure laid out in the shared page (fixed layout, only appended to by new versions)
+struct metricsPage {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seq;
+    int32_t shellPid;
+    uint64_t commandsSpawned;
+    uint64_t failures;
+    uint64_t signals;
+    int32_t lastStatus;
+    uint32_t numJobs;
+    char lastStatusText[METRICS_STATUS_LEN];
+    struct metricsJob jobs[METRICS_MAX_JOBS];
+};
+
+int openMetrics(char *path);
+void closeMetrics();
+void detachMetrics();
+void metricsJobStarted(pid_t pid, struct command *cmd, int state);
+void metricsJobFinished(pid_t pid, int statusCode);
+void metricsSpawnFailed();
+void metricsSetStatus(int exitStatus, char *statusText);
+
+#endif //CS344_METRICS_H
@@ -0,0 +1,181 @@
+#include "Output.h"
+
+// copied text waiting to be written
+static char buffer[OUTPUT_BUF_SIZE];
+static size_t bufferUsed = 0;
+
+// segments waiting to be written, pointing into buffer or at constant strings
+static struct iovec segments[OUTPUT_MAX_SEGS];
+static int numSegments = 0;
+
+/************************************************************************************
+ * Function to block all signals while the queue is changed so a handler can never
+ * see it half updated
+ *
+ * @param oldMask: set to the signal mask to restore afterwards
+ ***********************************************************************************/
+static void blockSignals(sigset_t *oldMask) {
+    sigset_t all;
+    sigfillset(&all);
+    sigprocmask(SIG_BLOCK, &all, oldMask);
+}
+
+/************************************************************************************
+ * Function to write every queued segment with one writev (signals must be blocked)
+ ***********************************************************************************/
+static void writeQueued() {
+    struct iovec *seg = segments;
+    int count = numSegments;
+    ssize_t written;
+
+    while (count > 0) {
+        written = writev(STDOUT_FILENO, seg, count);
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        // skip past whatever was written in case the write was partial
+        while (count > 0 && (size_t) written >= seg->iov_len) {
+            written -= seg->iov_len;
+            seg++;
+            count--;
+        }
+        if (count > 0) {
+            seg->iov_base = (char *) seg->iov_base + written;
+            seg->iov_len -= written;
+        }
+    }
+
+    numSegments = 0;
+    bufferUsed = 0;
+}
+
+/************************************************************************************
+ * Function to add a segment to the queue, merging it with the previous segment when
+ * they are adjacent in the buffer (signals must be blocked)
+ *
+ * @param base: start of the segment
+ * @param len: length of the segment
+ ***********************************************************************************/
+static void addSegment(const char *base, size_t len) {
+    struct iovec *last = numSegments > 0 ? &segments[numSegments - 1] : NULL;
+
+    if (last != NULL && (char *) last->iov_base + last->iov_len == base) {
+        last->iov_len += len;
+    } else {
+        if (numSegments == OUTPUT_MAX_SEGS) {
+            writeQueued();
+        }
+        segments[numSegments].iov_base = (void *) base;
+        segments[numSegments].iov_len = len;
+        numSegments++;
+    }
+}
+
+/************************************************************************************
+ * Function to queue a string that will not change (such as a literal or a colour
+ * code) without copying it
+ *
+ * @param text: the constant string
+ ***********************************************************************************/
+void queueConstant(const char *text) {
+    sigset_t oldMask;
+    blockSignals(&oldMask);
+    addSegment(text, strlen(text));
+    sigprocmask(SIG_SETMASK, &oldMask, NULL);
+}
+
+/************************************************************************************
+ * Function to queue a copy of some text
+ *
+ * @param text: text to copy
+ * @param len: number of characters to copy
+ ***********************************************************************************/
+void queueText(const char *text, size_t len) {
+    sigset_t oldMask;
+    size_t chunk;
+
+    blockSignals(&oldMask);
+    while (len > 0) {
+        // make room by writing out the queue if the buffer or segment list is full
+        if (bufferUsed == OUTPUT_BUF_SIZE || numSegments == OUTPUT_MAX_SEGS) {
+            writeQueued();
+        }
+
+        chunk = OUTPUT_BUF_SIZE - bufferUsed < len ? OUTPUT_BUF_SIZE - bufferUsed : len;
+        memcpy(buffer + bufferUsed, text, chunk);
+        addSegment(buffer + bufferUsed, chunk);
+        bufferUsed += chunk;
+        text += chunk;
+        len -= chunk;
+    }
+    sigprocmask(SIG_SETMASK, &oldMask, NULL);
+}
+
+/************************************************************************************
+ * Function to queue a copy of a null terminated string
+ *
+ * @param text: string to copy
+ ***********************************************************************************/
+void queueString(const char *text) {
+    queueText(text, strlen(text));
+}
+
+/************************************************************************************
+ * Function to queue an integer in decimal
+ *
+ * @param value: integer to queue
+ ***********************************************************************************/
+void queueInt(long long value) {
+    char digits[24];
+    int pos = sizeof(digits);
+    unsigned long long magnitude = value < 0 ? -(unsigned long long) value : (unsigned long long) value;
+
+    // build the digits from the end of the array
+    do {
+        digits[--pos] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude > 0);
+
+    if (value < 0) {
+        digits[--pos] = '-';
+    }
+
+    queueText(digits + pos, sizeof(digits) - pos);
+}
+
+/************************************************************************************
+ * Function to queue formatted text. This uses vsnprintf so it must not be called from
+ * a signal handler.
+ *
+ * @param format: printf style format string
+ ***********************************************************************************/
+void queueFormat(const char *format, ...) {
+    char text[OUTPUT_BUF_SIZE];
+    va_list args;
+    int len;
+
+    va_start(args, format);
+    len = vsnprintf(text, OUTPUT_BUF_SIZE, format, args);
+    va_end(args);
+
+    if (len > 0) {
+        queueText(text, len < OUTPUT_BUF_SIZE ? len : OUTPUT_BUF_SIZE - 1);
+    }
+}
+
+/************************************************************************************
+ * Function to write everything queued with a single writev
+ ***********************************************************************************/
+void flushOutput() {
+    sigset_t oldMask;
+
+    blockSignals(&oldMask);
+    if (numSegments > 0) {
+        writeQueued();
+    }
+    sigprocmask(SIG_SETMASK, &oldMask, NULL);
+}
@@ -0,0 +1,28 @@
+/************************************************************************************
+ * This file defines functions related to the shell's own output (prompts, notices,
+ * and status messages). Output is queued and written with a single writev when it is
+ * flushed. Queueing blocks signals while the queue is changed, so the queue functions
+ * other than queueFormat are safe to call from signal handlers.
+ ***********************************************************************************/
+#ifndef CS344_OUTPUT_H
+#define CS344_OUTPUT_H
+
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+#define OUTPUT_BUF_SIZE 8192
+#define OUTPUT_MAX_SEGS 128
+
+void queueConstant(const char *text);
+void queueText(const char *text, size_t len);
+void queueString(const char *text);
+void queueInt(long long value);
+void queueFormat(const char *format, ...);
+void flushOutput();
+
+#endif //CS344_OUTPUT_H
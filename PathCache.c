@@ -0,0 +1,72 @@
+#include "PathCache.h"
+
+// table of command names to the full path they were found at
+static struct hashTable *pathCache = NULL;
+
+// value of PATH that the cached entries were found with
+static char *cachedPath = NULL;
+
+/************************************************************************************
+ * Function to find the full path of a command by searching the PATH. Results are
+ * cached until the PATH changes. Names containing a slash are not searched for.
+ *
+ * @param name: name of the command
+ * @return: full path of the command (owned by the cache) or NULL if it was not found
+ ***********************************************************************************/
+char *resolveCommand(const char *name) {
+    char *path = getenv("PATH"), *resolved, *dirs, *dir, *savePtr;
+    char candidate[PATH_MAX];
+    struct stat st;
+
+    if (path == NULL || strchr(name, '/') != NULL) {
+        return NULL;
+    }
+
+    // start with an empty cache if this is the first search or the PATH has changed
+    if (pathCache == NULL) {
+        pathCache = createTable(DEFAULT_BUCKETS);
+    }
+    if (cachedPath == NULL || strcmp(cachedPath, path) != 0) {
+        clearTable(pathCache, MEM_FREE);
+        MEM_FREE(cachedPath);
+        cachedPath = MEM_CALLOC(MEM_PATH, strlen(path) + 1, sizeof(char));
+        strcpy(cachedPath, path);
+    }
+
+    resolved = tableGet(pathCache, name);
+    if (resolved != NULL) {
+        return resolved;
+    }
+
+    // search each directory in the PATH for an executable file with the name
+    dirs = MEM_CALLOC(MEM_PATH, strlen(path) + 1, sizeof(char));
+    strcpy(dirs, path);
+    for (dir = strtok_r(dirs, ":", &savePtr); dir != NULL; dir = strtok_r(NULL, ":", &savePtr)) {
+        snprintf(candidate, PATH_MAX, "%s/%s", dir, name);
+        if (stat(candidate, &st) == 0 && S_ISREG(st.st_mode) && access(candidate, X_OK) == 0) {
+            resolved = MEM_CALLOC(MEM_PATH, strlen(candidate) + 1, sizeof(char));
+            strcpy(resolved, candidate);
+            tablePut(pathCache, name, resolved);
+            break;
+        }
+    }
+    MEM_FREE(dirs);
+
+    return resolved;
+}
+
+/************************************************************************************
+ * Function to execute a command using the path found by resolveCommand. If there is
+ * no resolved path, or it is stale, the PATH is searched by execvpe instead. Only
+ * returns if the command could not be executed.
+ *
+ * @param resolved: full path of the command or NULL
+ * @param args: null terminated argument list
+ * @param envp: null terminated environment for the command
+ ***********************************************************************************/
+void execResolved(char *resolved, char **args, char **envp) {
+    if (resolved != NULL) {
+        execve(resolved, args, envp);
+    }
+    execvpe(args[0], args, envp);
+}
@@ -0,0 +1,20 @@
+/************************************************************************************
+ * This file defines functions related to caching where commands were found on the
+ * PATH so the search does not have to be repeated for every command
+ ***********************************************************************************/
+#ifndef CS344_PATHCACHE_H
+#define CS344_PATHCACHE_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "HashTable.h"
+
+char *resolveCommand(const char *name);
+void execResolved(char *resolved, char **args, char **envp);
+
+#endif //CS344_PATHCACHE_H
@@ -0,0 +1,350 @@
+#include "Pipeline.h"
+#include "Timeout.h"
+#include "Events.h"
+#include "Functions.h"
+#include "JobState.h"
+#include "Variables.h"
+#include "JobControl.h"
+
+/************************************************************************************
+ * Function to check if a pipeline stage can be run as a filter built in. Only the
+ * input may be redirected from a file and the output to one.
+ *
+ * @param cmd: the stage
+ * @return: TRUE if the stage can be run as a filter
+ ***********************************************************************************/
+int isFilterStage(struct command *cmd) {
+    struct redirection *cur;
+    int numIn = 0, numOut = 0;
+
+    // functions and aliases take the name over from the built in
+    if (cmd->body != NULL || cmd->procSubs != NULL || isDefined(cmd->args[0]) || !isFilter(cmd)) {
+        return FALSE;
+    }
+
+    for (cur = cmd->redirs; cur != NULL; cur = cur->next) {
+        if (cur->fd == STDIN_FILENO && cur->type == REDIR_IN) {
+            numIn++;
+        } else if (cur->fd == STDOUT_FILENO && (cur->type == REDIR_OUT || cur->type == REDIR_APPEND)) {
+            numOut++;
+        } else {
+            return FALSE;
+        }
+    }
+
+    return numIn <= 1 && numOut <= 1;
+}
+
+/************************************************************************************
+ * Function to find the end of the group of stages run by one process. Consecutive
+ * filter stages are grouped unless output is redirected between them.
+ *
+ * @param stages: array of the pipeline's stages
+ * @param start: first stage of the group
+ * @param numStages: number of stages
+ * @return: index of the stage after the group
+ ***********************************************************************************/
+int filterGroupEnd(struct command **stages, int start, int numStages) {
+    int end = start + 1;
+
+    if (!isFilterStage(stages[start])) {
+        return end;
+    }
+
+    while (end < numStages && isFilterStage(stages[end]) &&
+           !hasRedirect(stages[end - 1], STDOUT_FILENO) && !hasRedirect(stages[end], STDIN_FILENO)) {
+        end++;
+    }
+
+    return end;
+}
+
+/************************************************************************************
+ * Function to run a group of filter stages as one chain of filters
+ *
+ * @param stages: the stages of the group
+ * @param numStages: number of stages
+ * @param inFd: file descriptor to read from
+ * @param outFd: file descriptor to write to
+ * @return: exit status of the last stage
+ ***********************************************************************************/
+int runFilterGroup(struct command **stages, int numStages, int inFd, int outFd) {
+    struct filter *filters = MEM_CALLOC(MEM_FILTERS, numStages, sizeof(struct filter));
+    int i, status;
+
+    for (i = 0; i < numStages; i++) {
+        parseFilter(stages[i], filters + i);
+    }
+    status = runFilters(filters, numStages, inFd, outFd);
+    MEM_FREE(filters);
+
+    return status;
+}
+
+/************************************************************************************
+ * Function run in the child of a group of stages to connect it to its pipes and run
+ * it. External commands are executed, filters are chained, and anything else is run
+ * by this copy of the shell. Never returns.
+ *
+ * @param stages: the stages of the group
+ * @param numStages: number of stages
+ * @param inFd: read end of the pipe from the stage before (-1 for the first)
+ * @param outPipe: pipe to the stage after ({-1, -1} for the last)
+ * @param resolved: full path of an external command from resolveCommand (or NULL)
+ * @param processMask: process state flags to load the child's handlers with
+ * @param pgid: process group of the pipeline (0 for the first group, which starts it)
+ ***********************************************************************************/
+void runStage(struct command **stages, int numStages, int inFd, int outPipe[2], char *resolved, int processMask,
+              pid_t pgid) {
+    struct processLinkedList stageProcs = {NULL, NULL};
+    struct processNode *node;
+    struct command *cmd = stages[0];
+    int isForeOnlyMode = TRUE;
+
+    joinJob(getpid(), pgid ? pgid : getpid(), processMask & FOREGROUND);
+    loadHandlers(processMask);
+
+    // the pipes become stdin and stdout, and no other end may be held open
+    if (inFd != -1) {
+        dup2(inFd, STDIN_FILENO);
+        close(inFd);
+    }
+    if (outPipe[1] != -1) {
+        dup2(outPipe[1], STDOUT_FILENO);
+        close(outPipe[0]);
+        close(outPipe[1]);
+    }
+
+    if (isFilterStage(cmd)) {
+        if (!openRedirFiles(cmd) || (numStages > 1 && !openRedirFiles(stages[numStages - 1]))) {
+            _exit(1);
+        }
+        _exit(runFilterGroup(stages, numStages, STDIN_FILENO, STDOUT_FILENO));
+    }
+
+    if (!isBuiltIn(cmd->args[0]) && !isDefined(cmd->args[0]) && cmd->body == NULL) {
+        if (openRedirFiles(cmd)) {
+            execCommand(cmd, resolved);
+            printf("%s: no such file or directory\n", cmd->args[0]);
+            fflush(stdout);
+        }
+        _exit(1);
+    }
+
+    // only the shell publishes metrics, events and prompts
+    detachMetrics();
+    detachEvents();
+    showPrompt = FALSE;
+    cmd->isBgProcess = FALSE;
+    executeCommand(cmd, &stageProcs, &isForeOnlyMode);
+    flushOutput();
+
+    // reap this copy's own substitutions as the shell will not see them
+    for (node = stageProcs.head; node != NULL; node = node->next) {
+        if (node->isQuiet) {
+            while (waitpid(node->pid, NULL, 0) == -1 && errno == EINTR);
+        }
+    }
+    _exit(lastExitStatus);
+}
+
+/************************************************************************************
+ * Function to run the last group of filter stages in the shell. SIGPIPE is ignored
+ * meanwhile so a closed output ends the filters rather than the shell.
+ *
+ * @param stages: the stages of the group
+ * @param numStages: number of stages
+ * @param inFd: read end of the pipe from the stage before (-1 for none), closed
+ * @return: exit status of the last stage
+ ***********************************************************************************/
+int runShellFilters(struct command **stages, int numStages, int inFd) {
+    struct sigaction ignore = {0}, saved;
+    struct redirection *redir;
+    int outFd = STDOUT_FILENO, status = 1;
+
+    // a file given with < is read instead of the pipe
+    for (redir = stages[0]->redirs; redir != NULL; redir = redir->next) {
+        if (redir->fd == STDIN_FILENO) {
+            if (inFd != -1) {
+                close(inFd);
+            }
+            inFd = openRedirFile(redir);
+        }
+    }
+    for (redir = stages[numStages - 1]->redirs; redir != NULL; redir = redir->next) {
+        if (redir->fd == STDOUT_FILENO) {
+            outFd = openRedirFile(redir);
+        }
+    }
+
+    if (inFd != -1 && outFd != -1) {
+        ignore.sa_handler = SIG_IGN;
+        sigaction(SIGPIPE, &ignore, &saved);
+        status = runFilterGroup(stages, numStages, inFd, outFd);
+        sigaction(SIGPIPE, &saved, NULL);
+    }
+
+    if (inFd != -1) {
+        close(inFd);
+    }
+    if (outFd != -1 && outFd != STDOUT_FILENO) {
+        close(outFd);
+    }
+
+    return status;
+}
+
+/************************************************************************************
+ * Function to run a pipeline, starting every group of stages before waiting for any
+ * of them. The stages are all one job, in the process group of the first. A
+ * foreground pipeline's exit status is that of its last stage. The stages of a
+ * background (or stopped) pipeline are all in the process list, though only the last
+ * one is announced.
+ *
+ * @param first: first stage of the pipeline
+ * @param numStages: number of stages
+ * @param procList: linked list of outstanding processes
+ * @param isForeOnlyMode: pointer to the foreground only flag, updated if the mode is
+ *                        toggled while the pipeline runs
+ ***********************************************************************************/
+void runPipeline(struct command *first, int numStages, struct processLinkedList *procList, int *isForeOnlyMode) {
+    struct command **stages = MEM_CALLOC(MEM_JOBS, numStages, sizeof(struct command *));
+    struct command **ends = MEM_CALLOC(MEM_JOBS, numStages, sizeof(struct command *));
+    pid_t *pids = MEM_CALLOC(MEM_JOBS, numStages, sizeof(pid_t));
+    struct command *cmd = first, *last;
+    int i, start, end, numPids = 0, inFd = -1, outPipe[2], status = -1;
+    int isBackground, processMask, isStopped = FALSE;
+    char *resolved, stat[100];
+    pid_t pid, pgid = 0;
+
+    for (i = 0; i < numStages; i++, cmd = cmd->next) {
+        stages[i] = cmd;
+    }
+    last = stages[numStages - 1];
+    isBackground = last->isBgProcess;
+    processMask = (isBackground ? BACKGROUND : FOREGROUND) | CHILD;
+
+    for (start = 0; start < numStages; start = end) {
+        end = filterGroupEnd(stages, start, numStages);
+        cmd = stages[start];
+
+        // the last filters run in the shell if there is something for them to read. With
+        // job control only a file is, as the shell could not read on from a stopped job.
+        if (end == numStages && !isBackground && isFilterStage(cmd) &&
+            ((start > 0 && jobControl == JOBS_NONE) || (start == 0 && hasRedirect(cmd, STDIN_FILENO)))) {
+            flushOutput();
+            status = runShellFilters(stages + start, end - start, inFd);
+            inFd = -1;
+            break;
+        }
+
+        // look up an external command before forking so the result stays cached, and
+        // start its process substitutions so their pipes can be passed on
+        resolved = NULL;
+        if (!isFilterStage(cmd) && !isBuiltIn(cmd->args[0]) && !isDefined(cmd->args[0]) && cmd->body == NULL) {
+            resolved = resolveCommand(cmd->args[0]);
+            if (!startProcSubs(cmd, procList)) {
+                closeProcSubs(cmd);
+                status = 1;
+                break;
+            }
+        }
+
+        // connect the group to the next one
+        outPipe[0] = outPipe[1] = -1;
+        if (end < numStages) {
+            if (pipe2(outPipe, O_CLOEXEC) == -1) {
+                queueConstant("cannot create pipe\n");
+                closeProcSubs(cmd);
+                status = 1;
+                break;
+            }
+            outPipe[0] = moveHigh(outPipe[0]);
+            outPipe[1] = moveHigh(outPipe[1]);
+        }
+
+        // write queued output so it comes before anything the child prints
+        flushOutput();
+        pid = fork();
+        if (pid == 0) {
+            runStage(stages + start, end - start, inFd, outPipe, resolved, processMask, pgid);
+        }
+
+        closeProcSubs(cmd);
+        if (inFd != -1) {
+            close(inFd);
+        }
+        if (outPipe[1] != -1) {
+            close(outPipe[1]);
+        }
+        inFd = outPipe[0];
+
+        if (pid < 0) {
+            queueConstant("Error forking process\n");
+            metricsSpawnFailed();
+            status = 1;
+            break;
+        }
+
+        // the first group starts the job's process group. The job is reported by the
+        // group's last stage.
+        pgid = pgid ? pgid : pid;
+        joinJob(pid, pgid, !isBackground);
+        ends[numPids] = stages[end - 1];
+        pids[numPids++] = pid;
+        metricsJobStarted(pid, stages[end - 1], isBackground ? JOB_BACKGROUND : JOB_FOREGROUND);
+        eventJobStarted(pid, stages[end - 1], isBackground);
+        if (isBackground) {
+            addProcess(procList, pid);
+            procList->tail->isQuiet = end < numStages;
+            procList->tail->pgid = jobControl == JOBS_NONE ? 0 : pgid;
+            setProcessCommand(procList->tail, stages[end - 1]);
+        }
+    }
+
+    if (inFd != -1) {
+        close(inFd);
+    }
+
+    if (isBackground) {
+        saveJobState(procList);
+        if (numPids > 0 && status == -1) {
+            queueConstant("background pid is ");
+            queueInt(pids[numPids - 1]);
+            queueConstant("\n");
+        }
+        lastExitStatus = status == -1 ? 0 : status;
+    } else {
+        // wait for every child, only reporting how the last stage finished. Once one
+        // is stopped by ^Z the rest are kept with it as a background job.
+        for (i = 0; i < numPids; i++) {
+            if (!isStopped && waitForeground(pids[i], NULL, procList)) {
+                isStopped = TRUE;
+            }
+
+            if (isStopped) {
+                stopJob(procList, pids[i], pgid, ends[i], i < numPids - 1 || status != -1);
+            } else {
+                while (clearFinished(pids[i], i < numPids - 1 || status != -1) == -1);
+            }
+        }
+        reclaimTerminal();
+
+        // the status of filters run in the shell (or of a stage that failed to start)
+        if (status != -1) {
+            lastExitStatus = status;
+            formatStatus(W_EXITCODE(status, 0), stat);
+            setShellVar(STATUS, stat);
+            metricsSetStatus(lastExitStatus, stat);
+        }
+
+        // check for toggle flag and toggle mode if so
+        if (toggleFgMode) {
+            applyFgOnlyToggle(isForeOnlyMode);
+        }
+    }
+
+    MEM_FREE(stages);
+    MEM_FREE(ends);
+    MEM_FREE(pids);
+}
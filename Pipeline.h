@@ -0,0 +1,30 @@
+/************************************************************************************
+ * This file defines functions related to running pipelines (cmd | cmd | ...). Every
+ * stage runs at once in its own child, connected to the next by a pipe. Stages that
+ * are filter built ins (see Filters.h) are chained in one child when nothing is
+ * redirected between them, and the last of them runs in the shell itself when its
+ * input is a file. A copy of the shell doing no job control (a function run in the
+ * background, say) runs them itself after a pipe as well, so there
+ * `seq 100 | grep -F 7 | wc -l` forks only once.
+ ***********************************************************************************/
+#ifndef CS344_PIPELINE_H
+#define CS344_PIPELINE_H
+
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "CommandParser.h"
+#include "CommandDelegator.h"
+#include "Filters.h"
+
+int isFilterStage(struct command *cmd);
+int filterGroupEnd(struct command **stages, int start, int numStages);
+int runFilterGroup(struct command **stages, int numStages, int inFd, int outFd);
+void runStage(struct command **stages, int numStages, int inFd, int outPipe[2], char *resolved, int processMask,
+              pid_t pgid);
+int runShellFilters(struct command **stages, int numStages, int inFd);
+void runPipeline(struct command *first, int numStages, struct processLinkedList *procList, int *isForeOnlyMode);
+
+#endif //CS344_PIPELINE_H
@@ -0,0 +1,399 @@
+#include "Prompt.h"
+#include "Variables.h"
+
+// cached segments and whether something has changed them since they were found
+static char cwd[PATH_MAX];
+static int isCwdStale = TRUE;
+static struct processLinkedList *jobList = NULL;
+static int numJobs = 0;
+static int isJobsStale = TRUE;
+static char branch[BRANCH_LEN];
+static int isBranchStale = TRUE;
+
+// helper process finding the branch, and whether the branch changed while it ran
+static pid_t helperPid = -1;
+static int helperFd = -1;
+static char helperOutput[BRANCH_LEN + PATH_MAX + 2];
+static size_t helperLen = 0;
+static int isHelperStale = FALSE;
+
+// inotify watches on the directory the branch was found for and its git directory
+static int notifyFd = -1;
+static int dirWatch = -1;
+static int gitWatch = -1;
+static char watchedDir[PATH_MAX];
+static char gitDir[PATH_MAX];
+static char watchedGitDir[PATH_MAX];
+
+// the prompt last drawn, which can be redrawn until a line is read
+static char shown[PROMPT_LEN + 16];
+
+/************************************************************************************
+ * Function to find the git directory of the current directory or the closest of its
+ * parents that has one. A .git file (as in a worktree) names the directory.
+ *
+ * @param dest: loaded with the path of the git directory
+ * @return: FALSE if the directory is not in a repository
+ ***********************************************************************************/
+static int findGitDir(char *dest) {
+    char dir[PATH_MAX], candidate[PATH_MAX + 8], line[PATH_MAX];
+    char *slash;
+    struct stat st;
+    FILE *file;
+
+    if (getcwd(dir, PATH_MAX) == NULL) {
+        return FALSE;
+    }
+
+    while (1) {
+        snprintf(candidate, sizeof(candidate), "%s/.git", strcmp(dir, "/") == 0 ? "" : dir);
+        // a git directory whose path does not fit can not be watched
+        if (stat(candidate, &st) == 0 && S_ISDIR(st.st_mode)) {
+            return snprintf(dest, PATH_MAX, "%s", candidate) < PATH_MAX;
+        } else if (stat(candidate, &st) == 0 && (file = fopen(candidate, "r")) != NULL) {
+            // gitdir: path, relative to the directory holding the file
+            line[0] = '\0';
+            if (fgets(line, PATH_MAX, file) != NULL && strncmp(line, "gitdir: ", 8) == 0) {
+                line[strcspn(line, "\n")] = '\0';
+                fclose(file);
+                if (line[8] == '/') {
+                    return snprintf(dest, PATH_MAX, "%s", line + 8) < PATH_MAX;
+                }
+                return snprintf(dest, PATH_MAX, "%s/%s", dir, line + 8) < PATH_MAX;
+            }
+            fclose(file);
+        }
+
+        // move up to the parent until the root has been checked
+        if ((slash = strrchr(dir, '/')) == NULL || strcmp(dir, "/") == 0) {
+            return FALSE;
+        }
+        slash[slash == dir ? 1 : 0] = '\0';
+    }
+}
+
+/************************************************************************************
+ * Function run by the helper process to find the branch and write it, followed by
+ * the git directory it was read from, to the shell. Never returns.
+ *
+ * @param fd: write end of the pipe to the shell
+ ***********************************************************************************/
+static void runBranchHelper(int fd) {
+    char dir[PATH_MAX] = "", head[PATH_MAX + 8], line[BRANCH_LEN] = "";
+    FILE *file;
+
+    // HEAD names the branch (ref: refs/heads/name) or holds a detached commit
+    if (findGitDir(dir)) {
+        snprintf(head, sizeof(head), "%s/HEAD", dir);
+        if ((file = fopen(head, "r")) != NULL) {
+            if (fgets(line, BRANCH_LEN, file) == NULL) {
+                line[0] = '\0';
+            }
+            fclose(file);
+        }
+        line[strcspn(line, "\n")] = '\0';
+        if (strncmp(line, "ref: refs/heads/", 16) == 0) {
+            memmove(line, line + 16, strlen(line + 16) + 1);
+        } else if (strncmp(line, "ref: ", 5) == 0) {
+            memmove(line, line + 5, strlen(line + 5) + 1);
+        } else {
+            line[7] = '\0';
+        }
+    }
+
+    dprintf(fd, "%s\n%s\n", line, dir);
+    _exit(0);
+}
+
+/************************************************************************************
+ * Function to start the helper finding the branch, or to have it started again once
+ * it finishes if it is already running
+ ***********************************************************************************/
+static void requestBranch() {
+    int pipeFds[2];
+    pid_t pid;
+
+    if (helperPid != -1) {
+        isHelperStale = TRUE;
+        return;
+    }
+
+    if (pipe2(pipeFds, O_CLOEXEC | O_NONBLOCK) == -1) {
+        return;
+    }
+    if ((pid = fork()) == 0) {
+        close(pipeFds[0]);
+        runBranchHelper(pipeFds[1]);
+    }
+    close(pipeFds[1]);
+    if (pid < 0) {
+        close(pipeFds[0]);
+        return;
+    }
+
+    helperPid = pid;
+    helperFd = moveHigh(pipeFds[0]);
+    helperLen = 0;
+}
+
+/************************************************************************************
+ * Function to watch the current directory (for a .git being added or removed) and
+ * the git directory (for HEAD changing) so the branch is found again when they change
+ ***********************************************************************************/
+static void watchGitDir() {
+    uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM | IN_MODIFY | IN_DELETE_SELF;
+    char dir[PATH_MAX];
+
+    if (notifyFd == -1 && (notifyFd = moveHigh(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))) == -1) {
+        return;
+    }
+
+    // only directories that changed are watched again, as removing a watch is itself
+    // reported as an event
+    if (getcwd(dir, PATH_MAX) != NULL && (dirWatch == -1 || strcmp(dir, watchedDir) != 0)) {
+        if (dirWatch != -1) {
+            inotify_rm_watch(notifyFd, dirWatch);
+        }
+        dirWatch = inotify_add_watch(notifyFd, dir, mask);
+        snprintf(watchedDir, PATH_MAX, "%s", dir);
+    }
+    if (gitWatch == -1 || strcmp(gitDir, watchedGitDir) != 0) {
+        if (gitWatch != -1) {
+            inotify_rm_watch(notifyFd, gitWatch);
+        }
+        gitWatch = gitDir[0] != '\0' ? inotify_add_watch(notifyFd, gitDir, mask) : -1;
+        snprintf(watchedGitDir, PATH_MAX, "%s", gitDir);
+    }
+}
+
+/************************************************************************************
+ * Function to append text to a prompt being rendered
+ *
+ * @param dest: the prompt
+ * @param len: pointer to the length of the prompt, updated
+ * @param size: size of dest
+ * @param text: text to append
+ ***********************************************************************************/
+static void appendText(char *dest, size_t *len, size_t size, const char *text) {
+    size_t textLen = strlen(text);
+
+    if (*len + textLen >= size) {
+        textLen = size - *len - 1;
+    }
+    memcpy(dest + *len, text, textLen);
+    *len += textLen;
+    dest[*len] = '\0';
+}
+
+/************************************************************************************
+ * Function to render the prompt from the template, using the cached segments and
+ * finding any that are stale. The branch is never waited for.
+ *
+ * @param dest: loaded with the prompt
+ * @param size: size of dest
+ ***********************************************************************************/
+void renderPrompt(char *dest, size_t size) {
+    char *template = getShellVar(PROMPT_VAR), *home, number[24], *pos;
+    struct processNode *node;
+    size_t len = 0, homeLen;
+
+    dest[0] = '\0';
+    if (template == NULL) {
+        template = DEFAULT_PROMPT;
+    }
+
+    for (pos = template; *pos != '\0'; pos++) {
+        if (*pos != '%' || pos[1] == '\0') {
+            appendText(dest, &len, size, (char[]) {*pos, '\0'});
+            continue;
+        }
+
+        switch (*++pos) {
+            case 'd':
+                if (isCwdStale && getcwd(cwd, PATH_MAX) != NULL) {
+                    isCwdStale = FALSE;
+                }
+                home = getenv("HOME");
+                homeLen = home != NULL ? strlen(home) : 0;
+                if (homeLen > 1 && strncmp(cwd, home, homeLen) == 0 &&
+                    (cwd[homeLen] == '/' || cwd[homeLen] == '\0')) {
+                    appendText(dest, &len, size, "~");
+                    appendText(dest, &len, size, cwd + homeLen);
+                } else {
+                    appendText(dest, &len, size, cwd);
+                }
+                break;
+            case 's':
+                snprintf(number, sizeof(number), "%d", lastExitStatus);
+                appendText(dest, &len, size, number);
+                break;
+            case 'j':
+                if (isJobsStale) {
+                    numJobs = 0;
+                    for (node = jobList != NULL ? jobList->head : NULL; node != NULL; node = node->next) {
+                        numJobs += !node->isQuiet;
+                    }
+                    isJobsStale = FALSE;
+                }
+                snprintf(number, sizeof(number), "%d", numJobs);
+                appendText(dest, &len, size, number);
+                break;
+            case 'b':
+                if (isBranchStale) {
+                    isBranchStale = FALSE;
+                    requestBranch();
+                }
+                appendText(dest, &len, size, branch);
+                break;
+            case '_':
+                appendText(dest, &len, size, " ");
+                break;
+            case '%':
+                appendText(dest, &len, size, "%");
+                break;
+            default:
+                appendText(dest, &len, size, (char[]) {'%', *pos, '\0'});
+        }
+    }
+}
+
+/************************************************************************************
+ * Function to queue the prompt (written when the shell next waits for input)
+ ***********************************************************************************/
+void queuePrompt() {
+    char text[PROMPT_LEN];
+
+    renderPrompt(text, PROMPT_LEN);
+    snprintf(shown, sizeof(shown), "\033[92m%s\033[96m", text);
+    queueString(shown);
+}
+
+/************************************************************************************
+ * Function to mark the segments that depend on the current directory as stale
+ ***********************************************************************************/
+void promptChangedDir() {
+    isCwdStale = TRUE;
+    isBranchStale = TRUE;
+}
+
+/************************************************************************************
+ * Function to mark the job count as stale after a job starts or finishes
+ *
+ * @param procList: linked list of outstanding processes
+ ***********************************************************************************/
+void promptJobsChanged(struct processLinkedList *procList) {
+    jobList = procList;
+    isJobsStale = TRUE;
+}
+
+/************************************************************************************
+ * Function to add the helper's pipe and the inotify file descriptor to the file
+ * descriptors polled while the shell waits for input
+ *
+ * @param fds: array of poll entries
+ * @param start: index of the first entry to fill
+ * @return: number of entries added
+ ***********************************************************************************/
+int addPromptFds(struct pollfd *fds, int start) {
+    int num = 0;
+
+    if (helperFd != -1) {
+        fds[start + num].fd = helperFd;
+        fds[start + num].events = POLLIN;
+        fds[start + num++].revents = 0;
+    }
+    if (notifyFd != -1) {
+        fds[start + num].fd = notifyFd;
+        fds[start + num].events = POLLIN;
+        fds[start + num++].revents = 0;
+    }
+
+    return num;
+}
+
+/************************************************************************************
+ * Function to take the branch from the finished helper, redrawing the prompt in place
+ * if it changed
+ ***********************************************************************************/
+static void finishHelper() {
+    char *newline, text[PROMPT_LEN], redrawn[PROMPT_LEN + 16];
+
+    close(helperFd);
+    helperFd = -1;
+    while (waitpid(helperPid, NULL, 0) == -1 && errno == EINTR);
+    helperPid = -1;
+
+    helperOutput[helperLen] = '\0';
+    if ((newline = strchr(helperOutput, '\n')) != NULL) {
+        *newline = '\0';
+        snprintf(branch, BRANCH_LEN, "%.*s", BRANCH_LEN - 1, helperOutput);  // cut a longer name short
+        snprintf(gitDir, PATH_MAX, "%.*s", (int) strcspn(newline + 1, "\n"), newline + 1);
+        watchGitDir();
+    }
+
+    if (isHelperStale) {
+        isHelperStale = FALSE;
+        requestBranch();
+    }
+
+    // the prompt is still the last line on a terminal until a line is read
+    if (showPrompt && isatty(STDOUT_FILENO)) {
+        renderPrompt(text, PROMPT_LEN);
+        snprintf(redrawn, sizeof(redrawn), "\033[92m%s\033[96m", text);
+        if (strcmp(redrawn, shown) != 0) {
+            strcpy(shown, redrawn);
+            queueConstant("\r\033[K");
+            queueString(shown);
+            flushOutput();
+        }
+    }
+}
+
+/************************************************************************************
+ * Function to service the prompt's file descriptors after a poll: reading what the
+ * helper has written and checking whether inotify saw the branch change
+ *
+ * @param fds: array of poll entries
+ * @param start: index of the first of the prompt's entries
+ * @param numFds: number of the prompt's entries
+ ***********************************************************************************/
+void servicePromptFds(struct pollfd *fds, int start, int numFds) {
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct inotify_event *event;
+    ssize_t numRead, pos;
+    int i, isChanged = FALSE;
+
+    for (i = start; i < start + numFds; i++) {
+        if (!fds[i].revents) {
+            continue;
+        }
+
+        if (fds[i].fd == helperFd) {
+            numRead = read(helperFd, helperOutput + helperLen, sizeof(helperOutput) - helperLen - 1);
+            if (numRead > 0) {
+                helperLen += numRead;
+            } else if (numRead == 0 || errno != EAGAIN) {
+                finishHelper();
+            }
+        } else if (fds[i].fd == notifyFd) {
+            // HEAD changing in the git directory or .git appearing in the current one
+            while ((numRead = read(notifyFd, events, sizeof(events))) > 0) {
+                for (pos = 0; pos < numRead; pos += sizeof(struct inotify_event) + event->len) {
+                    event = (struct inotify_event *) (events + pos);
+                    if ((event->mask & IN_IGNORED) && (event->wd == dirWatch || event->wd == gitWatch)) {
+                        dirWatch = event->wd == dirWatch ? -1 : dirWatch;
+                        gitWatch = event->wd == gitWatch ? -1 : gitWatch;
+                        isChanged = TRUE;
+                    } else if ((event->wd == gitWatch && (event->len == 0 || strcmp(event->name, "HEAD") == 0)) ||
+                               (event->wd == dirWatch && event->len > 0 && strcmp(event->name, ".git") == 0)) {
+                        isChanged = TRUE;
+                    }
+                }
+            }
+        }
+    }
+
+    if (isChanged) {
+        requestBranch();
+    }
+}
@@ -0,0 +1,47 @@
+/************************************************************************************
+ * This file defines functions related to drawing the command line prompt from a
+ * template, set with the SMALLSH_PROMPT variable (": " by default):
+ *
+ *   %d  current directory, with the home directory shown as ~
+ *   %s  exit status of the last command
+ *   %j  number of background jobs
+ *   %b  git branch of the current directory (empty outside a repository)
+ *   %_  a space (as words can not contain one)
+ *   %%  a percent sign
+ *
+ * Each segment is cached until something changes it: the directory by cd, the job
+ * count by jobs starting or finishing. The branch is found by a helper process so
+ * the prompt never waits for it. The prompt is drawn at once with the last branch
+ * known and redrawn in place when the helper reports a different one. The helper is
+ * started again after a cd, or when inotify sees HEAD (or .git) change.
+ ***********************************************************************************/
+#ifndef CS344_PROMPT_H
+#define CS344_PROMPT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "CommandParser.h"
+#include "CommandDelegator.h"
+
+#define PROMPT_VAR "SMALLSH_PROMPT"
+#define DEFAULT_PROMPT ": "
+#define PROMPT_LEN 1024        // longest prompt drawn
+#define BRANCH_LEN 256         // longest branch name shown
+#define PROMPT_MAX_FDS 2       // helper pipe and inotify
+
+void renderPrompt(char *dest, size_t size);
+void queuePrompt();
+void promptChangedDir();
+void promptJobsChanged(struct processLinkedList *procList);
+int addPromptFds(struct pollfd *fds, int start);
+void servicePromptFds(struct pollfd *fds, int start, int numFds);
+
+#endif //CS344_PROMPT_H
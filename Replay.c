@@ -0,0 +1,275 @@
+#include "Replay.h"
+#include "Events.h"
+
+// the open recording (if any) and when it was started
+static FILE *recordFile = NULL;
+static long long recordStartNs = 0;
+
+/************************************************************************************
+ * Function to start recording the command lines run by the interactive shell
+ *
+ * @param path: file to record to (replaced if it exists)
+ * @return: FALSE if the file could not be opened
+ ***********************************************************************************/
+int openRecord(char *path) {
+    // the recording is closed on exec so children do not hold it open
+    int fd = moveHigh(open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+    if (fd == -1 || (recordFile = fdopen(fd, "w")) == NULL) {
+        if (fd != -1) {
+            close(fd);
+        }
+        return FALSE;
+    }
+
+    fprintf(recordFile, "%s\n", RECORD_HEADER);
+    fflush(recordFile);
+    recordStartNs = monotonicNs();
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to add a command line that has finished to the recording. Does nothing if
+ * the shell is not recording.
+ *
+ * @param line: the command line as it was entered
+ * @param startNs: monotonic time the command line started
+ * @param exitStatus: exit status of the command line
+ ***********************************************************************************/
+void recordCommand(char *line, long long startNs, int exitStatus) {
+    if (recordFile == NULL) {
+        return;
+    }
+
+    // written straight away so the recording survives the shell being killed
+    fprintf(recordFile, "%.3f\t%d\t%.3f\t%s\n", (startNs - recordStartNs) / 1e6, exitStatus,
+            (monotonicNs() - startNs) / 1e6, line);
+    fflush(recordFile);
+}
+
+/************************************************************************************
+ * Function to stop recording
+ ***********************************************************************************/
+void closeRecord() {
+    if (recordFile != NULL) {
+        fclose(recordFile);
+        recordFile = NULL;
+    }
+}
+
+/************************************************************************************
+ * Function to load the command lines of a recording
+ *
+ * @param path: the recording
+ * @param numEntries: loaded with the number of command lines
+ * @return: array of the command lines in order or NULL if the file could not be read
+ ***********************************************************************************/
+struct replayEntry *loadRecording(char *path, int *numEntries) {
+    struct replayEntry *entries = NULL, entry;
+    int cap = 0, lineStart;
+    char *line = NULL;
+    size_t lineCap = 0;
+    ssize_t len;
+    FILE *file = fopen(path, "r");
+
+    *numEntries = 0;
+    if (file == NULL) {
+        return NULL;
+    }
+
+    while ((len = getline(&line, &lineCap, file)) != -1) {
+        if (len > 0 && line[len - 1] == '\n') {
+            line[len - 1] = '\0';
+        }
+
+        // skip the header, comments and lines that are not records
+        lineStart = -1;
+        if (line[0] == '#' || sscanf(line, "%lf\t%d\t%lf\t%n", &entry.offsetMs, &entry.exitStatus,
+                                     &entry.durationMs, &lineStart) < 3 || lineStart == -1) {
+            continue;
+        }
+
+        // grow the array as needed
+        if (*numEntries == cap) {
+            cap = cap ? cap * 2 : 64;
+            entries = MEM_REALLOC(MEM_REPLAY, entries, cap * sizeof(struct replayEntry));
+        }
+        entry.line = MEM_CALLOC(MEM_REPLAY, strlen(line + lineStart) + 1, sizeof(char));
+        strcpy(entry.line, line + lineStart);
+        entries[(*numEntries)++] = entry;
+    }
+
+    free(line);  // allocated by getline
+    fclose(file);
+
+    // an empty recording is still valid
+    if (entries == NULL) {
+        entries = MEM_CALLOC(MEM_REPLAY, 1, sizeof(struct replayEntry));
+    }
+    return entries;
+}
+
+/************************************************************************************
+ * Function run in the child for a replay stream. Each command line is started at its
+ * scheduled time (or straight away if the stream is behind) and run through the
+ * normal parse and execute path, sending a sample to the shell for each. Never
+ * returns.
+ *
+ * @param entries: the recorded command lines
+ * @param numEntries: number of command lines
+ * @param speed: how many times faster than recorded to replay
+ * @param startNs: monotonic time the replay started
+ * @param reportFd: pipe to write the samples to
+ ***********************************************************************************/
+void runReplayStream(struct replayEntry *entries, int numEntries, double speed, long long startNs, int reportFd) {
+    struct processLinkedList procList = {NULL, NULL};
+    struct replaySample sample;
+    struct command *cmd;
+    char input[INPUT_LENGTH], *args[MAX_ARGS];
+    long long scheduledNs, lineStartNs;
+    int i, isForeOnlyMode = FALSE, devNull;
+
+    // the stream runs quietly as a copy of the shell that does not publish metrics
+    detachMetrics();
+    detachEvents();
+    closeRecord();
+    showPrompt = FALSE;
+    devNull = open("/dev/null", O_RDWR);
+    dup2(devNull, STDIN_FILENO);
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+
+    for (i = 0; i < numEntries; i++) {
+        // wait for the command line's place in the schedule
+        scheduledNs = startNs + (long long) (entries[i].offsetMs * 1e6 / speed);
+        while ((lineStartNs = monotonicNs()) < scheduledNs) {
+            sleepMs((scheduledNs - lineStartNs) / 1000000 + 1);
+        }
+
+        strncpy(input, entries[i].line, INPUT_LENGTH - 1);
+        input[INPUT_LENGTH - 1] = '\0';
+        memset(args, 0, MAX_ARGS * sizeof(char *));
+
+        cmd = parseInput(input, args, isForeOnlyMode);
+        if (cmd != NULL) {
+            executeList(cmd, &procList, &isForeOnlyMode);
+            freeCommand(cmd);
+        }
+        nonBlockClearFinished(&procList);
+        flushOutput();
+
+        // samples are smaller than PIPE_BUF so streams can share the pipe
+        sample.driftMs = (lineStartNs - scheduledNs) / 1e6;
+        sample.latencyMs = (monotonicNs() - lineStartNs) / 1e6;
+        sample.recordedMs = entries[i].durationMs;
+        sample.isMismatch = lastExitStatus != entries[i].exitStatus;
+        write(reportFd, &sample, sizeof(sample));
+    }
+
+    // wait for any background jobs the stream started
+    while (waitpid(-1, NULL, 0) != -1 || errno == EINTR);
+    _exit(0);
+}
+
+/************************************************************************************
+ * Function to replay a recording in several concurrent streams and report the
+ * throughput and the drift from the recorded schedule
+ *
+ * @param path: the recording
+ * @param speed: how many times faster than recorded to replay
+ * @param concurrency: number of streams
+ * @return: exit status for the shell (0 if every command line matched its status)
+ ***********************************************************************************/
+int replay(char *path, double speed, int concurrency) {
+    struct replayEntry *entries;
+    struct replaySample sample;
+    struct benchStats stats[3];
+    double *values[3];
+    int numEntries, numSamples = 0, cap = 0, mismatches = 0, i, j, reportPipe[2];
+    long long startNs, elapsedNs;
+    pid_t pid;
+
+    if (speed <= 0 || concurrency < 1) {
+        queueConstant("usage: --replay file [--speed Nx] [--concurrency K]\n");
+        return 1;
+    }
+    if ((entries = loadRecording(path, &numEntries)) == NULL) {
+        queueFormat("cannot open %s for input\n", path);
+        return 1;
+    }
+    if (pipe2(reportPipe, O_CLOEXEC) == -1) {
+        queueConstant("Error creating pipe\n");
+        return 1;
+    }
+
+    queueFormat("replay: %d stream(s) of %d command line(s) at %gx\n", concurrency, numEntries, speed);
+    flushOutput();
+
+    // start every stream against the same schedule
+    startNs = monotonicNs();
+    for (i = 0; i < concurrency; i++) {
+        pid = fork();
+        if (pid == 0) {
+            close(reportPipe[0]);
+            runReplayStream(entries, numEntries, speed, startNs, reportPipe[1]);
+        } else if (pid < 0) {
+            queueConstant("Error forking process\n");
+            break;
+        }
+    }
+    close(reportPipe[1]);
+
+    // collect samples until every stream has closed the pipe
+    for (j = 0; j < 3; j++) {
+        values[j] = NULL;
+    }
+    while (1) {
+        ssize_t numRead = read(reportPipe[0], &sample, sizeof(sample));
+        if (numRead == -1 && errno == EINTR) {
+            continue;
+        } else if (numRead != sizeof(sample)) {
+            break;
+        }
+
+        if (numSamples == cap) {
+            cap = cap ? cap * 2 : 256;
+            for (j = 0; j < 3; j++) {
+                values[j] = MEM_REALLOC(MEM_REPLAY, values[j], cap * sizeof(double));
+            }
+        }
+        values[0][numSamples] = sample.driftMs;
+        values[1][numSamples] = sample.latencyMs;
+        values[2][numSamples] = sample.recordedMs;
+        mismatches += sample.isMismatch;
+        numSamples++;
+    }
+    elapsedNs = monotonicNs() - startNs;
+    close(reportPipe[0]);
+
+    while (waitpid(-1, NULL, 0) != -1 || errno == EINTR);
+
+    // report the throughput and the distribution of drift and latency
+    for (j = 0; j < 3; j++) {
+        computeStats(values[j], numSamples, &stats[j]);
+    }
+    queueFormat("ran %d command line(s) in %.3f ms (%.1f command lines/s)\n", numSamples, elapsedNs / 1e6,
+                elapsedNs > 0 ? numSamples / (elapsedNs / 1e9) : 0.0);
+    if (numSamples > 0) {
+        queueFormat("%-11s %10s %10s %10s %10s %10s %10s %10s\n", "", "mean", "stddev", "min", "p50", "p90", "p99", "max");
+        queueStatsRow("drift_ms", &stats[0]);
+        queueStatsRow("latency_ms", &stats[1]);
+        queueStatsRow("recorded_ms", &stats[2]);
+    }
+    if (mismatches > 0) {
+        queueFormat("%d command line(s) exited with a different status than recorded\n", mismatches);
+    }
+
+    for (i = 0; i < numEntries; i++) {
+        MEM_FREE(entries[i].line);
+    }
+    MEM_FREE(entries);
+    for (j = 0; j < 3; j++) {
+        MEM_FREE(values[j]);
+    }
+
+    return mismatches > 0 || numSamples < numEntries * concurrency;
+}
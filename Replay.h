@@ -0,0 +1,53 @@
+/************************************************************************************
+ * This file defines functions related to recording interactive sessions and replaying
+ * them as a load generator. A recording has one line per command line that was run:
+ *
+ *     offset_ms <tab> exit_status <tab> duration_ms <tab> command line
+ *
+ * where offset_ms is when the command line started relative to the start of the
+ * recording. A replay runs the recording in several independent streams, each a
+ * forked copy of the shell using the normal parse and fork path, and reports the
+ * throughput and how far the streams drifted from the recorded schedule.
+ ***********************************************************************************/
+#ifndef CS344_REPLAY_H
+#define CS344_REPLAY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "CommandParser.h"
+#include "CommandDelegator.h"
+#include "Bench.h"
+
+#define RECORD_HEADER "#smallsh-record 1"
+#define DEFAULT_REPLAY_SPEED 1.0
+#define DEFAULT_REPLAY_CONCURRENCY 1
+
+// structure holding a recorded command line
+struct replayEntry {
+    double offsetMs;
+    int exitStatus;
+    double durationMs;
+    char *line;
+};
+
+// structure sent from a replay stream to the shell for each command line it ran
+struct replaySample {
+    double driftMs;     // how late the command line started compared to the schedule
+    double latencyMs;   // how long the command line took
+    double recordedMs;  // how long the command line took when recorded
+    int32_t isMismatch; // set if the exit status differs from the recorded one
+};
+
+int openRecord(char *path);
+void recordCommand(char *line, long long startNs, int exitStatus);
+void closeRecord();
+struct replayEntry *loadRecording(char *path, int *numEntries);
+void runReplayStream(struct replayEntry *entries, int numEntries, double speed, long long startNs, int reportFd);
+int replay(char *path, double speed, int concurrency);
+
+#endif //CS344_REPLAY_H
@@ -0,0 +1,277 @@
+#include "Scan.h"
+
+// version of the scans in use, -1 until it has been chosen
+static int version = -1;
+
+/************************************************************************************
+ * Function to choose the version of the scans to use
+ *
+ * @return: SCAN_ value of the version in use
+ ***********************************************************************************/
+int scanVersion() {
+    char *forced;
+
+    if (version != -1) {
+        return version;
+    }
+
+    version = SCAN_SCALAR;
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+#ifdef __SSE2__
+    version = SCAN_SSE2;
+#else
+    version = __builtin_cpu_supports("sse2") ? SCAN_SSE2 : SCAN_SCALAR;
+#endif
+    if (__builtin_cpu_supports("avx2")) {
+        version = SCAN_AVX2;
+    }
+#endif
+
+    // a version can only be forced down to one the cpu supports
+    if ((forced = getenv(SCAN_ISA)) != NULL) {
+        if (strcmp(forced, "scalar") == 0) {
+            version = SCAN_SCALAR;
+        } else if (strcmp(forced, "sse2") == 0 && version > SCAN_SSE2) {
+            version = SCAN_SSE2;
+        }
+    }
+
+    return version;
+}
+
+/************************************************************************************
+ * Function to find the nth set bit of a mask
+ *
+ * @param mask: the mask, with at least n bits set
+ * @param n: which set bit to find (1 for the lowest)
+ * @return: index of the bit
+ ***********************************************************************************/
+static int nthBit(unsigned int mask, size_t n) {
+    while (--n > 0) {
+        mask &= mask - 1;
+    }
+    return __builtin_ctz(mask);
+}
+
+#ifdef SCAN_X86
+
+/************************************************************************************
+ * AVX2 versions, comparing 32 bytes at a time
+ ***********************************************************************************/
+__attribute__((target("avx2,popcnt")))
+static size_t countByteAvx2(const char *buf, size_t len, char c, size_t *done) {
+    __m256i target = _mm256_set1_epi8(c);
+    size_t i, count = 0;
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *) (buf + i));
+        count += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, target)));
+    }
+
+    *done = i;
+    return count;
+}
+
+__attribute__((target("avx2,popcnt")))
+static const char *findNthByteAvx2(const char *buf, size_t len, char c, size_t *n, size_t *done) {
+    __m256i target = _mm256_set1_epi8(c);
+    unsigned int mask;
+    size_t i, count;
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *) (buf + i));
+        mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, target));
+        count = __builtin_popcount(mask);
+        if (count >= *n) {
+            return buf + i + nthBit(mask, *n);
+        }
+        *n -= count;
+    }
+
+    *done = i;
+    return NULL;
+}
+
+__attribute__((target("avx2")))
+static const char *findSubstringAvx2(const char *buf, size_t len, const char *needle, size_t needleLen, size_t *done) {
+    __m256i first = _mm256_set1_epi8(needle[0]), last = _mm256_set1_epi8(needle[needleLen - 1]);
+    unsigned int mask;
+    size_t i;
+
+    // candidates are positions where both the first and last bytes of the needle match
+    for (i = 0; i + needleLen - 1 + 32 <= len; i += 32) {
+        __m256i blockFirst = _mm256_loadu_si256((const __m256i *) (buf + i));
+        __m256i blockLast = _mm256_loadu_si256((const __m256i *) (buf + i + needleLen - 1));
+        mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first),
+                                                     _mm256_cmpeq_epi8(blockLast, last)));
+        while (mask != 0) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(buf + i + bit + 1, needle + 1, needleLen - 2) == 0) {
+                return buf + i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    *done = i;
+    return NULL;
+}
+
+/************************************************************************************
+ * SSE2 versions, comparing 16 bytes at a time
+ ***********************************************************************************/
+__attribute__((target("sse2")))
+static size_t countByteSse2(const char *buf, size_t len, char c, size_t *done) {
+    __m128i target = _mm_set1_epi8(c);
+    size_t i, count = 0;
+
+    for (i = 0; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *) (buf + i));
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(block, target)));
+    }
+
+    *done = i;
+    return count;
+}
+
+__attribute__((target("sse2")))
+static const char *findNthByteSse2(const char *buf, size_t len, char c, size_t *n, size_t *done) {
+    __m128i target = _mm_set1_epi8(c);
+    unsigned int mask;
+    size_t i, count;
+
+    for (i = 0; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *) (buf + i));
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, target));
+        count = __builtin_popcount(mask);
+        if (count >= *n) {
+            return buf + i + nthBit(mask, *n);
+        }
+        *n -= count;
+    }
+
+    *done = i;
+    return NULL;
+}
+
+__attribute__((target("sse2")))
+static const char *findSubstringSse2(const char *buf, size_t len, const char *needle, size_t needleLen, size_t *done) {
+    __m128i first = _mm_set1_epi8(needle[0]), last = _mm_set1_epi8(needle[needleLen - 1]);
+    unsigned int mask;
+    size_t i;
+
+    for (i = 0; i + needleLen - 1 + 16 <= len; i += 16) {
+        __m128i blockFirst = _mm_loadu_si128((const __m128i *) (buf + i));
+        __m128i blockLast = _mm_loadu_si128((const __m128i *) (buf + i + needleLen - 1));
+        mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first),
+                                               _mm_cmpeq_epi8(blockLast, last)));
+        while (mask != 0) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(buf + i + bit + 1, needle + 1, needleLen - 2) == 0) {
+                return buf + i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    *done = i;
+    return NULL;
+}
+
+#endif
+
+/************************************************************************************
+ * Function to count the occurrences of a byte in a buffer
+ *
+ * @param buf: buffer to scan
+ * @param len: length of the buffer
+ * @param c: byte to count
+ * @return: number of occurrences
+ ***********************************************************************************/
+size_t countByte(const char *buf, size_t len, char c) {
+    size_t i = 0, count = 0;
+
+#ifdef SCAN_X86
+    if (scanVersion() == SCAN_AVX2) {
+        count = countByteAvx2(buf, len, c, &i);
+    } else if (scanVersion() == SCAN_SSE2) {
+        count = countByteSse2(buf, len, c, &i);
+    }
+#endif
+
+    // the bytes after the last full block (or all of them without simd)
+    for (; i < len; i++) {
+        count += buf[i] == c;
+    }
+
+    return count;
+}
+
+/************************************************************************************
+ * Function to find the nth occurrence of a byte in a buffer
+ *
+ * @param buf: buffer to scan
+ * @param len: length of the buffer
+ * @param c: byte to find
+ * @param n: which occurrence to find (at least 1), reduced by the number of
+ *      occurrences in the buffer if there are fewer than n
+ * @return: the nth occurrence or NULL if the buffer has fewer than n
+ ***********************************************************************************/
+const char *findNthByte(const char *buf, size_t len, char c, size_t *n) {
+    const char *found = NULL;
+    size_t i = 0;
+
+#ifdef SCAN_X86
+    if (scanVersion() == SCAN_AVX2) {
+        found = findNthByteAvx2(buf, len, c, n, &i);
+    } else if (scanVersion() == SCAN_SSE2) {
+        found = findNthByteSse2(buf, len, c, n, &i);
+    }
+    if (found != NULL) {
+        return found;
+    }
+#endif
+
+    for (; i < len; i++) {
+        if (buf[i] == c && --(*n) == 0) {
+            return buf + i;
+        }
+    }
+
+    return found;
+}
+
+/************************************************************************************
+ * Function to find the first occurrence of a string in a buffer
+ *
+ * @param buf: buffer to scan
+ * @param len: length of the buffer
+ * @param needle: string to find
+ * @param needleLen: length of the string (at least 1)
+ * @return: the first occurrence or NULL if there is none
+ ***********************************************************************************/
+const char *findSubstring(const char *buf, size_t len, const char *needle, size_t needleLen) {
+    const char *found = NULL;
+    size_t i = 0;
+
+    if (needleLen > len) {
+        return NULL;
+    } else if (needleLen == 1) {
+        return memchr(buf, needle[0], len);
+    }
+
+#ifdef SCAN_X86
+    if (scanVersion() == SCAN_AVX2) {
+        found = findSubstringAvx2(buf, len, needle, needleLen, &i);
+    } else if (scanVersion() == SCAN_SSE2) {
+        found = findSubstringSse2(buf, len, needle, needleLen, &i);
+    }
+    if (found != NULL) {
+        return found;
+    }
+#endif
+
+    // the positions after the last full block (or all of them without simd)
+    return memmem(buf + i, len - i, needle, needleLen);
+}
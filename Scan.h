@@ -0,0 +1,31 @@
+/************************************************************************************
+ * This file defines functions related to scanning buffers for bytes and substrings,
+ * used by the filter built ins. Each scan has an AVX2, an SSE2 and a scalar version.
+ * The fastest version the cpu supports is chosen the first time a scan runs, unless
+ * SMALLSH_SCAN names the version to use (avx2, sse2 or scalar).
+ ***********************************************************************************/
+#ifndef CS344_SCAN_H
+#define CS344_SCAN_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+
+#define SCAN_ISA "SMALLSH_SCAN"  // env var to force a version of the scans
+
+// versions of the scans
+#define SCAN_SCALAR 0
+#define SCAN_SSE2 1
+#define SCAN_AVX2 2
+
+int scanVersion();
+size_t countByte(const char *buf, size_t len, char c);
+const char *findNthByte(const char *buf, size_t len, char c, size_t *n);
+const char *findSubstring(const char *buf, size_t len, const char *needle, size_t needleLen);
+
+#endif //CS344_SCAN_H
@@ -0,0 +1,708 @@
+#include "ScriptCache.h"
+
+/************************************************************************************
+ * Function to build the path of the cache file for a script, creating the cache
+ * directory if necessary. The cache directory is taken from SMALLSH_CACHE_DIR, then
+ * XDG_CACHE_HOME/smallsh, then HOME/.cache/smallsh
+ *
+ * @param scriptPath: path of the script as given on the command line
+ * @return: newly allocated path of the cache file or NULL if there is no usable
+ *          cache directory
+ ***********************************************************************************/
+char *getCachePath(char *scriptPath) {
+    char dir[PATH_MAX], fullPath[PATH_MAX];
+    char *path;
+
+    // find the cache directory, creating the parent directory of the default location
+    if (getenv(CACHE_DIR)) {
+        snprintf(dir, PATH_MAX, "%s", getenv(CACHE_DIR));
+    } else if (getenv("XDG_CACHE_HOME")) {
+        snprintf(dir, PATH_MAX, "%s/smallsh", getenv("XDG_CACHE_HOME"));
+    } else if (getenv("HOME")) {
+        snprintf(dir, PATH_MAX, "%s/.cache", getenv("HOME"));
+        mkdir(dir, 0700);
+        snprintf(dir, PATH_MAX, "%s/.cache/smallsh", getenv("HOME"));
+    } else {
+        return NULL;
+    }
+
+    if (mkdir(dir, 0700) == -1 && errno != EEXIST) {
+        return NULL;
+    }
+
+    // key the cache file on the absolute path of the script
+    if (realpath(scriptPath, fullPath) == NULL) {
+        return NULL;
+    }
+
+    // a cache directory too long to hold the file name is not usable
+    path = MEM_CALLOC(MEM_SCRIPT, PATH_MAX, sizeof(char));
+    if (snprintf(path, PATH_MAX, "%s/%016llx%s", dir,
+                 (unsigned long long) hashBytes(fullPath, strlen(fullPath)), CACHE_EXT) >= PATH_MAX) {
+        MEM_FREE(path);
+        return NULL;
+    }
+
+    return path;
+}
+
+/************************************************************************************
+ * Function to append raw bytes to the code buffer, growing it as necessary
+ *
+ * @param buf: code buffer to append to
+ * @param bytes: bytes to append
+ * @param len: number of bytes to append
+ ***********************************************************************************/
+void emitBytes(struct codeBuffer *buf, const void *bytes, size_t len) {
+    // double the capacity until the new bytes fit
+    if (buf->len + len > buf->cap) {
+        while (buf->len + len > buf->cap) {
+            buf->cap = buf->cap ? buf->cap * 2 : 1024;
+        }
+        buf->data = MEM_REALLOC(MEM_SCRIPT, buf->data, buf->cap);
+    }
+
+    memcpy(buf->data + buf->len, bytes, len);
+    buf->len += len;
+}
+
+/************************************************************************************
+ * Function to append a string operand to the code buffer. The operand is stored as a
+ * flag byte, a 32 bit length, and the unterminated characters.
+ *
+ * @param buf: code buffer to append to
+ * @param str: the unexpanded string
+ ***********************************************************************************/
+void emitOperand(struct codeBuffer *buf, char *str) {
+    unsigned char flags = 0;
+    uint32_t len = strlen(str);
+
+    // mark the string if variables need to be expanded when it is loaded
+    if (countVars(str) > 0) {
+        flags |= STR_EXPAND;
+    }
+
+    emitBytes(buf, &flags, 1);
+    emitBytes(buf, &len, sizeof(uint32_t));
+    emitBytes(buf, str, len);
+}
+
+/************************************************************************************
+ * Function to append an op with a string operand to the code buffer
+ *
+ * @param buf: code buffer to append to
+ * @param op: op code that takes the string as its operand
+ * @param str: the unexpanded string
+ ***********************************************************************************/
+void emitString(struct codeBuffer *buf, unsigned char op, char *str) {
+    emitBytes(buf, &op, 1);
+    emitOperand(buf, str);
+}
+
+/************************************************************************************
+ * Function to append the op for a redirection to the code buffer
+ *
+ * @param buf: code buffer to append to
+ * @param redir: the redirection, with an unexpanded target
+ ***********************************************************************************/
+void emitRedirect(struct codeBuffer *buf, struct redirection *redir) {
+    unsigned char op = OP_REDIR, type = redir->type;
+    int32_t fd = redir->fd, dupFd = redir->dupFd;
+
+    emitBytes(buf, &op, 1);
+    emitBytes(buf, &type, 1);
+    emitBytes(buf, &fd, sizeof(int32_t));
+    emitBytes(buf, &dupFd, sizeof(int32_t));
+    if (redir->target != NULL) {
+        emitOperand(buf, redir->target);
+    }
+}
+
+/************************************************************************************
+ * Function to append the op for a process substitution to the code buffer
+ *
+ * @param buf: code buffer to append to
+ * @param cmd: command the substitution belongs to
+ * @param sub: the process substitution
+ ***********************************************************************************/
+void emitProcSub(struct codeBuffer *buf, struct command *cmd, struct procSub *sub) {
+    unsigned char op = OP_PROCSUB, type = sub->type, isRedirect = sub->redir != NULL;
+    int32_t index = sub->argIdx;
+    uint32_t numCommands = buf->numCommands;
+    struct redirection *cur;
+
+    // a substituted redirection is stored as its position in the command's redirections
+    if (isRedirect) {
+        for (index = 0, cur = cmd->redirs; cur != sub->redir; cur = cur->next) {
+            index++;
+        }
+    }
+
+    emitBytes(buf, &op, 1);
+    emitBytes(buf, &type, 1);
+    emitBytes(buf, &index, sizeof(int32_t));
+    emitBytes(buf, &isRedirect, 1);
+
+    // the substituted list is not one of the script's commands
+    compileCommand(buf, sub->list);
+    buf->numCommands = numCommands;
+}
+
+/************************************************************************************
+ * Function to append the ops for a parsed (but unexpanded) command list
+ *
+ * @param buf: code buffer to append to
+ * @param cmd: first command of the list to compile
+ ***********************************************************************************/
+void compileCommand(struct codeBuffer *buf, struct command *cmd) {
+    struct redirection *cur;
+    struct procSub *sub;
+    uint32_t numCommands;
+    unsigned char op;
+    int i;
+
+    // assignments for the command's environment, then argument templates in order
+    for (i = 0; i < cmd->numAssigns; i++) {
+        emitString(buf, OP_ASSIGN, cmd->assigns[i]);
+    }
+    for (i = 0; i < cmd->numArgs; i++) {
+        emitString(buf, OP_ARG, cmd->args[i]);
+    }
+
+    // redirections in the order they are applied
+    for (cur = cmd->redirs; cur != NULL; cur = cur->next) {
+        emitRedirect(buf, cur);
+    }
+
+    // process substitutions, after the args and redirections they replace
+    for (sub = cmd->procSubs; sub != NULL; sub = sub->next) {
+        emitProcSub(buf, cmd, sub);
+    }
+
+    // the body of a function definition, which is not one of the script's commands
+    if (cmd->body != NULL) {
+        numCommands = buf->numCommands;
+        op = OP_FUNCTION;
+        emitBytes(buf, &op, 1);
+        compileCommand(buf, cmd->body);
+        buf->numCommands = numCommands;
+    }
+
+    // background flag, only honoured if not in foreground only mode when run
+    if (cmd->isBgProcess) {
+        op = OP_BACKGROUND;
+        emitBytes(buf, &op, 1);
+    }
+
+    // join the next command of the list or end the list
+    if (cmd->next != NULL) {
+        op = OP_NEXT;
+        emitBytes(buf, &op, 1);
+        op = cmd->nextOp;
+        emitBytes(buf, &op, 1);
+        compileCommand(buf, cmd->next);
+    } else {
+        op = OP_END;
+        emitBytes(buf, &op, 1);
+        buf->numCommands++;
+    }
+}
+
+/************************************************************************************
+ * Function to compile the contents of a script into code. Every line is parsed with
+ * variable expansion deferred so the code does not depend on the shell's pid.
+ *
+ * @param contents: raw contents of the script
+ * @param len: length of the contents
+ * @param buf: code buffer to fill
+ ***********************************************************************************/
+void compileScript(char *contents, size_t len, struct codeBuffer *buf) {
+    char input[INPUT_LENGTH];
+    char *args[MAX_ARGS];
+    size_t pos = 0, lineLen;
+    char *lineEnd;
+
+    setExpandVariables(FALSE);
+
+    while (pos < len) {
+        // find the end of the current line
+        lineEnd = memchr(contents + pos, '\n', len - pos);
+        lineLen = lineEnd ? (size_t) (lineEnd - (contents + pos)) : len - pos;
+
+        // copy the line so it can be parsed in place, truncating it if it's too long
+        memset(input, 0, INPUT_LENGTH);
+        memcpy(input, contents + pos, lineLen < INPUT_LENGTH ? lineLen : INPUT_LENGTH - 1);
+        memset(args, 0, MAX_ARGS * sizeof(char *));
+        pos += lineLen + 1;
+
+        // parse the line and compile it if it's not blank or a comment
+        struct command *cmd = parseInput(input, args, FALSE);
+        if (cmd != NULL) {
+            compileCommand(buf, cmd);
+            freeCommand(cmd);
+        }
+    }
+
+    setExpandVariables(TRUE);
+}
+
+/************************************************************************************
+ * Function to write a compiled script to the cache. It is written to a temporary
+ * file first and renamed so a partially written cache file is never mapped.
+ *
+ * @param cachePath: path of the cache file
+ * @param header: header describing the script the code was compiled from
+ * @param buf: compiled code
+ * @return: flag indicating whether the cache file was written
+ ***********************************************************************************/
+int writeCache(char *cachePath, struct cacheHeader *header, struct codeBuffer *buf) {
+    char tempPath[PATH_MAX];
+    int fd, res = TRUE;
+
+    snprintf(tempPath, PATH_MAX, "%s.%d", cachePath, getpid());
+    fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd == -1) {
+        return FALSE;
+    }
+
+    header->numCommands = buf->numCommands;
+    header->codeSize = buf->len;
+
+    // write the header then the code and move the finished file into place
+    if (write(fd, header, sizeof(struct cacheHeader)) != sizeof(struct cacheHeader) ||
+        write(fd, buf->data, buf->len) != (ssize_t) buf->len) {
+        res = FALSE;
+    }
+    close(fd);
+
+    if (!res || rename(tempPath, cachePath) == -1) {
+        unlink(tempPath);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to map a cache file read only if it matches the current script
+ *
+ * @param cachePath: path of the cache file
+ * @param expected: header describing the current state of the script
+ * @return: the mapped script or NULL if there is no valid cache file
+ ***********************************************************************************/
+struct compiledScript *mapCache(char *cachePath, struct cacheHeader *expected) {
+    struct compiledScript *script;
+    const struct cacheHeader *header;
+    struct stat st;
+    void *map;
+
+    int fd = open(cachePath, O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    if (fstat(fd, &st) == -1 || st.st_size < (off_t) sizeof(struct cacheHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    // the cache is only valid if it was compiled from the same version of the script
+    header = map;
+    if (memcmp(header->magic, CACHE_MAGIC, 4) != 0 || header->version != CACHE_VERSION ||
+        header->mtimeSec != expected->mtimeSec || header->mtimeNsec != expected->mtimeNsec ||
+        header->size != expected->size || header->contentHash != expected->contentHash ||
+        sizeof(struct cacheHeader) + header->codeSize != (size_t) st.st_size) {
+        munmap(map, st.st_size);
+        return NULL;
+    }
+
+    script = MEM_CALLOC(MEM_SCRIPT, 1, sizeof(struct compiledScript));
+    script->map = map;
+    script->mapLen = st.st_size;
+    script->code = (const unsigned char *) map + sizeof(struct cacheHeader);
+    script->codeSize = header->codeSize;
+
+    return script;
+}
+
+/************************************************************************************
+ * Function to release a mapped script
+ *
+ * @param script: the mapped script
+ ***********************************************************************************/
+void unmapCache(struct compiledScript *script) {
+    munmap(script->map, script->mapLen);
+    MEM_FREE(script);
+}
+
+/************************************************************************************
+ * Function to load a string operand from compiled code, expanding variables if it
+ * was marked as an expansion point
+ *
+ * @param code: compiled code
+ * @param pos: position of the operand, advanced past it
+ * @return: newly allocated string
+ ***********************************************************************************/
+char *loadString(const unsigned char *code, size_t *pos) {
+    unsigned char flags = code[*pos];
+    uint32_t len;
+    char *str, *expanded;
+
+    memcpy(&len, code + *pos + 1, sizeof(uint32_t));
+    str = MEM_CALLOC(MEM_SCRIPT, len + 1, sizeof(char));
+    memcpy(str, code + *pos + 1 + sizeof(uint32_t), len);
+    *pos += 1 + sizeof(uint32_t) + len;
+
+    // expand the variables at this expansion point
+    if (flags & STR_EXPAND) {
+        expanded = parseArg(str);
+        MEM_FREE(str);
+        str = expanded;
+    }
+
+    return str;
+}
+
+/************************************************************************************
+ * Function to check that a complete string operand starts at a position of the code
+ *
+ * @param code: compiled code
+ * @param codeSize: size of the compiled code
+ * @param pos: position of the operand
+ * @return: TRUE if the operand fits within the code
+ ***********************************************************************************/
+int hasString(const unsigned char *code, size_t codeSize, size_t pos) {
+    uint32_t len;
+
+    if (pos + 1 + sizeof(uint32_t) > codeSize) {
+        return FALSE;
+    }
+    memcpy(&len, code + pos + 1, sizeof(uint32_t));
+
+    return pos + 1 + sizeof(uint32_t) + len <= codeSize;
+}
+
+/************************************************************************************
+ * Function to load a redirection from compiled code and add it to a command
+ *
+ * @param code: compiled code
+ * @param codeSize: size of the compiled code
+ * @param pos: position of the redirection's operands, advanced past them
+ * @param cmd: command to add the redirection to
+ * @return: FALSE if the redirection is not valid
+ ***********************************************************************************/
+int loadRedirect(const unsigned char *code, size_t codeSize, size_t *pos, struct command *cmd) {
+    struct redirection redir = {0};
+    int32_t fd, dupFd;
+
+    if (*pos + 1 + 2 * sizeof(int32_t) > codeSize) {
+        return FALSE;
+    }
+    redir.type = code[*pos];
+    memcpy(&fd, code + *pos + 1, sizeof(int32_t));
+    memcpy(&dupFd, code + *pos + 1 + sizeof(int32_t), sizeof(int32_t));
+    *pos += 1 + 2 * sizeof(int32_t);
+    redir.fd = fd;
+    redir.dupFd = dupFd;
+
+    if (redir.type < REDIR_IN || redir.type > REDIR_CLOSE || fd < 0) {
+        return FALSE;
+    }
+
+    // file redirections are followed by their target
+    if (redir.type == REDIR_IN || redir.type == REDIR_OUT || redir.type == REDIR_APPEND) {
+        if (!hasString(code, codeSize, *pos)) {
+            return FALSE;
+        }
+        redir.target = loadString(code, pos);
+    }
+
+    addRedirect(cmd, &redir, FALSE);
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to load a process substitution from compiled code and add it to a command
+ *
+ * @param code: compiled code
+ * @param codeSize: size of the compiled code
+ * @param pos: position of the substitution's operands, advanced past its list
+ * @param cmd: command to add the substitution to
+ * @param isForeOnlyMode: flag for foreground only mode
+ * @return: FALSE if the substitution is not valid
+ ***********************************************************************************/
+int loadProcSub(const unsigned char *code, size_t codeSize, size_t *pos, struct command *cmd, int isForeOnlyMode) {
+    struct procSub *sub;
+    struct redirection *redir = NULL;
+    int32_t index;
+    int type, isRedirect;
+
+    if (*pos + 2 + sizeof(int32_t) > codeSize) {
+        return FALSE;
+    }
+    type = code[*pos];
+    memcpy(&index, code + *pos + 1, sizeof(int32_t));
+    isRedirect = code[*pos + 1 + sizeof(int32_t)];
+    *pos += 2 + sizeof(int32_t);
+
+    // the substitution must replace an arg or a file redirection already loaded
+    if (isRedirect) {
+        for (redir = cmd->redirs; redir != NULL && index > 0; redir = redir->next) {
+            index--;
+        }
+        if (redir == NULL || redir->target == NULL || index != 0) {
+            return FALSE;
+        }
+        index = -1;
+    } else if (index < 0 || index >= cmd->numArgs) {
+        return FALSE;
+    }
+    if (type != PROCSUB_IN && type != PROCSUB_OUT) {
+        return FALSE;
+    }
+
+    sub = MEM_CALLOC(MEM_SCRIPT, 1, sizeof(struct procSub));
+    sub->type = type;
+    sub->argIdx = index;
+    sub->redir = redir;
+    sub->fd = -1;
+    sub->args = MEM_CALLOC(MEM_SCRIPT, MAX_ARGS, sizeof(char *));
+    sub->list = loadCommand(code, codeSize, pos, sub->args, MAX_ARGS, isForeOnlyMode);
+
+    if (sub->list == NULL) {
+        MEM_FREE(sub->args);
+        MEM_FREE(sub);
+        return FALSE;
+    }
+
+    addProcSub(cmd, sub);
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to load the body of a function definition from compiled code
+ *
+ * @param code: compiled code
+ * @param codeSize: size of the compiled code
+ * @param pos: position of the body, advanced past it
+ * @param cmd: the definition, with the function's name as its only arg
+ * @param isForeOnlyMode: flag for foreground only mode
+ * @return: FALSE if the definition is not valid
+ ***********************************************************************************/
+int loadFunction(const unsigned char *code, size_t codeSize, size_t *pos, struct command *cmd, int isForeOnlyMode) {
+    struct command *cur;
+
+    if (cmd->numArgs != 1 || cmd->body != NULL) {
+        return FALSE;
+    }
+
+    cmd->bodyArgs = MEM_CALLOC(MEM_SCRIPT, MAX_ARGS, sizeof(char *));
+    cmd->body = loadCommand(code, codeSize, pos, cmd->bodyArgs, MAX_ARGS, isForeOnlyMode);
+    if (cmd->body == NULL) {
+        return FALSE;
+    }
+
+    // the body is run on every call (and can not define functions itself)
+    for (cur = cmd->body; cur != NULL; cur = cur->next) {
+        if (cur->body != NULL) {
+            return FALSE;
+        }
+    }
+    keepStatusArgs(cmd->body);
+
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to load the next command list from compiled code. As with parsed command
+ * lists every command shares the args array, each terminated by a NULL.
+ *
+ * @param code: compiled code
+ * @param codeSize: size of the compiled code
+ * @param pos: position of the command in the code, advanced past it
+ * @param args: array of character pointers to hold the arguments
+ * @param maxArgs: number of pointers available in args
+ * @param isForeOnlyMode: flag for foreground only mode
+ * @return: the first command of the list or NULL if there are no more valid commands
+ ***********************************************************************************/
+struct command *loadCommand(const unsigned char *code, size_t codeSize, size_t *pos, char **args, int maxArgs, int isForeOnlyMode) {
+    struct command *cmd = MEM_CALLOC(MEM_SCRIPT, 1, sizeof(struct command));
+    cmd->args = args;
+
+    while (*pos < codeSize) {
+        unsigned char op = code[(*pos)++];
+
+        // string operands must fit within the code
+        if ((op == OP_ARG || op == OP_ASSIGN) && !hasString(code, codeSize, *pos)) {
+            break;
+        }
+
+        switch (op) {
+            case OP_ARG:
+                if (cmd->numArgs < maxArgs - 1) {
+                    args[cmd->numArgs++] = loadString(code, pos);
+                } else {
+                    MEM_FREE(loadString(code, pos));
+                }
+                break;
+            case OP_ASSIGN:
+                cmd->assigns = MEM_REALLOC(MEM_SCRIPT, cmd->assigns, (cmd->numAssigns + 2) * sizeof(char *));
+                cmd->assigns[cmd->numAssigns++] = loadString(code, pos);
+                cmd->assigns[cmd->numAssigns] = NULL;
+                break;
+            case OP_REDIR:
+                if (!loadRedirect(code, codeSize, pos, cmd)) {
+                    *pos = codeSize;
+                }
+                break;
+            case OP_PROCSUB:
+                if (!loadProcSub(code, codeSize, pos, cmd, isForeOnlyMode)) {
+                    *pos = codeSize;
+                }
+                break;
+            case OP_FUNCTION:
+                if (!loadFunction(code, codeSize, pos, cmd, isForeOnlyMode)) {
+                    *pos = codeSize;
+                }
+                break;
+            case OP_BACKGROUND:
+                cmd->isBgProcess = !isForeOnlyMode;
+                break;
+            case OP_NEXT:
+                // load the rest of the list into the args after this command's NULL
+                if (cmd->numArgs > 0 && *pos < codeSize && maxArgs - cmd->numArgs - 1 > 1) {
+                    cmd->nextOp = code[(*pos)++];
+                    cmd->next = loadCommand(code, codeSize, pos, args + cmd->numArgs + 1,
+                                            maxArgs - cmd->numArgs - 1, isForeOnlyMode);
+                    if (cmd->next != NULL) {
+                        return cmd;
+                    }
+                }
+                *pos = codeSize;
+                break;
+            case OP_END:
+                // a command needs at least one argument
+                if (cmd->numArgs > 0) {
+                    return cmd;
+                }
+                /* fall through */
+            default:
+                *pos = codeSize;
+        }
+    }
+
+    // the code ended before the command was complete
+    freeCommand(cmd);
+    return NULL;
+}
+
+/************************************************************************************
+ * Function to execute each command in compiled code in order
+ *
+ * @param code: compiled code
+ * @param codeSize: size of the compiled code
+ * @param procList: linked list of outstanding processes
+ ***********************************************************************************/
+void runCode(const unsigned char *code, size_t codeSize, struct processLinkedList *procList) {
+    int isForeOnlyMode = 0;
+    char *args[MAX_ARGS];
+    size_t pos = 0;
+    struct command *cmd;
+
+    while (pos < codeSize) {
+        // check if FG-only mode should be toggled and toggle it if so
+        if (toggleFgMode) {
+            applyFgOnlyToggle(&isForeOnlyMode);
+        }
+
+        memset(args, 0, MAX_ARGS * sizeof(char *));
+        cmd = loadCommand(code, codeSize, &pos, args, MAX_ARGS, isForeOnlyMode);
+        if (cmd == NULL) {
+            break;
+        }
+
+        executeList(cmd, procList, &isForeOnlyMode);
+        freeCommand(cmd);
+
+        // clear any finished background processes before the next command
+        nonBlockClearFinished(procList);
+        flushOutput();
+    }
+}
+
+/************************************************************************************
+ * Function to run a script. If the cache holds code compiled from the current
+ * version of the script it is mapped and run without parsing, otherwise the script
+ * is compiled, cached, and run from the freshly compiled code.
+ *
+ * @param path: path of the script
+ * @param procList: linked list of outstanding processes
+ ***********************************************************************************/
+void runScript(char *path, struct processLinkedList *procList) {
+    struct cacheHeader header;
+    struct codeBuffer buf;
+    struct compiledScript *script = NULL;
+    struct stat st;
+    char *contents, *cachePath;
+    ssize_t numRead;
+    size_t total = 0;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        queueFormat("cannot open %s for input\n", path);
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+
+    // read the script so its contents can be hashed (and compiled if necessary)
+    contents = MEM_CALLOC(MEM_SCRIPT, st.st_size + 1, sizeof(char));
+    while (total < (size_t) st.st_size &&
+           ((numRead = read(fd, contents + total, st.st_size - total)) > 0 ||
+            (numRead == -1 && errno == EINTR))) {
+        if (numRead > 0) {
+            total += numRead;
+        }
+    }
+    close(fd);
+
+    // describe the current version of the script, zeroing the padding written with it
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = CACHE_VERSION;
+    header.mtimeSec = st.st_mtim.tv_sec;
+    header.mtimeNsec = st.st_mtim.tv_nsec;
+    header.size = total;
+    header.contentHash = hashBytes(contents, total);
+
+    cachePath = getCachePath(path);
+    if (cachePath != NULL) {
+        script = mapCache(cachePath, &header);
+    }
+
+    if (script != NULL) {
+        // warm start, run the mapped code directly
+        MEM_FREE(contents);
+        runCode(script->code, script->codeSize, procList);
+        unmapCache(script);
+    } else {
+        // cold start, compile the script and save it for next time
+        memset(&buf, 0, sizeof(buf));
+        compileScript(contents, total, &buf);
+        MEM_FREE(contents);
+        if (cachePath != NULL) {
+            writeCache(cachePath, &header, &buf);
+        }
+        runCode(buf.data, buf.len, procList);
+        MEM_FREE(buf.data);
+    }
+
+    MEM_FREE(cachePath);
+}
@@ -0,0 +1,95 @@
+/************************************************************************************
+ * This file defines functions related to running scripts and caching them in a
+ * compiled form so later runs of an unchanged script can skip parsing entirely
+ ***********************************************************************************/
+#ifndef CS344_SCRIPTCACHE_H
+#define CS344_SCRIPTCACHE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "CommandParser.h"
+#include "CommandDelegator.h"
+
+// identification of the cache file format
+#define CACHE_MAGIC "SSHC"
+#define CACHE_VERSION 8
+#define CACHE_EXT ".ssc"
+#define CACHE_DIR "SMALLSH_CACHE_DIR"  // env var to override the cache directory
+
+// op codes making up a compiled command list. Commands are joined by OP_NEXT (with
+// the LIST_ operator as its operand) and the last one is terminated by OP_END.
+// OP_REDIR is followed by the REDIR_ type, the 32 bit fd and dupFd, and for file
+// redirections the target as a string operand. OP_PROCSUB is followed by the PROCSUB_
+// type, the 32 bit index of the arg (or redirection) it replaces, a byte set if the
+// index is of a redirection, and the code of the substituted command list. OP_FUNCTION
+// follows the name of a function definition and is followed by the code of its body.
+// OP_ASSIGN has a NAME=value string operand given before the command's name.
+#define OP_ARG 1
+#define OP_REDIR 2
+#define OP_BACKGROUND 4
+#define OP_END 5
+#define OP_NEXT 6
+#define OP_PROCSUB 7
+#define OP_FUNCTION 8
+#define OP_ASSIGN 9
+
+// flag on a string operand marking it as an expansion point (contains $$)
+#define STR_EXPAND 1
+
+// header at the start of a cache file used to check that it matches the script
+struct cacheHeader {
+    char magic[4];
+    uint32_t version;
+    int64_t mtimeSec;
+    int64_t mtimeNsec;
+    int64_t size;
+    uint64_t contentHash;
+    uint32_t numCommands;
+    uint32_t codeSize;
+};
+
+// structure to hold the code of a compiled script as it is generated
+struct codeBuffer {
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+    uint32_t numCommands;
+};
+
+// structure to hold a compiled script that has been mapped from the cache
+struct compiledScript {
+    void *map;
+    size_t mapLen;
+    const unsigned char *code;
+    size_t codeSize;
+};
+
+char *getCachePath(char *scriptPath);
+void emitBytes(struct codeBuffer *buf, const void *bytes, size_t len);
+void emitString(struct codeBuffer *buf, unsigned char op, char *str);
+void emitOperand(struct codeBuffer *buf, char *str);
+void emitRedirect(struct codeBuffer *buf, struct redirection *redir);
+void emitProcSub(struct codeBuffer *buf, struct command *cmd, struct procSub *sub);
+void compileCommand(struct codeBuffer *buf, struct command *cmd);
+void compileScript(char *contents, size_t len, struct codeBuffer *buf);
+int writeCache(char *cachePath, struct cacheHeader *header, struct codeBuffer *buf);
+struct compiledScript *mapCache(char *cachePath, struct cacheHeader *expected);
+void unmapCache(struct compiledScript *script);
+int hasString(const unsigned char *code, size_t codeSize, size_t pos);
+char *loadString(const unsigned char *code, size_t *pos);
+int loadRedirect(const unsigned char *code, size_t codeSize, size_t *pos, struct command *cmd);
+int loadFunction(const unsigned char *code, size_t codeSize, size_t *pos, struct command *cmd, int isForeOnlyMode);
+int loadProcSub(const unsigned char *code, size_t codeSize, size_t *pos, struct command *cmd, int isForeOnlyMode);
+struct command *loadCommand(const unsigned char *code, size_t codeSize, size_t *pos, char **args, int maxArgs, int isForeOnlyMode);
+void runCode(const unsigned char *code, size_t codeSize, struct processLinkedList *procList);
+void runScript(char *path, struct processLinkedList *procList);
+
+#endif //CS344_SCRIPTCACHE_H
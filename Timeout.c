@@ -0,0 +1,434 @@
+#include "Timeout.h"
+#include "JobState.h"
+#include "Events.h"
+#include "Variables.h"
+#include "Prompt.h"
+#include "JobControl.h"
+
+// signals that can be given to timeout by name
+static struct {
+    char *name;
+    int signal;
+} signalNames[] = {{"HUP", SIGHUP}, {"INT", SIGINT}, {"QUIT", SIGQUIT}, {"KILL", SIGKILL},
+                   {"USR1", SIGUSR1}, {"USR2", SIGUSR2}, {"ALRM", SIGALRM}, {"TERM", SIGTERM}};
+
+/************************************************************************************
+ * Function to parse a duration with an optional unit (ms, s, m, h or d)
+ *
+ * @param text: the duration
+ * @param ms: loaded with the duration in milliseconds
+ * @return: FALSE if the duration is not valid
+ ***********************************************************************************/
+int parseDuration(char *text, long *ms) {
+    char *unit;
+    double value = strtod(text, &unit), scale;
+
+    if (unit == text || value < 0) {
+        return FALSE;
+    }
+
+    if (strcmp(unit, "ms") == 0) {
+        scale = 1;
+    } else if (*unit == '\0' || strcmp(unit, "s") == 0) {
+        scale = 1e3;
+    } else if (strcmp(unit, "m") == 0) {
+        scale = 60e3;
+    } else if (strcmp(unit, "h") == 0) {
+        scale = 3600e3;
+    } else if (strcmp(unit, "d") == 0) {
+        scale = 86400e3;
+    } else {
+        return FALSE;
+    }
+
+    *ms = (long) (value * scale);
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to parse a signal given as a number or a name (with or without SIG)
+ *
+ * @param text: the signal
+ * @return: the signal number or -1 if it is not valid
+ ***********************************************************************************/
+int parseSignal(char *text) {
+    int i;
+
+    if (*text >= '0' && *text <= '9') {
+        i = atoi(text);
+        return i > 0 && i < NSIG ? i : -1;
+    }
+
+    if (strncmp(text, "SIG", 3) == 0) {
+        text += 3;
+    }
+    for (i = 0; i < (int) (sizeof(signalNames) / sizeof(signalNames[0])); i++) {
+        if (strcmp(text, signalNames[i].name) == 0) {
+            return signalNames[i].signal;
+        }
+    }
+
+    return -1;
+}
+
+/************************************************************************************
+ * Function to arm a timerfd to expire once after a number of milliseconds
+ ***********************************************************************************/
+static void armTimer(int timerFd, long ms) {
+    struct itimerspec spec = {0};
+
+    spec.it_value.tv_sec = ms / 1000;
+    spec.it_value.tv_nsec = (ms % 1000) * 1000000;
+
+    // an all zero time would disarm the timer instead
+    if (ms == 0) {
+        spec.it_value.tv_nsec = 1;
+    }
+    timerfd_settime(timerFd, 0, &spec, NULL);
+}
+
+/************************************************************************************
+ * Function to create and arm the deadline of a job
+ *
+ * @param durationMs: time until the signal is sent
+ * @param signal: signal to send
+ * @param killAfterMs: time after the signal until SIGKILL is sent (0 for never)
+ * @return: the deadline or NULL if the timer could not be created
+ ***********************************************************************************/
+struct jobTimeout *createTimeout(long durationMs, int signal, long killAfterMs) {
+    struct jobTimeout *timeout;
+    int timerFd = moveHigh(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK));
+
+    if (timerFd == -1) {
+        return NULL;
+    }
+
+    timeout = MEM_CALLOC(MEM_JOBS, 1, sizeof(struct jobTimeout));
+    timeout->timerFd = timerFd;
+    timeout->signal = signal;
+    timeout->killAfterMs = killAfterMs;
+    armTimer(timerFd, durationMs);
+
+    return timeout;
+}
+
+/************************************************************************************
+ * Function to release the deadline of a job
+ *
+ * @param timeout: the deadline (or NULL)
+ ***********************************************************************************/
+void freeTimeout(struct jobTimeout *timeout) {
+    if (timeout != NULL) {
+        close(timeout->timerFd);
+        MEM_FREE(timeout);
+    }
+}
+
+/************************************************************************************
+ * Function to check if a deadline still has a signal to send
+ *
+ * @param timeout: the deadline (or NULL)
+ * @return: TRUE if the timer should be watched
+ ***********************************************************************************/
+int isTimerActive(struct jobTimeout *timeout) {
+    return timeout != NULL && !timeout->isKilled && !(timeout->isSignalled && timeout->killAfterMs == 0);
+}
+
+/************************************************************************************
+ * Function to act on a deadline whose timer has expired, sending its signal the first
+ * time and SIGKILL the second
+ *
+ * @param timeout: the deadline
+ * @param pid: process the deadline belongs to, which leads its job's process group
+ ***********************************************************************************/
+void expireTimeout(struct jobTimeout *timeout, pid_t pid) {
+    uint64_t expirations;
+
+    // the timer is non-blocking so a spurious wake up is ignored
+    if (read(timeout->timerFd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        return;
+    }
+
+    // every process of the job is signalled, and a job stopped by ^Z is continued so
+    // it sees the signal
+    if (!timeout->isSignalled) {
+        signalJob(pid, timeout->signal);
+        signalJob(pid, SIGCONT);
+        timeout->isSignalled = TRUE;
+        if (timeout->killAfterMs > 0) {
+            armTimer(timeout->timerFd, timeout->killAfterMs);
+        }
+    } else if (!timeout->isKilled) {
+        signalJob(pid, SIGKILL);
+        timeout->isKilled = TRUE;
+    }
+}
+
+/************************************************************************************
+ * Function to add the active timers of the background jobs to a poll list
+ *
+ * @param procList: linked list of outstanding processes
+ * @param fds: poll list to add to (TIMER_POLL_MAX entries)
+ * @param owners: loaded with the job of each added timer
+ * @param numFds: number of entries already in the list
+ * @return: number of entries in the list
+ ***********************************************************************************/
+int addJobTimers(struct processLinkedList *procList, struct pollfd *fds, struct processNode **owners, int numFds) {
+    struct processNode *cur;
+
+    for (cur = procList->head; cur != NULL && numFds < TIMER_POLL_MAX; cur = cur->next) {
+        if (isTimerActive(cur->timeout)) {
+            fds[numFds].fd = cur->timeout->timerFd;
+            fds[numFds].events = POLLIN;
+            fds[numFds].revents = 0;
+            owners[numFds++] = cur;
+        }
+    }
+
+    return numFds;
+}
+
+/************************************************************************************
+ * Function to act on the background job timers that expired during a poll
+ *
+ * @param fds: the polled list
+ * @param owners: job of each timer
+ * @param start: index of the first timer in the list
+ * @param numFds: number of entries in the list
+ ***********************************************************************************/
+void serviceJobTimers(struct pollfd *fds, struct processNode **owners, int start, int numFds) {
+    int i;
+
+    for (i = start; i < numFds; i++) {
+        if (fds[i].revents & POLLIN) {
+            expireTimeout(owners[i]->timeout, owners[i]->pid);
+        }
+    }
+}
+
+/************************************************************************************
+ * Function to wait for a foreground child to exit (without collecting it) or stop
+ * while servicing its deadline and those of the background jobs. The child is
+ * watched through a pidfd, or checked periodically if pidfds are not supported, and
+ * SIGCHLD is read from a signalfd to see it stop.
+ *
+ * @param pid: the foreground child
+ * @param timeout: deadline of the child (or NULL)
+ * @param procList: linked list of outstanding processes
+ * @return: TRUE if the child stopped, FALSE if it exited
+ ***********************************************************************************/
+int waitForeground(pid_t pid, struct jobTimeout *timeout, struct processLinkedList *procList) {
+    struct pollfd fds[TIMER_POLL_MAX];
+    struct processNode *owners[TIMER_POLL_MAX];
+    int pidFd = pidfdOpen(pid), numFds, result, isStopped = FALSE;
+    siginfo_t info;
+
+    while (1) {
+        // the child, its own deadline, its changes of state, then the background
+        // deadlines. A stop is checked for once the signals before it are cleared.
+        fds[0].fd = pidFd;
+        fds[1].fd = isTimerActive(timeout) ? timeout->timerFd : -1;
+        fds[2].fd = childSignalFd();
+        fds[0].events = fds[1].events = fds[2].events = POLLIN;
+        fds[0].revents = fds[1].revents = fds[2].revents = 0;
+        numFds = addJobTimers(procList, fds, owners, 3);
+        if (fds[2].fd != -1 && checkStopped(pid)) {
+            isStopped = TRUE;
+            break;
+        }
+
+        result = poll(fds, numFds, pidFd == -1 ? PIDFD_FALLBACK_POLL : -1);
+        if (result == -1 && errno != EINTR) {
+            break;
+        }
+
+        if (result > 0) {
+            if (fds[1].revents & POLLIN) {
+                expireTimeout(timeout, pid);
+            }
+            serviceJobTimers(fds, owners, 3, numFds);
+            if (fds[0].revents) {
+                break;
+            }
+        }
+
+        // without a pidfd check if the child has exited, leaving it to be collected
+        if (pidFd == -1) {
+            info.si_pid = 0;
+            if (waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == -1 || info.si_pid == pid) {
+                break;
+            }
+        }
+    }
+
+    if (pidFd != -1) {
+        close(pidFd);
+    }
+
+    return isStopped;
+}
+
+/************************************************************************************
+ * Function to wait until a line reader has input, servicing the deadlines of the
+ * background jobs in the meantime. A ^Z ends the wait so the foreground only mode can
+ * be toggled at once.
+ *
+ * @param reader: the reader the next line will be read from
+ * @param procList: linked list of outstanding processes
+ * @return: FALSE if the wait was interrupted to toggle the mode, TRUE otherwise
+ ***********************************************************************************/
+int waitForInput(struct lineReader *reader, struct processLinkedList *procList) {
+    struct pollfd fds[TIMER_POLL_MAX];
+    struct processNode *owners[TIMER_POLL_MAX];
+    int numFds, firstPrompt, numPrompt, firstTimer;
+
+    // buffered input can be read straight away
+    while (reader->start == reader->end && !reader->isEof) {
+        fds[0].fd = reader->fd;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+
+        // keep writing events to a slow reader while waiting
+        firstTimer = 1;
+        if (eventsPending()) {
+            fds[1].fd = eventsFd();
+            fds[1].events = POLLOUT;
+            fds[1].revents = 0;
+            firstTimer = 2;
+        }
+
+        // then the prompt's helper and inotify, which can redraw the prompt meanwhile
+        firstPrompt = firstTimer;
+        numPrompt = addPromptFds(fds, firstPrompt);
+        firstTimer += numPrompt;
+        numFds = addJobTimers(procList, fds, owners, firstTimer);
+
+        // with nothing else to service the read can block by itself
+        if (numFds == 1) {
+            return TRUE;
+        }
+
+        if (poll(fds, numFds, -1) == -1) {
+            if (errno == EINTR && !toggleFgMode) {
+                continue;
+            }
+            return errno != EINTR;
+        }
+
+        serviceJobTimers(fds, owners, firstTimer, numFds);
+        if (firstPrompt == 2 && fds[1].revents) {
+            flushEvents();
+        }
+        servicePromptFds(fds, firstPrompt, numPrompt);
+        if (fds[0].revents) {
+            return TRUE;
+        }
+    }
+
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to implement the timeout built in command. The command is run through the
+ * normal spawn path with a deadline, in the foreground or as a background job.
+ *
+ * @param cmd: the timeout command, its options, and the command to run
+ * @param procList: linked list of outstanding processes
+ * @param isForeOnlyMode: pointer to the foreground only flag
+ * @return: exit status of the command, TIMEOUT_EXIT_STATUS (or 128 + SIGKILL if it had
+ *          to be killed) if it timed out, or TIMEOUT_FAILED_STATUS on an error
+ ***********************************************************************************/
+int timeoutCommand(struct command *cmd, struct processLinkedList *procList, int *isForeOnlyMode) {
+    long durationMs = -1, killAfterMs = 0;
+    int argIdx = 1, signal = SIGTERM, isValid = TRUE;
+    char *resolved, text[128];
+    struct command target;
+    struct jobTimeout *timeout;
+    pid_t pid;
+
+    // read the options and the duration
+    while (argIdx < cmd->numArgs && isValid) {
+        if (strcmp(cmd->args[argIdx], "-k") == 0 && argIdx + 1 < cmd->numArgs) {
+            isValid = parseDuration(cmd->args[argIdx + 1], &killAfterMs);
+            argIdx += 2;
+        } else if (strcmp(cmd->args[argIdx], "-s") == 0 && argIdx + 1 < cmd->numArgs) {
+            isValid = (signal = parseSignal(cmd->args[argIdx + 1])) != -1;
+            argIdx += 2;
+        } else if (durationMs == -1) {
+            isValid = parseDuration(cmd->args[argIdx], &durationMs);
+            argIdx++;
+        } else {
+            break;
+        }
+    }
+
+    if (!isValid || durationMs == -1 || argIdx >= cmd->numArgs) {
+        queueConstant("usage: timeout [-s signal] [-k kill_after] duration command args...\n");
+        return TIMEOUT_FAILED_STATUS;
+    }
+
+    // the command to run is the rest of the arguments with timeout's redirections
+    target = *cmd;
+    target.args = cmd->args + argIdx;
+    target.numArgs = cmd->numArgs - argIdx;
+    target.next = NULL;
+    resolved = resolveCommand(target.args[0]);
+
+    if ((timeout = createTimeout(durationMs, signal, killAfterMs)) == NULL) {
+        queueConstant("timeout: cannot create timer\n");
+        return TIMEOUT_FAILED_STATUS;
+    }
+
+    // a background job keeps its deadline in the process list
+    if (cmd->isBgProcess) {
+        if ((pid = spawnCommand(&target, resolved, BACKGROUND | CHILD)) < 0) {
+            freeTimeout(timeout);
+            return TIMEOUT_FAILED_STATUS;
+        }
+        addProcess(procList, pid);
+        procList->tail->timeout = timeout;
+        setProcessCommand(procList->tail, &target);
+        saveJobState(procList);
+        metricsJobStarted(pid, &target, JOB_BACKGROUND);
+        eventJobStarted(pid, &target, TRUE);
+        queueConstant("background pid is ");
+        queueInt(pid);
+        queueConstant("\n");
+        return 0;
+    }
+
+    if ((pid = spawnCommand(&target, resolved, FOREGROUND | CHILD)) < 0) {
+        freeTimeout(timeout);
+        return TIMEOUT_FAILED_STATUS;
+    }
+    metricsJobStarted(pid, &target, JOB_FOREGROUND);
+    eventJobStarted(pid, &target, FALSE);
+
+    // a command stopped by ^Z keeps its deadline as a background job
+    if (waitForeground(pid, timeout, procList)) {
+        stopJob(procList, pid, pid, &target, FALSE)->timeout = timeout;
+        reclaimTerminal();
+        if (toggleFgMode) {
+            applyFgOnlyToggle(isForeOnlyMode);
+        }
+        return lastExitStatus;
+    }
+    while (clearFinished(pid, timeout->isSignalled) == -1);
+    reclaimTerminal();
+
+    // a command that timed out reports it along with how it finished
+    if (timeout->isSignalled) {
+        snprintf(text, sizeof(text), "timed out, %s", getShellVar(STATUS));
+        setShellVar(STATUS, text);
+        queueString(text);
+        lastExitStatus = timeout->isKilled ? 128 + SIGKILL : TIMEOUT_EXIT_STATUS;
+        metricsSetStatus(lastExitStatus, text);
+    }
+
+    if (toggleFgMode) {
+        applyFgOnlyToggle(isForeOnlyMode);
+    }
+
+    freeTimeout(timeout);
+    return lastExitStatus;
+}
@@ -0,0 +1,50 @@
+/************************************************************************************
+ * This file defines functions related to the timeout built in command, which runs a
+ * command with a deadline kept by a timerfd in the shell itself
+ *
+ * usage: timeout [-s signal] [-k kill_after] duration command args...
+ *
+ * Durations are a number with an optional unit of ms, s (the default), m, h or d.
+ * Foreground commands are waited for by polling a pidfd alongside the timers, and
+ * the timers of background commands are serviced while the shell waits for input
+ * or for a foreground command.
+ ***********************************************************************************/
+#ifndef CS344_TIMEOUT_H
+#define CS344_TIMEOUT_H
+
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+
+#include "CommandParser.h"
+#include "CommandDelegator.h"
+
+#define TIMEOUT_EXIT_STATUS 124   // exit status of a command that timed out
+#define TIMEOUT_FAILED_STATUS 125 // exit status if timeout itself failed
+#define TIMER_POLL_MAX 128        // most file descriptors watched at once
+#define PIDFD_FALLBACK_POLL 10    // ms between checks for an exited child without pidfds
+
+// structure holding the deadline of a job
+struct jobTimeout {
+    int timerFd;
+    int signal;          // signal sent when the deadline passes
+    long killAfterMs;    // delay before sending SIGKILL after the signal (0 for never)
+    int isSignalled;     // set once the signal has been sent
+    int isKilled;        // set once SIGKILL has been sent
+};
+
+int parseDuration(char *text, long *ms);
+int parseSignal(char *text);
+struct jobTimeout *createTimeout(long durationMs, int signal, long killAfterMs);
+void freeTimeout(struct jobTimeout *timeout);
+int isTimerActive(struct jobTimeout *timeout);
+void expireTimeout(struct jobTimeout *timeout, pid_t pid);
+int addJobTimers(struct processLinkedList *procList, struct pollfd *fds, struct processNode **owners, int numFds);
+void serviceJobTimers(struct pollfd *fds, struct processNode **owners, int start, int numFds);
+int waitForeground(pid_t pid, struct jobTimeout *timeout, struct processLinkedList *procList);
+int waitForInput(struct lineReader *reader, struct processLinkedList *procList);
+int timeoutCommand(struct command *cmd, struct processLinkedList *procList, int *isForeOnlyMode);
+
+#endif //CS344_TIMEOUT_H
@@ -6,4 +6,159 @@ void flushBuffer() {
     while((c = getchar()) != '\n' && c != EOF);
 }
 
+/************************************************************************************
+ * Function to read the monotonic clock (unaffected by changes to the wall clock)
+ *
+ * @return: current monotonic time in nanoseconds
+ ***********************************************************************************/
+long long monotonicNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/************************************************************************************
+ * Function to calculate the number of milliseconds passed since a previous reading
+ * of the monotonic clock
+ *
+ * @param startNs: earlier result of monotonicNs
+ * @return: milliseconds elapsed since startNs
+ ***********************************************************************************/
+long long elapsedMs(long long startNs) {
+    return (monotonicNs() - startNs) / 1000000LL;
+}
+
+/************************************************************************************
+ * Function to sleep for a number of milliseconds, resuming the sleep if a signal
+ * interrupts it
+ *
+ * @param ms: number of milliseconds to sleep
+ ***********************************************************************************/
+void sleepMs(long ms) {
+    struct timespec req, rem;
+    req.tv_sec = ms / 1000;
+    req.tv_nsec = (ms % 1000) * 1000000L;
+
+    while (nanosleep(&req, &rem) == -1) {
+        req = rem;
+    }
+}
+
+/************************************************************************************
+ * Function to hash a block of bytes (64 bit FNV-1a)
+ *
+ * @param data: bytes to hash
+ * @param len: number of bytes to hash
+ * @return: the hash value
+ ***********************************************************************************/
+uint64_t hashBytes(const char *data, size_t len) {
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= (unsigned char) data[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/************************************************************************************
+ * Function to prepare a line reader for reading from a file descriptor
+ *
+ * @param reader: reader to initialize
+ * @param fd: file descriptor to read from
+ ***********************************************************************************/
+void initLineReader(struct lineReader *reader, int fd) {
+    reader->fd = fd;
+    reader->start = 0;
+    reader->end = 0;
+    reader->isEof = 0;
+}
+
+/************************************************************************************
+ * Function to read the next line from a line reader. The newline is not stored and
+ * lines longer than the destination are truncated.
+ *
+ * @param reader: reader to take the line from
+ * @param dest: character array to load with the line
+ * @param maxLen: size of dest
+ * @return: length of the line, -1 if the end of input has been reached, or
+ *          READ_INTERRUPTED if a signal interrupted the read before a line started
+ ***********************************************************************************/
+int readLine(struct lineReader *reader, char *dest, int maxLen) {
+    int len = 0, foundLine = 0, numRead;
 
+    while (!foundLine) {
+        // if the buffer is used up refill it from the file descriptor
+        if (reader->start == reader->end) {
+            if (reader->isEof) {
+                break;
+            }
+
+            // the caller is told about a signal so it can act on it (a partial line is
+            // finished first)
+            numRead = read(reader->fd, reader->buf, READER_BUF_SIZE);
+            if (numRead == -1 && errno == EINTR && len == 0) {
+                dest[0] = 0;
+                return READ_INTERRUPTED;
+            } else if (numRead == -1 && errno == EINTR) {
+                continue;
+            } else if (numRead <= 0) {
+                reader->isEof = 1;
+                break;
+            }
+            reader->start = 0;
+            reader->end = numRead;
+        }
+
+        // copy characters into dest until the end of the line or the buffer
+        while (reader->start < reader->end) {
+            char c = reader->buf[reader->start++];
+            if (c == '\n') {
+                foundLine = 1;
+                break;
+            } else if (len < maxLen - 1) {
+                dest[len++] = c;
+            }
+        }
+    }
+
+    dest[len] = 0;
+
+    // a missing final newline still counts as a line
+    if (!foundLine && len == 0) {
+        return -1;
+    }
+
+    return len;
+}
+
+/************************************************************************************
+ * Function to get a file descriptor that becomes readable when a child exits
+ *
+ * @param pid: process id of the child
+ * @return: the pidfd or -1 if they are not supported
+ ***********************************************************************************/
+int pidfdOpen(pid_t pid) {
+    return syscall(SYS_pidfd_open, pid, 0);
+}
+
+/************************************************************************************
+ * Function to move a file descriptor used by the shell above the range used by
+ * redirections, so applying a redirection can not replace it
+ *
+ * @param fd: file descriptor to move
+ * @return: the moved file descriptor (close on exec) or -1 if it could not be moved
+ ***********************************************************************************/
+int moveHigh(int fd) {
+    int moved;
+
+    if (fd < 0 || fd >= SHELL_MIN_FD) {
+        return fd;
+    }
+
+    moved = fcntl(fd, F_DUPFD_CLOEXEC, SHELL_MIN_FD);
+    close(fd);
+    return moved;
+}
@@ -7,7 +7,42 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <time.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+#define READER_BUF_SIZE 4096
+#define READ_INTERRUPTED -2  // readLine was interrupted by a signal before a line started
+
+// lowest file descriptor used for the shell's own long lived files. 0 to 9 are left to
+// redirections, including those made permanent with exec.
+#define SHELL_MIN_FD 10
+
+// structure to buffer raw input from a file descriptor so it can be read a line at a time
+struct lineReader {
+    int fd;
+    char buf[READER_BUF_SIZE];
+    int start;
+    int end;
+    int isEof;
+};
 
 void flushBuffer();
+long long monotonicNs();
+long long elapsedMs(long long startNs);
+void sleepMs(long ms);
+uint64_t hashBytes(const char *data, size_t len);
+void initLineReader(struct lineReader *reader, int fd);
+int readLine(struct lineReader *reader, char *dest, int maxLen);
+int pidfdOpen(pid_t pid);
+int moveHigh(int fd);
 
 #endif //CS344_UTILS_H
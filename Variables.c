@@ -0,0 +1,267 @@
+#include "Variables.h"
+
+// table of variable names to the values of the shell variables that are not exported
+static struct hashTable *shellVars = NULL;
+
+// cached envp block of the exported variables and whether an export has changed it
+static char **envBlock = NULL;
+static int numEnv = 0;
+static int isEnvStale = TRUE;
+
+/************************************************************************************
+ * Function to check if a name is a valid variable name: letters, digits and
+ * underscores, not starting with a digit
+ *
+ * @param name: the name
+ * @param len: length of the name
+ * @return: TRUE if the name is valid
+ ***********************************************************************************/
+int isValidName(const char *name, size_t len) {
+    size_t i;
+
+    if (len == 0 || isdigit((unsigned char) name[0])) {
+        return FALSE;
+    }
+    for (i = 0; i < len; i++) {
+        if (!isalnum((unsigned char) name[i]) && name[i] != '_') {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to check if a word is a variable assignment (NAME=value)
+ *
+ * @param word: the word
+ * @return: TRUE if the word is an assignment
+ ***********************************************************************************/
+int isAssignment(const char *word) {
+    const char *equals = strchr(word, '=');
+
+    return equals != NULL && isValidName(word, equals - word);
+}
+
+/************************************************************************************
+ * Function to set a shell variable, which is not passed to commands
+ *
+ * @param name: name of the variable
+ * @param value: value of the variable (copied)
+ ***********************************************************************************/
+void setShellVar(const char *name, const char *value) {
+    char *copy = MEM_CALLOC(MEM_VARIABLES, strlen(value) + 1, sizeof(char));
+
+    if (shellVars == NULL) {
+        shellVars = createTable(DEFAULT_BUCKETS);
+    }
+    strcpy(copy, value);
+    MEM_FREE(tablePut(shellVars, name, copy));
+}
+
+/************************************************************************************
+ * Function to get the value of a variable, looking at the shell variables before
+ * the environment
+ *
+ * @param name: name of the variable
+ * @return: the value or NULL if the variable is not set
+ ***********************************************************************************/
+char *getShellVar(const char *name) {
+    char *value = shellVars != NULL ? tableGet(shellVars, name) : NULL;
+
+    return value != NULL ? value : getenv(name);
+}
+
+/************************************************************************************
+ * Function to export a variable, moving it from the shell variables if it is one
+ *
+ * @param name: name of the variable
+ * @param value: value of the variable (NULL to export the shell variable's value)
+ ***********************************************************************************/
+void exportVar(const char *name, const char *value) {
+    char *shellValue = shellVars != NULL ? tableRemove(shellVars, name) : NULL;
+
+    if (value == NULL) {
+        value = shellValue;
+    }
+    if (value != NULL) {
+        setenv(name, value, 1);
+        isEnvStale = TRUE;
+    }
+    MEM_FREE(shellValue);
+}
+
+/************************************************************************************
+ * Function to get the envp block of the exported variables for exec. The block is
+ * only rebuilt after an export, and its strings are those of the environment, which
+ * setenv leaves in place when a variable is replaced.
+ *
+ * @return: NULL terminated array of NAME=value strings
+ ***********************************************************************************/
+char **execEnv() {
+    if (isEnvStale) {
+        for (numEnv = 0; environ[numEnv] != NULL; numEnv++);
+        MEM_FREE(envBlock);
+        envBlock = MEM_CALLOC(MEM_VARIABLES, numEnv + 1, sizeof(char *));
+        memcpy(envBlock, environ, numEnv * sizeof(char *));
+        isEnvStale = FALSE;
+    }
+
+    return envBlock;
+}
+
+/************************************************************************************
+ * Function to get the envp block for a command, adding the assignments given before
+ * its name to a copy of the exported variables. The copy is only made in the child
+ * about to exec the command, so it is never freed and the shell is left untouched.
+ *
+ * @param cmd: the command
+ * @return: NULL terminated array of NAME=value strings
+ ***********************************************************************************/
+char **commandEnv(struct command *cmd) {
+    char **base = execEnv(), **envp;
+    int i, j, num = numEnv;
+    size_t nameLen;
+
+    if (cmd->numAssigns == 0) {
+        return base;
+    }
+
+    envp = MEM_CALLOC(MEM_VARIABLES, numEnv + cmd->numAssigns + 1, sizeof(char *));
+    memcpy(envp, base, numEnv * sizeof(char *));
+
+    // each assignment replaces the exported variable of the same name or is added
+    for (i = 0; i < cmd->numAssigns; i++) {
+        nameLen = strchr(cmd->assigns[i], '=') - cmd->assigns[i] + 1;
+        for (j = 0; j < num && strncmp(envp[j], cmd->assigns[i], nameLen) != 0; j++);
+        envp[j] = cmd->assigns[i];
+        if (j == num) {
+            num++;
+        }
+    }
+
+    return envp;
+}
+
+/************************************************************************************
+ * Function to check if a command assigns a variable before its name
+ *
+ * @param cmd: the command
+ * @param name: name of the variable
+ * @return: TRUE if the variable is assigned
+ ***********************************************************************************/
+int assignsVar(struct command *cmd, const char *name) {
+    size_t len = strlen(name);
+    int i;
+
+    for (i = 0; i < cmd->numAssigns; i++) {
+        if (strncmp(cmd->assigns[i], name, len) == 0 && cmd->assigns[i][len] == '=') {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/************************************************************************************
+ * Function to execute a command in the current (child) process with its environment.
+ * Only returns if the command could not be executed.
+ *
+ * @param cmd: the command
+ * @param resolved: full path of the command from resolveCommand (or NULL)
+ ***********************************************************************************/
+void execCommand(struct command *cmd, char *resolved) {
+    char **envp = commandEnv(cmd);
+
+    // a PATH given for the command is searched instead of the shell's
+    if (assignsVar(cmd, "PATH")) {
+        resolved = NULL;
+        environ = envp;
+    }
+
+    execResolved(resolved, cmd->args, envp);
+}
+
+/************************************************************************************
+ * Function to implement the assignment of shell variables (NAME=value ...). A
+ * variable that is already exported stays exported with the new value.
+ *
+ * @param cmd: command whose args are the assignments
+ * @return: exit status of the command
+ ***********************************************************************************/
+int assignCommand(struct command *cmd) {
+    char *equals;
+    int i, status = 0;
+
+    for (i = 0; i < cmd->numArgs; i++) {
+        if (!isAssignment(cmd->args[i])) {
+            queueFormat("%s: not a valid assignment\n", cmd->args[i]);
+            status = 1;
+            continue;
+        }
+
+        // split the word at the = to get the name
+        equals = strchr(cmd->args[i], '=');
+        *equals = '\0';
+        if (getenv(cmd->args[i]) != NULL) {
+            exportVar(cmd->args[i], equals + 1);
+        } else {
+            setShellVar(cmd->args[i], equals + 1);
+        }
+        *equals = '=';
+    }
+
+    return status;
+}
+
+/************************************************************************************
+ * Function to implement the export built in command
+ *
+ * usage: export [NAME[=value]...]
+ *
+ * @param cmd: the export command
+ * @return: exit status of the command
+ ***********************************************************************************/
+int exportCommand(struct command *cmd) {
+    char **envp, *equals;
+    int i, status = 0;
+
+    // without names list the exported variables
+    if (cmd->numArgs == 1) {
+        for (envp = execEnv(); *envp != NULL; envp++) {
+            queueConstant("export ");
+            queueString(*envp);
+            queueConstant("\n");
+        }
+        return 0;
+    }
+
+    for (i = 1; i < cmd->numArgs; i++) {
+        equals = strchr(cmd->args[i], '=');
+        if (!isValidName(cmd->args[i], equals != NULL ? (size_t) (equals - cmd->args[i]) : strlen(cmd->args[i]))) {
+            queueFormat("export: %s: not a valid identifier\n", cmd->args[i]);
+            status = 1;
+        } else if (equals != NULL) {
+            *equals = '\0';
+            exportVar(cmd->args[i], equals + 1);
+            *equals = '=';
+        } else {
+            exportVar(cmd->args[i], NULL);
+        }
+    }
+
+    return status;
+}
+
+/************************************************************************************
+ * Function to free the shell variables and the cached envp block
+ ***********************************************************************************/
+void freeVariables() {
+    if (shellVars != NULL) {
+        freeTable(shellVars, MEM_FREE);
+        shellVars = NULL;
+    }
+    MEM_FREE(envBlock);
+    envBlock = NULL;
+    isEnvStale = TRUE;
+}
@@ -0,0 +1,41 @@
+/************************************************************************************
+ * This file defines functions related to shell variables and the environment passed
+ * to commands. Shell variables (the shell's pid, the last status, and any the user
+ * assigns without exporting) are kept in a hash table and never reach children. Only
+ * exported variables are in the environment, and the envp block handed to exec is a
+ * cached copy of it, rebuilt only when an export changes.
+ *
+ *   NAME=value ...         sets shell variables (or updates exported ones)
+ *   export [NAME[=value]]  exports variables, or lists the exported ones
+ *   NAME=value cmd args    runs cmd with NAME=value added to its environment only
+ ***********************************************************************************/
+#ifndef CS344_VARIABLES_H
+#define CS344_VARIABLES_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#include "CommandParser.h"
+#include "HashTable.h"
+#include "PathCache.h"
+#include "Output.h"
+
+extern char **environ;
+
+int isValidName(const char *name, size_t len);
+int isAssignment(const char *word);
+void setShellVar(const char *name, const char *value);
+char *getShellVar(const char *name);
+void exportVar(const char *name, const char *value);
+char **execEnv();
+char **commandEnv(struct command *cmd);
+int assignsVar(struct command *cmd, const char *name);
+void execCommand(struct command *cmd, char *resolved);
+int assignCommand(struct command *cmd);
+int exportCommand(struct command *cmd);
+void freeVariables();
+
+#endif //CS344_VARIABLES_H
@@ -0,0 +1,278 @@
+#include "Watch.h"
+#include "Timeout.h"
+#include "Events.h"
+#include "JobControl.h"
+
+/************************************************************************************
+ * Function to watch a path, and everything under it if it is a directory. Symbolic
+ * links inside a watched directory are not followed.
+ *
+ * @param set: the watches
+ * @param path: path to watch
+ * @return: FALSE if the path itself could not be watched
+ ***********************************************************************************/
+int addWatchTree(struct watchSet *set, const char *path) {
+    char child[PATH_MAX];
+    struct dirent *entry;
+    struct stat st;
+    DIR *dir;
+    int wd;
+
+    if ((wd = inotify_add_watch(set->notifyFd, path, WATCH_MASK)) == -1) {
+        return FALSE;
+    }
+
+    // keep the path of each new watch so directories created later can be found
+    if (set->numWatches == set->capacity) {
+        set->capacity = set->capacity ? set->capacity * 2 : 16;
+        set->wds = MEM_REALLOC(MEM_WATCH, set->wds, set->capacity * sizeof(int));
+        set->paths = MEM_REALLOC(MEM_WATCH, set->paths, set->capacity * sizeof(char *));
+    }
+    set->wds[set->numWatches] = wd;
+    set->paths[set->numWatches] = MEM_CALLOC(MEM_WATCH, strlen(path) + 1, sizeof(char));
+    strcpy(set->paths[set->numWatches++], path);
+
+    if (stat(path, &st) == -1 || !S_ISDIR(st.st_mode) || (dir = opendir(path)) == NULL) {
+        return TRUE;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        snprintf(child, PATH_MAX, "%s/%s", path, entry->d_name);
+        if (entry->d_type == DT_DIR ||
+            (entry->d_type == DT_UNKNOWN && lstat(child, &st) == 0 && S_ISDIR(st.st_mode))) {
+            addWatchTree(set, child);
+        }
+    }
+    closedir(dir);
+
+    return TRUE;
+}
+
+/************************************************************************************
+ * Function to read the changes inotify has queued, watching any directories that
+ * were created
+ *
+ * @param set: the watches
+ * @return: TRUE if anything watched changed
+ ***********************************************************************************/
+int readChanges(struct watchSet *set) {
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    char path[PATH_MAX];
+    struct inotify_event *event;
+    ssize_t numRead, pos;
+    int i, isChanged = FALSE;
+
+    while ((numRead = read(set->notifyFd, events, sizeof(events))) > 0) {
+        for (pos = 0; pos < numRead; pos += sizeof(struct inotify_event) + event->len) {
+            event = (struct inotify_event *) (events + pos);
+            if (event->mask & (IN_IGNORED | IN_Q_OVERFLOW)) {
+                isChanged = isChanged || (event->mask & IN_Q_OVERFLOW);
+                continue;
+            }
+            isChanged = TRUE;
+
+            // a new directory is watched along with anything already made inside it
+            if ((event->mask & (IN_CREATE | IN_MOVED_TO)) && (event->mask & IN_ISDIR)) {
+                for (i = 0; i < set->numWatches && set->wds[i] != event->wd; i++);
+                if (i < set->numWatches) {
+                    snprintf(path, PATH_MAX, "%s/%s", set->paths[i], event->name);
+                    addWatchTree(set, path);
+                }
+            }
+        }
+    }
+
+    return isChanged;
+}
+
+/************************************************************************************
+ * Function to free the watches
+ *
+ * @param set: the watches
+ ***********************************************************************************/
+void freeWatchSet(struct watchSet *set) {
+    int i;
+
+    if (set->notifyFd != -1) {
+        close(set->notifyFd);
+    }
+    for (i = 0; i < set->numWatches; i++) {
+        MEM_FREE(set->paths[i]);
+    }
+    MEM_FREE(set->paths);
+    MEM_FREE(set->wds);
+}
+
+/************************************************************************************
+ * Function to start a run of the watched command
+ *
+ * @param target: the command
+ * @param pidFd: loaded with a pidfd of the run (-1 if there is none)
+ * @return: pid of the run or -1 if it could not be started
+ ***********************************************************************************/
+static pid_t startRun(struct command *target, int *pidFd) {
+    // the run is a job of its own but the shell keeps the terminal, so ^C reaches it
+    pid_t pid = spawnCommand(target, resolveCommand(target->args[0]), BACKGROUND | CHILD);
+
+    *pidFd = -1;
+    if (pid > 0) {
+        metricsJobStarted(pid, target, JOB_FOREGROUND);
+        eventJobStarted(pid, target, FALSE);
+        *pidFd = moveHigh(pidfdOpen(pid));
+    }
+
+    return pid;
+}
+
+/************************************************************************************
+ * Function to check if a run has finished without collecting it, for when there is
+ * no pidfd to poll
+ *
+ * @param pid: pid of the run
+ * @return: TRUE if the run has finished
+ ***********************************************************************************/
+static int isRunFinished(pid_t pid) {
+    siginfo_t info;
+
+    info.si_pid = 0;
+    return waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == -1 || info.si_pid == pid;
+}
+
+/************************************************************************************
+ * Function to implement the watch built in command
+ *
+ * @param cmd: the watch command, its options and paths, and the command to run
+ * @param procList: linked list of outstanding processes
+ * @param isForeOnlyMode: pointer to the foreground only flag
+ * @return: exit status of the last run of the command, or WATCH_FAILED_STATUS
+ ***********************************************************************************/
+int watchCommand(struct command *cmd, struct processLinkedList *procList, int *isForeOnlyMode) {
+    struct watchSet set = {-1, 0, 0, NULL, NULL};
+    struct pollfd fds[TIMER_POLL_MAX];
+    struct processNode *owners[TIMER_POLL_MAX];
+    struct itimerspec debounce = {{0, 0}, {0, 0}};
+    struct signalfd_siginfo info;
+    struct command target;
+    sigset_t interrupt, savedMask;
+    long debounceMs = DEFAULT_DEBOUNCE;
+    int i, argIdx = 1, timerFd, signalFd, pidFd = -1, numFds, isWatching = TRUE, isDue = FALSE;
+    int isCancelled = FALSE;
+    pid_t pid;
+    uint64_t expirations;
+    char *end;
+
+    // read the options and the paths up to the command
+    if (argIdx + 1 < cmd->numArgs && strcmp(cmd->args[argIdx], "-d") == 0) {
+        debounceMs = strtol(cmd->args[argIdx + 1], &end, 10);
+        argIdx = *end == '\0' && debounceMs >= 0 ? argIdx + 2 : cmd->numArgs;
+    }
+    for (i = argIdx; i < cmd->numArgs && strcmp(cmd->args[i], "--") != 0; i++);
+    if (i == argIdx || i + 1 >= cmd->numArgs) {
+        queueConstant("usage: watch [-d ms] paths... -- command args...\n");
+        return WATCH_FAILED_STATUS;
+    }
+    if (cmd->procSubs != NULL) {
+        queueConstant("watch: process substitutions are not supported\n");
+        return WATCH_FAILED_STATUS;
+    }
+
+    if ((set.notifyFd = moveHigh(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))) == -1) {
+        queueConstant("watch: cannot create inotify instance\n");
+        return WATCH_FAILED_STATUS;
+    }
+    for (; argIdx < i; argIdx++) {
+        if (!addWatchTree(&set, cmd->args[argIdx])) {
+            queueFormat("watch: cannot watch %s\n", cmd->args[argIdx]);
+            freeWatchSet(&set);
+            return WATCH_FAILED_STATUS;
+        }
+    }
+
+    // the command to run is the rest of the arguments with watch's redirections
+    target = *cmd;
+    target.args = cmd->args + i + 1;
+    target.numArgs = cmd->numArgs - i - 1;
+    target.next = NULL;
+
+    // SIGINT is blocked so it can be read from a signalfd (children unblock it)
+    sigemptyset(&interrupt);
+    sigaddset(&interrupt, SIGINT);
+    sigprocmask(SIG_BLOCK, &interrupt, &savedMask);
+    signalFd = moveHigh(signalfd(-1, &interrupt, SFD_NONBLOCK | SFD_CLOEXEC));
+    timerFd = moveHigh(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC));
+
+    // run once to start with, then after each change
+    pid = startRun(&target, &pidFd);
+    while (isWatching) {
+        fds[0].fd = set.notifyFd;
+        fds[1].fd = timerFd;
+        fds[2].fd = signalFd;
+        fds[3].fd = pid > 0 ? pidFd : -1;
+        for (i = 0; i < 4; i++) {
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+        numFds = addJobTimers(procList, fds, owners, 4);
+
+        // without a pidfd the run is checked for now and then, otherwise poll sleeps
+        if (poll(fds, numFds, pid > 0 && pidFd == -1 ? PIDFD_FALLBACK_POLL : -1) == -1 && errno != EINTR) {
+            break;
+        }
+        serviceJobTimers(fds, owners, 4, numFds);
+
+        // ^C stops watching, and is passed on to the run
+        if (fds[2].revents && read(signalFd, &info, sizeof(info)) > 0) {
+            isWatching = FALSE;
+            if (pid > 0) {
+                signalJob(pid, SIGINT);
+            }
+        }
+
+        // a change cancels the run in flight and restarts the debounce delay
+        if (fds[0].revents && readChanges(&set)) {
+            if (pid > 0 && !isCancelled) {
+                signalJob(pid, SIGTERM);
+                isCancelled = TRUE;
+            }
+            debounce.it_value.tv_sec = debounceMs / 1000;
+            debounce.it_value.tv_nsec = (debounceMs % 1000) * 1000000 + (debounceMs == 0);
+            timerfd_settime(timerFd, 0, &debounce, NULL);
+        }
+        if (fds[1].revents && read(timerFd, &expirations, sizeof(expirations)) > 0) {
+            isDue = TRUE;
+        }
+
+        // collect the run once it has finished, only reporting runs that were not cancelled
+        if (pid > 0 && (fds[3].revents || (pidFd == -1 && isRunFinished(pid)) || !isWatching)) {
+            while (clearFinished(pid, isCancelled || !isWatching) == -1);
+            if (pidFd != -1) {
+                close(pidFd);
+            }
+            pid = -1;
+            flushOutput();
+        }
+
+        // start the next run once the changes have settled and the last run is done
+        if (isDue && pid <= 0 && isWatching) {
+            isDue = FALSE;
+            isCancelled = FALSE;
+            pid = startRun(&target, &pidFd);
+        }
+    }
+
+    close(signalFd);
+    close(timerFd);
+    freeWatchSet(&set);
+
+    // SIGINT goes back to being handled by the shell
+    sigprocmask(SIG_SETMASK, &savedMask, NULL);
+
+    if (toggleFgMode) {
+        applyFgOnlyToggle(isForeOnlyMode);
+    }
+
+    return lastExitStatus;
+}
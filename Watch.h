@@ -0,0 +1,50 @@
+/************************************************************************************
+ * This file defines functions related to the watch built in command, which runs a
+ * command again each time the files it depends on change
+ *
+ * usage: watch [-d ms] paths... -- command args...
+ *
+ * Directories are watched recursively with inotify, including those created while
+ * watching. Changes are collected until none have arrived for the debounce delay
+ * (100ms by default), then the command is run through the normal spawn path. A run
+ * still going when more changes arrive is stopped with SIGTERM so its results are
+ * not mistaken for those of the new files. Between runs the shell sleeps in poll, so
+ * watching costs nothing while nothing changes. SIGINT (^C) stops watching.
+ ***********************************************************************************/
+#ifndef CS344_WATCH_H
+#define CS344_WATCH_H
+
+#include <poll.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+
+#include "CommandParser.h"
+#include "CommandDelegator.h"
+
+#define DEFAULT_DEBOUNCE 100  // ms without changes before the command is run
+#define WATCH_FAILED_STATUS 2 // exit status if watch itself failed
+
+// changes to a watched path that cause the command to be run again
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+                    IN_DELETE_SELF | IN_MOVE_SELF)
+
+// structure holding the watches added and the paths they are of
+struct watchSet {
+    int notifyFd;
+    int numWatches;
+    int capacity;
+    int *wds;
+    char **paths;
+};
+
+int addWatchTree(struct watchSet *set, const char *path);
+int readChanges(struct watchSet *set);
+void freeWatchSet(struct watchSet *set);
+int watchCommand(struct command *cmd, struct processLinkedList *procList, int *isForeOnlyMode);
+
+#endif //CS344_WATCH_H
@@ -1,16 +1,85 @@
 #include "InterruptHandlers.h"
 #include "CommandParser.h"
 #include "CommandDelegator.h"
+#include "ScriptCache.h"
+#include "CommandServer.h"
+#include "Replay.h"
+#include "Timeout.h"
+#include "JobState.h"
+#include "Events.h"
+#include "Variables.h"
+#include "JobControl.h"
 
 extern volatile sig_atomic_t toggleFgMode;
 
 void startShell();
 void initParentProc(pid_t pid);
 
-int main() {
+int main(int argc, char **argv) {
+    char *servePath = NULL, *scriptPath = NULL, *replayPath = NULL;
+    double speed = DEFAULT_REPLAY_SPEED;
+    int i, concurrency = DEFAULT_REPLAY_CONCURRENCY;
+
     // perform initialisation required for parent process
     initParentProc(getpid());
 
+    // read the command line options, the first other argument is a script to run
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            servePath = argv[++i];
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            if (!openMetrics(argv[++i])) {
+                queueFormat("cannot open %s for metrics\n", argv[i]);
+            }
+        } else if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+            if (!openEvents(argv[++i])) {
+                queueFormat("cannot open %s for events\n", argv[i]);
+            }
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            if (!openRecord(argv[++i])) {
+                queueFormat("cannot open %s for output\n", argv[i]);
+            }
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = strtod(argv[++i], NULL);  // the x of "2x" is optional
+        } else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) {
+            concurrency = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--subreaper") == 0) {
+            if (!enableSubreaper()) {
+                queueConstant("cannot become a subreaper\n");
+            }
+        } else if (scriptPath == NULL) {
+            scriptPath = argv[i];
+        }
+    }
+
+    flushOutput();
+
+    // replay a recorded session as a load generator if asked to
+    if (replayPath != NULL) {
+        i = replay(replayPath, speed, concurrency);
+        flushOutput();
+        return i;
+    }
+
+    // run as a command server if asked to
+    if (servePath != NULL) {
+        serve(servePath);
+        return 1;
+    }
+
+    // give every job a process group of its own, and the terminal in the foreground
+    initJobControl();
+
+    // if a script was given run it, otherwise start the interactive shell
+    if (scriptPath != NULL) {
+        struct processLinkedList *procList = MEM_CALLOC(MEM_JOBS, 1, sizeof(struct processLinkedList));
+        showPrompt = FALSE;
+        runScript(scriptPath, procList);
+        exitProgram(procList, NULL);
+    }
+
     // start the shell
     startShell();
 
@@ -22,18 +91,25 @@ int main() {
  ***********************************************************************************/
 void startShell() {
     int isForeOnlyMode = 0;
-    int run = 1;  // var to use to generate infinite loop
 
     // variables to store command line raw input and arguments
     char *input;
-    char *args[512];
+    char *args[MAX_ARGS];
+    char line[INPUT_LENGTH];  // unmodified copy of the input for the recording
+    long long startNs;
+    int length;
+    struct lineReader reader;
 
     // create the linked list to hold outstanding child processes
-    struct processLinkedList *procList = calloc(1, sizeof(struct processLinkedList));
+    struct processLinkedList *procList = MEM_CALLOC(MEM_JOBS, 1, sizeof(struct processLinkedList));
 
+    // save the job table for later shells, adopting the jobs of shells that died
+    openJobState(procList);
+
+    initLineReader(&reader, STDIN_FILENO);
     printPrompt();
 
-    while (run) {
+    while (1) {
         // check if FG-only mode should be toggled and toggle it if so
         if (toggleFgMode) {
             applyFgOnlyToggle(&isForeOnlyMode);
@@ -41,80 +117,43 @@ void startShell() {
         }
 
         // allocate memory for input and initialize args to null pointers
-        input = calloc(2048, sizeof(char));
-        memset(args, 0, 512 * sizeof(char *));
-
-
+        input = MEM_CALLOC(MEM_INPUT, INPUT_LENGTH, sizeof(char));
+        memset(args, 0, MAX_ARGS * sizeof(char *));
+
+        // write the queued notices and prompt in one go before waiting for input
+        flushOutput();
+
+        // read the next line, exiting as if by the exit command once input runs out. A
+        // signal interrupting the wait goes back to the top to act on a ^Z at once.
+        if (!waitForInput(&reader, procList) ||
+            (length = readLine(&reader, input, INPUT_LENGTH)) == READ_INTERRUPTED) {
+            MEM_FREE(input);
+            continue;
+        }
+        if (length == -1) {
+            MEM_FREE(input);
+            exitProgram(procList, NULL);
+        }
 
-        // get and parse inputs into a command structure and free the now unneded input
+        // parse inputs into a command structure and free the now unneded input
+        strcpy(line, input);
+        startNs = monotonicNs();
         struct command *cmd = parseInput(input, args, isForeOnlyMode);
-        free(input);
+        MEM_FREE(input);
 
-        // if there's a command execute it
+        // if there's a command list execute it
         if (cmd != NULL) {
-            // check if the command is built into the shell and execute the appropriate
-            // command
-            int builtInRes = isBuiltIn(cmd->args[0]);
-            switch (builtInRes) {
-                case CD_FLAG: cd(cmd->args, cmd->numArgs);
-                    printPrompt();
-                    break;
-                case STATUS_FLAG:
-                    showStatus();
-                    printPrompt();
-                    break;
-                case EXIT_FLAG:
-                    exitProgram(procList, cmd);
-                    printPrompt();
-                    run = 0;
-                    break;
-                default:
-
-                    // if command is not build in process it using fork
-                    if (cmd->isBgProcess) { // if it's a background process
-                        // perform fork and save result
-                        struct forkResult *res = forkBackground(cmd, procList);
-
-                        // if result pid is 0 there was an error so free memory and exit
-                        if (res->pid == 0){
-                            if (cmd != NULL) {
-                                freeCommand(cmd);
-                            }
-                            freeProcessList(procList);
-                            free(res);
-                            exit(1);
-                        }
-                        free(res);
-
-                    } else {
-                        // perform fork and save result
-                        struct forkResult *res = forkForeground(cmd, procList, isForeOnlyMode);
-
-                        // if result pid is 0 there was an error so free memory and exit
-                        if (res->pid == 0){
-                            if (cmd != NULL) {
-                                freeCommand(cmd);
-                            }
-                            freeProcessList(procList);
-                            free(res);
-                            exit(1);
-                        }
-
-                        // save result's foreground only in case it was updated
-                        isForeOnlyMode = res->isForeOnly;
-                        free(res);
-                    }
-            }
-
+            executeList(cmd, procList, &isForeOnlyMode);
             freeCommand(cmd);
-        } else {
-            // clear any finished background processes before presenting the next
-            // command line prompt
-            nonBlockClearFinished(procList);
-
-            printPrompt();
+            recordCommand(line, startNs, lastExitStatus);
         }
 
+        // clear any finished background processes before presenting the next
+        // command line prompt
+        nonBlockClearFinished(procList);
+
+        printPrompt();
+
     }
 }
 /************************************************************************************
@@ -124,23 +163,22 @@ void startShell() {
  ***********************************************************************************/
 void initParentProc(pid_t pid) {
     // create vars more than large enough to hold the data
-    char *temp = calloc(15, sizeof(char ));
+    char *temp = MEM_CALLOC(MEM_INPUT, 15, sizeof(char ));
     int length = 0;
 
-    // fill the string with the pid and save it as an environment variable
+    // fill the string with the pid and save it as a shell variable
     sprintf(temp, "%d", pid);
-    setenv(PID, temp, 1);
+    setShellVar(PID, temp);
 
-    // get the length of the PID and save that as an environment variable
+    // get the length of the PID and save that as a shell variable
     length = strlen(temp);
     memset(temp, 0, 15*sizeof(char ));
     sprintf(temp, "%d", length);
-    setenv(PID_LEN, temp, 1);
+    setShellVar(PID_LEN, temp);
 
-    free(temp);
+    MEM_FREE(temp);
 
-    // load the handlers and set the initial status and FG toggle to 0
+    // load the handlers and set the initial status, as status shows it after a command
     loadHandlers(PARENT);
-    setenv(STATUS, "exit code 0", 1);
-    setenv("TOGGLE_FG_MODE", "0", 1);
-}
\ No newline at end of file
+    setShellVar(STATUS, "exit value 0\n");
+}
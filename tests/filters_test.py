@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""Compares the filter built ins with the coreutils programs they stand in for.
+
+usage: filters_test.py [path to smallsh]
+
+Every filter is run by smallsh under each SMALLSH_SCAN version (the default, which is
+AVX2 where the CPU has it, sse2 and scalar), both reading a `<` file in the shell and
+reading a pipe, and its output is compared with /bin/sh running the same line. The
+inputs place the needle across the 16 and 32 byte blocks of the scans, end without a
+final newline, and are longer than one FILTER_BUF_SIZE (256 KB) read.
+"""
+import os
+import random
+import shutil
+import subprocess
+import sys
+import tempfile
+
+SHELL = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else "./smallsh")
+SCANS = [None, "sse2", "scalar"]
+FILTERS = [
+    "grep -F needle", "grep needle", "grep -v needle", "grep -c needle", "grep -F -v -c needle",
+    "wc -l", "wc -c", "head", "head -n 3", "tail", "tail -n 3", "tail -n 5000",
+    "grep -F needle | wc -l", "grep -v needle | tail -n 7", "head -n 4000 | grep -c needle",
+]
+failures = 0
+
+
+def check(name, isOk, detail=""):
+    global failures
+    print(("ok   " if isOk else "FAIL ") + name + ("" if isOk else ": " + detail))
+    failures += not isOk
+
+
+def boundaryInput():
+    """Lines putting the needle, and near misses, at every offset around the blocks."""
+    lines = []
+    for offset in range(70):
+        lines.append("a" * offset + "needle" + "b" * (offset % 5))
+        lines.append("c" * offset + "needl")
+        lines.append("eedle" + "d" * offset)
+    for length in (15, 16, 17, 31, 32, 33, 63, 64, 65):
+        lines.append("e" * (length - 6) + "needle")
+        lines.append("f" * length)
+    lines.append("")
+    return "\n".join(lines) + "\n"
+
+
+def largeInput():
+    """Over a megabyte of lines, including one longer than a whole read."""
+    rand = random.Random(344)
+    lines, size = [], 0
+    while size < 1200 * 1024:
+        words = [rand.choice(["alpha", "beta", "needle", "gamma", "x" * rand.randint(1, 90)])
+                 for _ in range(rand.randint(0, 12))]
+        lines.append(" ".join(words))
+        if len(lines) == 2000:
+            lines.append("g" * (300 * 1024) + "needle")
+        size += len(lines[-1]) + 1
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    tmp = tempfile.mkdtemp()
+    inputs = {
+        "boundary": boundaryInput(),
+        "no final newline": boundaryInput() + "last needle line",
+        "large": largeInput(),
+        "large without final newline": largeInput()[:-1],
+    }
+
+    try:
+        # every filter line reads every input both from a file and from a pipe
+        cases = []
+        for i, (inputName, text) in enumerate(inputs.items()):
+            inputPath = os.path.join(tmp, "input%d" % i)
+            with open(inputPath, "w") as file:
+                file.write(text)
+            for j, filterLine in enumerate(FILTERS):
+                first, bar, rest = filterLine.partition(" | ")
+                cases.append(("%s (%s, file)" % (filterLine, inputName), "out%d_%d_file" % (i, j),
+                              "%s < %s%s%s" % (first, inputPath, bar, rest)))
+                cases.append(("%s (%s, pipe)" % (filterLine, inputName), "out%d_%d_pipe" % (i, j),
+                              "cat %s | %s" % (inputPath, filterLine)))
+
+        def runScript(command, prefix, env=None):
+            script = os.path.join(tmp, "script")
+            with open(script, "w") as file:
+                for name, output, line in cases:
+                    file.write("%s > %s\n" % (line, os.path.join(tmp, prefix + output)))
+            subprocess.run(command + [script], env=env, stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL,
+                           check=True)
+
+        # the same lines are run by /bin/sh and by smallsh once per scan version
+        runScript(["/bin/sh"], "expected_")
+        for scan in SCANS:
+            env = dict(os.environ)
+            env.pop("SMALLSH_SCAN", None)
+            if scan is not None:
+                env["SMALLSH_SCAN"] = scan
+            runScript([SHELL], "actual_", env)
+
+            numWrong = 0
+            for name, output, line in cases:
+                expected = open(os.path.join(tmp, "expected_" + output), "rb").read()
+                actual = open(os.path.join(tmp, "actual_" + output), "rb").read()
+                if expected != actual:
+                    numWrong += 1
+                    at = next((k for k in range(min(len(actual), len(expected))) if actual[k] != expected[k]),
+                              min(len(actual), len(expected)))
+                    check("%s under %s" % (name, scan or "default"), False,
+                          "%d bytes instead of %d, first difference at %d: %r != %r" %
+                          (len(actual), len(expected), at, actual[at:at + 40], expected[at:at + 40]))
+            check("%d filter runs under %s" % (len(cases), scan or "default"), numWrong == 0,
+                  "%d differ" % numWrong)
+    finally:
+        shutil.rmtree(tmp)
+
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == "__main__":
+    main()
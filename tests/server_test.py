@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""Exercises `smallsh --serve` over a local unix domain socket.
+
+usage: server_test.py [path to smallsh]
+
+Checks the framing of stdout, stderr and exit status frames, that per session state
+(cd, status) is kept, that pipelines and process substitutions are connected, that
+functions are refused, that a client hanging up while its command runs has the command
+terminated without the server spinning on the closed socket, and that only a stale
+socket is replaced at the path the server listens on.
+"""
+import os
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+SHELL = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else "./smallsh")
+failures = 0
+
+
+def check(name, isOk, detail=""):
+    global failures
+    print(("ok   " if isOk else "FAIL ") + name + ("" if isOk else ": " + detail))
+    failures += not isOk
+
+
+def connect(path):
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    for _ in range(100):
+        try:
+            sock.connect(path)
+            return sock
+        except (FileNotFoundError, ConnectionRefusedError):
+            time.sleep(0.02)
+    raise RuntimeError("server did not start")
+
+
+def readFrames(sock):
+    """Reads frames until the server closes the connection."""
+    data = b""
+    while True:
+        chunk = sock.recv(65536)
+        if not chunk:
+            break
+        data += chunk
+
+    frames = []
+    while data:
+        kind, length = struct.unpack(">cI", data[:5])
+        frames.append((kind.decode(), data[5:5 + length].decode()))
+        data = data[5 + length:]
+    return frames
+
+
+def runLines(path, lines):
+    """Sends command lines as one client and returns every frame sent back."""
+    sock = connect(path)
+    sock.sendall(lines.encode())
+    sock.shutdown(socket.SHUT_WR)
+    frames = readFrames(sock)
+    sock.close()
+    return frames
+
+
+def listenFails(path):
+    """Runs a server that is expected to refuse the path, returning TRUE if it did."""
+    try:
+        result = subprocess.run([SHELL, "--serve", path], stdout=subprocess.PIPE, timeout=2)
+    except subprocess.TimeoutExpired:
+        return False
+    return b"cannot listen" in result.stdout
+
+
+def sleeping(seconds):
+    """Finds the processes running `sleep <seconds>`."""
+    pids = []
+    for entry in os.listdir("/proc"):
+        try:
+            if entry.isdigit() and open("/proc/%s/cmdline" % entry, "rb").read() == b"sleep\0%d\0" % seconds:
+                pids.append(int(entry))
+        except OSError:
+            pass
+    return pids
+
+
+def cpuTicks(pid):
+    fields = open("/proc/%d/stat" % pid).read().rsplit(")", 1)[1].split()
+    return int(fields[11]) + int(fields[12])
+
+
+def children(pid):
+    text = open("/proc/%d/task/%d/children" % (pid, pid)).read()
+    return [int(child) for child in text.split()]
+
+
+def main():
+    tmp = tempfile.mkdtemp()
+    path = os.path.join(tmp, "smallsh.sock")
+    server = subprocess.Popen([SHELL, "--serve", path], stdout=subprocess.DEVNULL)
+
+    try:
+        # a client that sends its lines and shuts down its side gets every answer
+        sock = connect(path)
+        sock.sendall(b"/bin/echo hello\nls /nonexistent/path\ncd /tmp\npwd\nstatus\n")
+        sock.shutdown(socket.SHUT_WR)
+        frames = readFrames(sock)
+        sock.close()
+
+        check("stdout frame", ("O", "hello\n") in frames, repr(frames))
+        stderr = "".join(text for kind, text in frames if kind == "E")
+        check("stderr frames", "nonexistent" in stderr, repr(frames))
+        exits = [text for kind, text in frames if kind == "X"]
+        check("one exit frame per command", len(exits) == 5, repr(exits))
+        check("exit frame payload", exits[:2] == ["exit value 0", "exit value 2"], repr(exits))
+        check("cd kept by the session", ("O", "/tmp\n") in frames, repr(frames))
+        check("status kept by the session", ("O", "exit value 0\n") in frames, repr(frames))
+
+        # the stages of a pipeline are connected and report as one command
+        frames = runLines(path, "/bin/echo a b c | tr a-z A-Z\nseq 1 100000 | head -n 2\n"
+                                "ls /nonexistent/path | wc -l\nfalse\nstatus | cat\n")
+        check("pipeline output", "".join(text for kind, text in frames if kind == "O") ==
+              "A B C\n1\n2\n0\nexit value 1\n", repr(frames))
+        check("one exit frame per pipeline", len([kind for kind, text in frames if kind == "X"]) == 5,
+              repr(frames))
+
+        # process substitutions are started and passed to the command
+        frames = runLines(path, "cat <(/bin/echo sub)\ncmp -s <(seq 1 3) <(seq 1 4)\n"
+                                "seq 1 3 | cat <(/bin/echo first) -\n")
+        check("process substitution output", "".join(text for kind, text in frames if kind == "O") ==
+              "sub\nfirst\n1\n2\n3\n", repr(frames))
+        check("process substitution status", [text for kind, text in frames if kind == "X"] ==
+              ["exit value 0", "exit value 1", "exit value 0"], repr(frames))
+
+        # function definitions are refused rather than executed as a command
+        frames = runLines(path, "f() { /bin/echo x }\nfunction g { /bin/echo y }\n")
+        stderr = "".join(text for kind, text in frames if kind == "E")
+        check("function definitions refused", stderr.count("not available in server mode") == 2 and
+              [text for kind, text in frames if kind == "X"] == ["exit value 1"] * 2, repr(frames))
+
+        # a client hanging up while its command runs
+        sock = connect(path)
+        sock.sendall(b"sleep 30\n")
+        time.sleep(0.3)
+        check("command started", len(children(server.pid)) == 1, repr(children(server.pid)))
+        sock.close()
+
+        time.sleep(0.5)
+        start = cpuTicks(server.pid)
+        time.sleep(1)
+        ticks = cpuTicks(server.pid) - start
+        check("server idle after a hang up", ticks <= 5, "%d ticks in 1s" % ticks)
+        check("command of the dropped session terminated", children(server.pid) == [],
+              repr(children(server.pid)))
+
+        # everything the command started goes with it, and other sessions are not held
+        # up while it is terminated
+        script = os.path.join(tmp, "spawn.sh")
+        with open(script, "w") as file:
+            file.write("trap '' TERM\nsleep 3141 &\nwhile :; do sleep 3142; done\n")
+        sock = connect(path)
+        sock.sendall(("/bin/sh %s\n" % script).encode())
+        time.sleep(0.3)
+        check("command group started", len(sleeping(3141)) == 1, repr(sleeping(3141)))
+        sock.close()
+        other = connect(path)
+        start = time.monotonic()
+        other.sendall(b"/bin/echo meanwhile\n")
+        other.shutdown(socket.SHUT_WR)
+        isAnswered = ("O", "meanwhile\n") in readFrames(other)
+        other.close()
+        check("other session answered during the grace period",
+              isAnswered and time.monotonic() - start < 0.09, "%.3fs" % (time.monotonic() - start))
+        time.sleep(0.5)
+        check("command group terminated", sleeping(3141) == [] and sleeping(3142) == [],
+              repr(sleeping(3141) + sleeping(3142)))
+        os.unlink(script)
+
+        # the server still answers new clients
+        sock = connect(path)
+        sock.sendall(b"/bin/echo again\n")
+        sock.shutdown(socket.SHUT_WR)
+        check("server still serving", ("O", "again\n") in readFrames(sock))
+        sock.close()
+
+        # a socket a server answers on is not taken over
+        check("live socket kept", listenFails(path) and os.path.exists(path))
+        server.kill()
+        server.wait()
+
+        # a stale socket is replaced
+        server = subprocess.Popen([SHELL, "--serve", path], stdout=subprocess.DEVNULL)
+        sock = connect(path)
+        sock.sendall(b"/bin/echo replaced\n")
+        sock.shutdown(socket.SHUT_WR)
+        check("stale socket replaced", ("O", "replaced\n") in readFrames(sock))
+        sock.close()
+
+        # a file that is not a socket is left alone
+        notSocket = os.path.join(tmp, "notes")
+        with open(notSocket, "w") as file:
+            file.write("keep\n")
+        check("other file kept", listenFails(notSocket) and open(notSocket).read() == "keep\n")
+        os.unlink(notSocket)
+    finally:
+        server.kill()
+        server.wait()
+        if os.path.exists(path):
+            os.unlink(path)
+        os.rmdir(tmp)
+
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == "__main__":
+    main()